@@ -11,6 +11,7 @@
 #include <algorithm>
 #include <fstream>
 #include <cmath>
+#include <iterator>
 #include "constants.h"
 #include "config.h"
 
@@ -27,6 +28,9 @@ pxarCore::pxarCore(std::string usbId, std::string logLevel) :
   // Set up the libpxar API/HAL logging mechanism:
   Log::ReportingLevel() = Log::FromString(logLevel);
   LOG(logINFO) << "Log level: " << logLevel;
+  if(Log::ReportingLevel() > LogLevelCompiled()) {
+    LOG(logWARNING) << "Messages above log level " << Log::ToString(LogLevelCompiled()) << " are not compiled in.";
+  }
 
   // Get a new HAL instance with the DTB USB ID passed to the API constructor:
   _hal = new hal(usbId);
@@ -191,13 +195,17 @@ bool pxarCore::initDUT(std::vector<uint8_t> hubids,
       LOG(logCRITICAL) << "Too many pixels (N_pixel="<< rocit->size() <<" > 4160) configured for ROC "<< static_cast<int>(rocit - rocPixels.begin()) << "!";
       throw InvalidConfig("Too many pixels (>4160) configured");
     }
-    // check individual pixel configurations
+    // check individual pixel configurations, marking the pixels seen so far:
     int nduplicates = 0;
+    std::vector<bool> configured(ROC_NUMCOLS*ROC_NUMROWS,false);
     for(std::vector<pixelConfig>::iterator pixit = rocit->begin(); pixit != rocit->end(); pixit++){
-      if (std::count_if(rocit->begin(),rocit->end(),findPixelXY(pixit->column(),pixit->row())) > 1){
+      if (pixit->column() >= ROC_NUMCOLS || pixit->row() >= ROC_NUMROWS) continue;
+      size_t position = pixit->column()*ROC_NUMROWS + pixit->row();
+      if (configured[position]){
 	LOG(logCRITICAL) << "Config for pixel in column " << static_cast<int>(pixit->column()) << " and row "<< static_cast<int>(pixit->row()) << " present multiple times in ROC " << static_cast<int>(rocit-rocPixels.begin()) << "!";
 	nduplicates++;
       }
+      configured[position] = true;
     }
     if (nduplicates>0){
       throw InvalidConfig("Duplicate pixel configurations present");
@@ -412,6 +420,7 @@ bool pxarCore::initDUT(std::vector<uint8_t> hubids,
 
   // All data is stored in the DUT struct, now programming it.
   _dut->_initialized = true;
+  _dut->_version++;
   return programDUT();
 }
 
@@ -425,7 +434,8 @@ bool pxarCore::programDUT() {
   // First thing to do: startup DUT power if not yet done
   _hal->Pon();
 
-  // Start programming the devices here!
+  // Start programming the devices here, collecting the register settings in one RPC batch:
+  rpcBatch batch(_hal);
 
   std::vector<tbmConfig> enabledTbms = _dut->getEnabledTbms();
   if(!enabledTbms.empty()) { LOG(logDEBUGAPI) << "Programming TBMs..."; }
@@ -447,9 +457,11 @@ bool pxarCore::programDUT() {
 
   // Also clear all calibrate signals:
   SetCalibrateBits(false);
+  batch.end();
 
   // The DUT is programmed, everything all right:
   _dut->_programmed = true;
+  _dut->_version++;
 
   return true;
 }
@@ -571,6 +583,7 @@ void pxarCore::Poff() {
   _hal->Poff();
   // Reset the programmed state of the DUT (lost by turning off power)
   _dut->_programmed = false;
+  _dut->_version++;
 }
 
 void pxarCore::Pon() {
@@ -667,6 +680,11 @@ statistics pxarCore::getStatistics() {
   return _hal->daqStatistics();
 }
 
+std::vector<statistics> pxarCore::getLiveStatistics() {
+  // Copy of the published decoder statistics, nothing is reset:
+  return _hal->daqLiveStatistics();
+}
+
   
 // TEST functions
 
@@ -1544,7 +1562,12 @@ std::vector<rawEvent> pxarCore::daqGetRawEventBuffer() {
   // Select the right readout channels depending on the number of TBMs
   // The HAL function throws pxar::DataNoEvent if nothing to be 
   // returned
-  return _hal->daqAllRawEvents();
+  std::vector<rawEvent> raw = _hal->daqAllRawEvents();
+
+  // The HAL records refer to its storage arena, the records handed out
+  // own their data words:
+  for(std::vector<rawEvent>::iterator it = raw.begin(); it != raw.end(); ++it) { it->Detach(); }
+  return raw;
 }
 
 std::vector<Event> pxarCore::daqGetEventBuffer() {
@@ -1556,6 +1579,23 @@ std::vector<Event> pxarCore::daqGetEventBuffer() {
   return _hal->daqAllEvents();
 }
 
+size_t pxarCore::daqProcessEvents(eventVisitor & visitor) {
+
+  // Reading out all data from the DTB and passing the decoded Events on to
+  // the visitor, one at a time.
+  // The HAL function throws pxar::DataNoEvent if nothing to be 
+  // returned
+  return _hal->daqProcessEvents(visitor);
+}
+
+size_t pxarCore::daqGetEventBatch(eventBatch & batch) {
+
+  // Reading out all data from the DTB into the columns of the event batch.
+  // The HAL function throws pxar::DataNoEvent if nothing to be 
+  // returned
+  return _hal->daqAllEvents(batch);
+}
+
 Event pxarCore::daqGetEvent() {
 
   // Return the next decoded Event from the FIFO buffer.
@@ -1609,6 +1649,18 @@ bool pxarCore::daqStop(const bool init) {
 }
 
 
+// Moves the events returned by one call of a test loop to the end of the data storage vector.
+// The vector is sized from the first call for the given number of calls left, including this one:
+static void appendEvents(std::vector<Event> & data, std::vector<Event> & buffer, size_t calls) {
+  if(data.empty()) {
+    data.swap(buffer);
+    data.reserve(data.size()*calls);
+  }
+  else {
+    data.insert(data.end(), std::make_move_iterator(buffer.begin()), std::make_move_iterator(buffer.end()));
+  }
+}
+
 std::vector<Event> pxarCore::expandLoop(HalMemFnPixelSerial pixelfn, HalMemFnPixelParallel multipixelfn, HalMemFnRocSerial rocfn, HalMemFnRocParallel multirocfn, std::vector<int32_t> param, bool efficiency, uint16_t flags) {
 
   // Ensure the pattern generator trigger is active:
@@ -1620,16 +1672,14 @@ std::vector<Event> pxarCore::expandLoop(HalMemFnPixelSerial pixelfn, HalMemFnPix
   // Start test timer:
   timer t;
 
+  // The enabled ROCs and pixels, only recomputed if the DUT configuration changed:
+  const dutSnapshot & enabled = _dut->getSnapshot();
+
   // Check if all pixels are configured the same way on all ROCs. If this is not the case, we need to run this in FLAG_FORCE_SERIAL mode:
-  std::vector<uint8_t> enabledRocs = _dut->getEnabledRocIDs();
-  for(std::vector<uint8_t>::iterator rc = enabledRocs.begin(); rc != enabledRocs.end(); ++rc) {
-    // Compare the configuration of the first ROC with all others:
-    if(!comparePixelConfiguration(_dut->getEnabledPixels(enabledRocs.at(0)),_dut->getEnabledPixels(*rc))) {
-      flags |= FLAG_FORCE_SERIAL;
-      LOG(logINFO) << "Not all ROCs have their pixels configured the same way. "
-		   << "Running in FLAG_FORCE_SERIAL mode.";
-      break;
-    }
+  if(!enabled.identicalPixels) {
+    flags |= FLAG_FORCE_SERIAL;
+    LOG(logINFO) << "Not all ROCs have their pixels configured the same way. "
+		 << "Running in FLAG_FORCE_SERIAL mode.";
   }
 
   // Do the masking/unmasking&trimming for all ROCs first.
@@ -1645,13 +1695,13 @@ std::vector<Event> pxarCore::expandLoop(HalMemFnPixelSerial pixelfn, HalMemFnPix
 
   // Check if we might use parallel routine on whole module: more than one ROC
   // must be enabled and parallel execution not disabled by user
-  if ((_dut->getNEnabledRocs() > 1) && ((flags & FLAG_FORCE_SERIAL) == 0)) {
+  if ((enabled.rocIds.size() > 1) && ((flags & FLAG_FORCE_SERIAL) == 0)) {
 
     // Get the I2C addresses for all enabled ROCs from the config:
-    std::vector<uint8_t> rocs_i2c = _dut->getEnabledRocI2Caddr();
+    const std::vector<uint8_t> & rocs_i2c = enabled.rocI2C;
 
     // Check if all pixels are enabled:
-    if (_dut->getAllPixelEnable() && multirocfn != NULL) {
+    if (enabled.allPixels && multirocfn != NULL) {
       LOG(logDEBUGAPI) << "\"The Loop\" contains one call to \'multirocfn\'";
       
       // execute call to HAL layer routine
@@ -1660,33 +1710,17 @@ std::vector<Event> pxarCore::expandLoop(HalMemFnPixelSerial pixelfn, HalMemFnPix
     // Otherwise call the Pixel Parallel function several times:
     else if (multipixelfn != NULL) {
       
-      // Get one of the enabled ROCs:
-      std::vector<uint8_t> enabledRocs = _dut->getEnabledRocIDs();
-      std::vector<Event> rocdata = std::vector<Event>();
-      std::vector<pixelConfig> enabledPixels = _dut->getEnabledPixels(enabledRocs.front());
+      // Get the pixels of one of the enabled ROCs:
+      const std::vector<pixelConfig> & enabledPixels = enabled.pixels.front();
 
       LOG(logDEBUGAPI) << "\"The Loop\" contains "
 		       << enabledPixels.size() << " calls to \'multipixelfn\'";
 
-      for (std::vector<pixelConfig>::iterator px = enabledPixels.begin(); px != enabledPixels.end(); ++px) {
-	// execute call to HAL layer routine and store data in buffer
+      for (std::vector<pixelConfig>::const_iterator px = enabledPixels.begin(); px != enabledPixels.end(); ++px) {
+	// execute call to HAL layer routine and move the data to the main data storage vector
 	std::vector<Event> buffer = CALL_MEMBER_FN(*_hal,multipixelfn)(rocs_i2c, px->column(), px->row(), efficiency, param);
-
-	// merge pixel data into roc data storage vector
-	if (rocdata.empty()){
-	  rocdata = buffer; // for first time call
-	} else {
-	  // Add buffer vector to the end of existing Event data:
-	  rocdata.reserve(rocdata.size() + buffer.size());
-	  rocdata.insert(rocdata.end(), buffer.begin(), buffer.end());
-	}
+	appendEvents(data, buffer, enabledPixels.end() - px);
       } // pixel loop
-	// append rocdata to main data storage vector
-      if (data.empty()) data = rocdata;
-      else {
-	data.reserve(data.size() + rocdata.size());
-	data.insert(data.end(), rocdata.begin(), rocdata.end());
-      }
     } // Pixels parallel
   } // Parallel functions
 
@@ -1696,62 +1730,43 @@ std::vector<Event> pxarCore::expandLoop(HalMemFnPixelSerial pixelfn, HalMemFnPix
     // -> single ROC / ROC-by-ROC operation
     // check if all pixels are enabled
     // if so, use routine that accesses whole ROC
-    if (_dut->getAllPixelEnable() && rocfn != NULL){
+    if (enabled.allPixels && rocfn != NULL){
 
       // loop over all enabled ROCs
-      std::vector<rocConfig> enabledRocs = _dut->getEnabledRocs();
+      LOG(logDEBUGAPI) << "\"The Loop\" contains " << enabled.rocIds.size() << " calls to \'rocfn\'";
 
-      LOG(logDEBUGAPI) << "\"The Loop\" contains " << enabledRocs.size() << " calls to \'rocfn\'";
-
-      for (std::vector<rocConfig>::iterator rocit = enabledRocs.begin(); rocit != enabledRocs.end(); ++rocit) {
+      for (size_t r = 0; r < enabled.rocIds.size(); ++r) {
 
 	// If we have serial execution make sure to trim the ROC if we requested forceUnmasked:
-	if(((flags & FLAG_FORCE_SERIAL) != 0) && ((flags & FLAG_FORCE_UNMASKED) != 0)) { MaskAndTrim(true,rocit); }
+	if(((flags & FLAG_FORCE_SERIAL) != 0) && ((flags & FLAG_FORCE_UNMASKED) != 0)) { MaskAndTrim(true,_dut->roc.begin() + enabled.rocIds.at(r)); }
 
 	// execute call to HAL layer routine and save returned data in buffer
-	std::vector<Event> rocdata = CALL_MEMBER_FN(*_hal,rocfn)(rocit->i2c_address, efficiency, param);
-	// append rocdata to main data storage vector
-        if (data.empty()) data = rocdata;
-	else {
-	  data.reserve(data.size() + rocdata.size());
-	  data.insert(data.end(), rocdata.begin(), rocdata.end());
-	}
+	std::vector<Event> rocdata = CALL_MEMBER_FN(*_hal,rocfn)(enabled.rocI2C.at(r), efficiency, param);
+	// move rocdata to main data storage vector
+	appendEvents(data, rocdata, enabled.rocIds.size() - r);
       } // roc loop
     }
     else if (pixelfn != NULL) {
 
       // -> we operate on single pixels
       // loop over all enabled ROCs
-      std::vector<rocConfig> enabledRocs = _dut->getEnabledRocs();
-
-      LOG(logDEBUGAPI) << "\"The Loop\" contains " << enabledRocs.size() << " enabled ROCs.";
+      LOG(logDEBUGAPI) << "\"The Loop\" contains " << enabled.rocIds.size() << " enabled ROCs.";
 
-      for (std::vector<rocConfig>::iterator rocit = enabledRocs.begin(); rocit != enabledRocs.end(); ++rocit){
-	std::vector<Event> rocdata = std::vector<Event>();
-	std::vector<pixelConfig> enabledPixels = _dut->getEnabledPixelsI2C(rocit->i2c_address);
+      // Total number of calls, to size the data storage vector:
+      size_t calls = 0;
+      for (size_t r = 0; r < enabled.rocIds.size(); ++r) { calls += enabled.pixels.at(r).size(); }
 
+      for (size_t r = 0; r < enabled.rocIds.size(); ++r){
+	const std::vector<pixelConfig> & enabledPixels = enabled.pixels.at(r);
 
 	LOG(logDEBUGAPI) << "\"The Loop\" for the current ROC contains " \
 			 << enabledPixels.size() << " calls to \'pixelfn\'";
 
-	for (std::vector<pixelConfig>::iterator pixit = enabledPixels.begin(); pixit != enabledPixels.end(); ++pixit) {
-	  // execute call to HAL layer routine and store data in buffer
-	  std::vector<Event> buffer = CALL_MEMBER_FN(*_hal,pixelfn)(rocit->i2c_address, pixit->column(), pixit->row(), efficiency, param);
-	  // merge pixel data into roc data storage vector
-	  if (rocdata.empty()){
-	    rocdata = buffer; // for first time call
-	  } else {
-	    // Add buffer vector to the end of existing Event data:
-	    rocdata.reserve(rocdata.size() + buffer.size());
-	    rocdata.insert(rocdata.end(), buffer.begin(), buffer.end());
-	  }
+	for (std::vector<pixelConfig>::const_iterator pixit = enabledPixels.begin(); pixit != enabledPixels.end(); ++pixit) {
+	  // execute call to HAL layer routine and move the data to the main data storage vector
+	  std::vector<Event> buffer = CALL_MEMBER_FN(*_hal,pixelfn)(enabled.rocI2C.at(r), pixit->column(), pixit->row(), efficiency, param);
+	  appendEvents(data, buffer, calls--);
 	} // pixel loop
-	// append rocdata to main data storage vector
-        if (data.empty()) data = rocdata;
-	else {
-	  data.reserve(data.size() + rocdata.size());
-	  data.insert(data.end(), rocdata.begin(), rocdata.end());
-	}
       } // roc loop
     }// single pixel fnc
     else {
@@ -1790,6 +1805,11 @@ std::vector<pixel> pxarCore::repackMapData(std::vector<Event> &data, uint16_t fl
   // Measure time:
   timer t;
 
+  // Size the result for all pixels:
+  size_t npixels = 0;
+  for(std::vector<Event>::iterator Eventit = data.begin(); Eventit!= data.end(); ++Eventit) { npixels += Eventit->pixels.size(); }
+  result.reserve(npixels);
+
   // Loop over all Events we have:
   for(std::vector<Event>::iterator Eventit = data.begin(); Eventit!= data.end(); ++Eventit) {
 
@@ -1810,8 +1830,8 @@ std::vector<pixel> pxarCore::repackMapData(std::vector<Event> &data, uint16_t fl
 	  pixit->setValue(-1*pixit->value());
 	}
       }
-      result.push_back(*pixit);
     } // loop over pixels
+    result.insert(result.end(), Eventit->pixels.begin(), Eventit->pixels.end());
 
     if((flags&FLAG_CHECK_ORDER) != 0) {
       expected_row++;
@@ -1849,8 +1869,17 @@ std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::repackDacScanDa
   LOG(logDEBUGAPI) << "Packing DAC range " << static_cast<int>(dacMin) << " - " << static_cast<int>(dacMax) << " (step size " << static_cast<int>(dacStep) << "), data has " << data.size() << " entries.";
 
   // Prepare the result vector
+  size_t nDACs = static_cast<size_t>((dacMax-dacMin)/dacStep+1);
+  result.reserve(nDACs);
   for(size_t dac = dacMin; dac <= dacMax; dac += dacStep) { result.push_back(std::make_pair(dac,std::vector<pixel>())); }
 
+  // With several rounds over the DAC range, size every DAC setting for all of its pixels:
+  if(data.size() > nDACs) {
+    std::vector<size_t> npixels(nDACs, 0);
+    for(size_t i = 0; i < data.size(); i++) { npixels[i%nDACs] += data[i].pixels.size(); }
+    for(size_t i = 0; i < nDACs; i++) { result[i].second.reserve(npixels[i]); }
+  }
+
   size_t currentDAC = dacMin;
   // Loop over the packed data and separate into DAC ranges, potentially several rounds:
   for(std::vector<Event>::iterator Eventit = data.begin(); Eventit!= data.end(); ++Eventit) {
@@ -1874,12 +1903,13 @@ std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::repackDacScanDa
 	  pixit->setValue(-1*pixit->value());
 	}
       }
-
-      // Add the pixel to the list:
-      result.at((currentDAC-dacMin)/dacStep).second.push_back(*pixit);
-
     } // loop over all pixels
 
+    // Add the pixels to the list, taking over the pixel vector of the first event:
+    std::vector<pixel> & pixels = result.at((currentDAC-dacMin)/dacStep).second;
+    if(pixels.empty() && pixels.capacity() == 0) { pixels.swap(Eventit->pixels); }
+    else { pixels.insert(pixels.end(), Eventit->pixels.begin(), Eventit->pixels.end()); }
+
     // Advance the expected pixel address if we reached the upper DAC scan boundary:
     if((flags&FLAG_CHECK_ORDER) != 0 && currentDAC == dacMax) {
       expected_row++;
@@ -1903,8 +1933,6 @@ std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::repackDacScanDa
 std::vector<pixel> pxarCore::repackThresholdMapData (std::vector<Event> &data, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t thresholdlevel, uint16_t nTriggers, uint16_t flags) {
 
   std::vector<pixel> result;
-  // Vector of pixels for which a threshold has already been found
-  std::vector<pixel> found;
 
   // Threshold is the the given efficiency level "thresholdlevel"
   // Using ceiling function to take higher threshold when in doubt.
@@ -1918,8 +1946,9 @@ std::vector<pixel> pxarCore::repackThresholdMapData (std::vector<Event> &data, u
   // First, pack the data as it would be a regular Dac Scan:
   std::vector<std::pair<uint8_t,std::vector<pixel> > > packed_dac = repackDacScanData(data, dacStep, dacMin, dacMax, flags);
 
-  // Efficiency map:
-  std::map<pixel,uint8_t> oldvalue;
+  // Threshold finding state for every pixel of the module (result position,
+  // threshold found, efficiency at the previous DAC step):
+  std::vector<thresholdState> state(MOD_NUMROCS*ROC_NUMCOLS*ROC_NUMROWS);
 
   // Then loop over all pixels and DAC settings, start from the back if we are looking for falling edge.
   // This ensures that we end up having the correct edge, even if the efficiency suddenly changes from 0 to max.
@@ -1932,49 +1961,51 @@ std::vector<pixel> pxarCore::repackThresholdMapData (std::vector<Event> &data, u
   for(std::vector<std::pair<uint8_t,std::vector<pixel> > >::iterator it = it_start; it != it_end; it += increase_op) {
     // For every DAC value, loop over all pixels:
     for(std::vector<pixel>::iterator pixit = it->second.begin(); pixit != it->second.end(); ++pixit) {
+      if(pixit->column() >= ROC_NUMCOLS || pixit->row() >= ROC_NUMROWS) {
+	LOG(logWARNING) << "Skipping pixel with invalid address " << (*pixit);
+	continue;
+      }
+
+      size_t idx = pixelIndex(pixit->roc(), pixit->column(), pixit->row());
+      if(idx >= state.size()) { state.resize(static_cast<size_t>(pixit->roc()+1)*ROC_NUMCOLS*ROC_NUMROWS); }
+      thresholdState & px_state = state[idx];
+
       // Check if for this pixel a threshold has been found already and we can skip the rest:
-      std::vector<pixel>::iterator px_found = std::find_if(found.begin(),
-							   found.end(),
-							   findPixelXY(pixit->column(), pixit->row(), pixit->roc()));
-      if(px_found != found.end()) continue;
-
-      // Check if we have that particular pixel already in the result vector:
-      std::vector<pixel>::iterator px = std::find_if(result.begin(),
-						     result.end(),
-						     findPixelXY(pixit->column(), pixit->row(), pixit->roc()));
-  
+      if(px_state.found) continue;
+
       // Pixel is known:
-      if(px != result.end()) {
+      if(px_state.index >= 0) {
 	// Calculate efficiency deltas and slope:
-	uint8_t delta_old = abs(oldvalue[*px] - threshold);
+	uint8_t delta_old = abs(px_state.oldvalue - threshold);
 	uint8_t delta_new = abs(static_cast<uint8_t>(pixit->value()) - threshold);
-	bool positive_slope = (static_cast<uint8_t>(pixit->value()) - oldvalue[*px] > 0 ? true : false);
+	bool positive_slope = (static_cast<uint8_t>(pixit->value()) - px_state.oldvalue > 0 ? true : false);
 
 	// Check which value is closer to the threshold. Only if the slope is positive AND
 	// the new delta between value and threshold is *larger* then the old delta, we 
 	// found the threshold. If slope is negative, we just have a ripple in the DAC's 
 	// distribution:
 	if(positive_slope && !(delta_new < delta_old)) {        
-	  found.push_back(*pixit);    
+	  px_state.found = true;
 	  continue; 
 	}
 
 	// No threshold found yet, update the DAC threshold value for the pixel:
-	px->setValue(it->first);
-	// Update the oldvalue map:
-	oldvalue[*px] = static_cast<uint8_t>(pixit->value());
+	result[px_state.index].setValue(it->first);
+	// Update the stored efficiency:
+	px_state.oldvalue = static_cast<uint8_t>(pixit->value());
       }
       // Pixel is new, just adding it:
       else {
         // If the pixel is above threshold at first appearance, the respective
 	// DAC value is set as its threshold:
-	if(pixit->value() >= threshold) { found.push_back(*pixit); }
+	if(pixit->value() >= threshold) { px_state.found = true; }
 
 	// Store the pixel with original efficiency
-	oldvalue.insert(std::make_pair(*pixit,pixit->value()));
+	px_state.oldvalue = static_cast<uint8_t>(pixit->value());
 
 	// Push pixel to result vector with current DAC as value field:
 	pixit->setValue(it->first);
+	px_state.index = result.size();
 	result.push_back(*pixit);
       }
     }
@@ -1982,13 +2013,10 @@ std::vector<pixel> pxarCore::repackThresholdMapData (std::vector<Event> &data, u
 
   // Check for pixels that have not reached the threshold at all:
   for(std::vector<pixel>::iterator px = result.begin(); px != result.end(); ++px) {
-    std::vector<pixel>::iterator px_found = std::find_if(found.begin(),
-							 found.end(),
-							 findPixelXY(px->column(), px->row(), px->roc()));
-    // The pixel is in the "found" vector, which means it crossed threshold at some point:
-    if(px_found != found.end()) continue;
+    // The pixel crossed threshold at some point:
+    if(state[pixelIndex(px->roc(), px->column(), px->row())].found) continue;
 
-    // The pixel is not in and never reached the threshold. We set the return value to
+    // The pixel never reached the threshold. We set the return value to
     // "dacMax" (rising edge) or "dacMin" (falling edge):
     if((flags&FLAG_RISING_EDGE) != 0) { px->setValue(dacMax); }
     else { px->setValue(dacMin); }
@@ -2006,8 +2034,6 @@ std::vector<pixel> pxarCore::repackThresholdMapData (std::vector<Event> &data, u
 std::vector<std::pair<uint8_t,std::vector<pixel> > > pxarCore::repackThresholdDacScanData (std::vector<Event> &data, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max, uint8_t thresholdlevel, uint16_t nTriggers, uint16_t flags) {
 
   std::vector<std::pair<uint8_t,std::vector<pixel> > > result;
-  // Map of pixels with already assigned threshold (key is the dac2 value):
-  std::map<uint8_t,std::vector<pixel> > found;
 
   // Threshold is the the given efficiency level "thresholdlevel":
   // Using ceiling function to take higher threshold when in doubt.
@@ -2021,8 +2047,13 @@ std::vector<std::pair<uint8_t,std::vector<pixel> > > pxarCore::repackThresholdDa
   // First, pack the data as it would be a regular DacDac Scan:
   std::vector<std::pair<uint8_t,std::pair<uint8_t,std::vector<pixel> > > > packed_dacdac = repackDacDacScanData(data,dac1step,dac1min,dac1max,dac2step,dac2min,dac2max,flags);
 
-  // Efficiency map:
-  std::map<uint8_t,std::map<pixel,uint8_t> > oldvalue;  
+  // Position of every DAC2 value in the result vector (-1 if not yet seen):
+  std::vector<int32_t> dacpos(256,-1);
+  // Compact id of every pixel of the module, assigned at first appearance (-1 if not yet seen):
+  std::vector<int32_t> pxid(MOD_NUMROCS*ROC_NUMCOLS*ROC_NUMROWS,-1);
+  int32_t npx = 0;
+  // Threshold finding state for every DAC2 value (parallel to the result vector) and pixel id:
+  std::vector<std::vector<thresholdState> > state;
 
   // Then loop over all pixels and DAC settings, start from the back if we are looking for falling edge.
   // This ensures that we end up having the correct edge, even if the efficiency suddenly changes from 0 to max.
@@ -2037,81 +2068,81 @@ std::vector<std::pair<uint8_t,std::vector<pixel> > > pxarCore::repackThresholdDa
     // For every DAC/DAC entry, loop over all pixels:
     for(std::vector<pixel>::iterator pixit = it->second.second.begin(); pixit != it->second.second.end(); ++pixit) {
       
-      // Find the current DAC2 value in the result vector (simple replace for find_if):
-      std::vector<std::pair<uint8_t, std::vector<pixel> > >::iterator dac;
-      for(dac = result.begin(); dac != result.end(); ++dac) { if(it->second.first == dac->first) break; }
-
-      // Didn't find the DAC2 value:
-      if(dac == result.end()) {
+      // Find the current DAC2 value in the result vector:
+      if(dacpos[it->second.first] < 0) {
+	dacpos[it->second.first] = result.size();
 	result.push_back(std::make_pair(it->second.first,std::vector<pixel>()));
-	dac = result.end() - 1;
 	// Also add an entry for bookkeeping:
-	found.insert(std::make_pair(it->second.first,std::vector<pixel>()));
-	oldvalue.insert(std::make_pair(it->second.first,std::map<pixel,uint8_t>()));
+	state.push_back(std::vector<thresholdState>());
       }
-      
-      // Check if for this pixel a threshold has been found already and we can skip the rest:
-      std::vector<pixel>::iterator px_found = std::find_if(found[dac->first].begin(),
-							   found[dac->first].end(),
-							   findPixelXY(pixit->column(), pixit->row(), pixit->roc()));
-      if(px_found != found[dac->first].end()) continue;
+      std::pair<uint8_t, std::vector<pixel> > & dac = result[dacpos[it->second.first]];
+      std::vector<thresholdState> & dac_state = state[dacpos[it->second.first]];
+
+      if(pixit->column() >= ROC_NUMCOLS || pixit->row() >= ROC_NUMROWS) {
+	LOG(logWARNING) << "Skipping pixel with invalid address " << (*pixit);
+	continue;
+      }
+
+      // Look up the id of this pixel:
+      size_t idx = pixelIndex(pixit->roc(), pixit->column(), pixit->row());
+      if(idx >= pxid.size()) { pxid.resize(static_cast<size_t>(pixit->roc()+1)*ROC_NUMCOLS*ROC_NUMROWS,-1); }
+      if(pxid[idx] < 0) { pxid[idx] = npx++; }
+      if(static_cast<size_t>(pxid[idx]) >= dac_state.size()) { dac_state.resize(npx); }
+      thresholdState & px_state = dac_state[pxid[idx]];
 
-      // Check if we have that particular pixel already in:
-      std::vector<pixel>::iterator px = std::find_if(dac->second.begin(),
-						     dac->second.end(),
-						     findPixelXY(pixit->column(), pixit->row(), pixit->roc()));
+      // Check if for this pixel a threshold has been found already and we can skip the rest:
+      if(px_state.found) continue;
 
       // Pixel is known:
-      if(px != dac->second.end()) {
+      if(px_state.index >= 0) {
 	// Calculate efficiency deltas and slope:
-	uint8_t delta_old = abs(oldvalue[dac->first][*px] - threshold);
+	uint8_t delta_old = abs(px_state.oldvalue - threshold);
 	uint8_t delta_new = abs(static_cast<uint8_t>(pixit->value()) - threshold);
-	bool positive_slope = (static_cast<uint8_t>(pixit->value()) - oldvalue[dac->first][*px] > 0 ? true : false);
+	bool positive_slope = (static_cast<uint8_t>(pixit->value()) - px_state.oldvalue > 0 ? true : false);
 
         // Check which value is closer to the threshold. Only if the slope is positive AND
 	// the new delta between value and threshold is *larger* then the old delta, we 
 	// found the threshold. If slope is negative, we just have a ripple in the DAC's 
 	// distribution:
 	if(positive_slope && !(delta_new < delta_old)) {
-	  found[dac->first].push_back(*pixit);
+	  px_state.found = true;
 	  continue;
 	}
 
         // No threshold found yet, update the DAC threshold value for the pixel:
-	px->setValue(it->first);
-	// Update the oldvalue map:
-	oldvalue[dac->first][*px] = static_cast<uint8_t>(pixit->value());
+	dac.second[px_state.index].setValue(it->first);
+	// Update the stored efficiency:
+	px_state.oldvalue = static_cast<uint8_t>(pixit->value());
       }
       // Pixel is new, just adding it:
       else {
         // If the pixel is above threshold at first appearance, the respective
 	// DAC value is set as its threshold:
-	if(pixit->value() >= threshold) { found[dac->first].push_back(*pixit); }
+	if(pixit->value() >= threshold) { px_state.found = true; }
 
 	// Store the pixel with original efficiency
-	oldvalue[dac->first].insert(std::make_pair(*pixit,pixit->value()));
+	px_state.oldvalue = static_cast<uint8_t>(pixit->value());
 	// Push pixel to result vector with current DAC as value field:
 	pixit->setValue(it->first);
-	dac->second.push_back(*pixit);
+	px_state.index = dac.second.size();
+	dac.second.push_back(*pixit);
       }
     }
   }
 
   // Check for pixels that have not reached the threshold at all:
-  for(std::vector<std::pair<uint8_t,std::vector<pixel> > >::iterator dac = result.begin(); dac != result.end(); ++dac) {
+  for(size_t d = 0; d < result.size(); d++) {
+    std::pair<uint8_t, std::vector<pixel> > & dac = result[d];
     
-    for(std::vector<pixel>::iterator px = dac->second.begin(); px != dac->second.end(); px++) {
-      std::vector<pixel>::iterator px_found = std::find_if(found[dac->first].begin(),
-							   found[dac->first].end(),
-							   findPixelXY(px->column(), px->row(), px->roc()));
-      // The pixel is in the "found" vector, which means it crossed threshold at some point:
-      if(px_found != found[dac->first].end()) continue;
-
-      // The pixel is not in and never reached the threshold. We set the return value to
+    for(std::vector<pixel>::iterator px = dac.second.begin(); px != dac.second.end(); px++) {
+      // The pixel crossed threshold at some point:
+      if(state[d][pxid[pixelIndex(px->roc(), px->column(), px->row())]].found) continue;
+
+      // The pixel never reached the threshold. We set the return value to
       // "dacMax" (rising edge) or "dacMin" (falling edge):
       if((flags&FLAG_RISING_EDGE) != 0) { px->setValue(dac2max); }
       else { px->setValue(dac2min); }
-      LOG(logWARNING) << "No threshold found for " << (*px) << " at DAC value " << static_cast<int>(dac->first);
+      LOG(logWARNING) << "No threshold found for " << (*px) << " at DAC value " << static_cast<int>(dac.first);
     }
   }
 
@@ -2141,14 +2172,21 @@ std::vector< std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > pxar
 		   << "], data has " << data.size() << " entries.";
 
   // Prepare the result vector
+  size_t nDACs = static_cast<size_t>(((dac1max-dac1min)/dac1step+1)*((dac2max-dac2min)/dac2step+1));
+  result.reserve(nDACs);
   for(size_t dac1 = dac1min; dac1 <= dac1max; dac1 += dac1step) {
-    std::pair<uint8_t,std::vector<pixel> > dacpair;
     for(size_t dac2 = dac2min; dac2 <= dac2max; dac2 += dac2step) {
-      dacpair = std::make_pair(dac2,std::vector<pixel>());
-      result.push_back(std::make_pair(dac1,dacpair));
+      result.push_back(std::make_pair(dac1,std::make_pair(dac2,std::vector<pixel>())));
     }
   }
 
+  // With several rounds over the DAC ranges, size every DAC pair for all of its pixels:
+  if(data.size() > nDACs) {
+    std::vector<size_t> npixels(nDACs, 0);
+    for(size_t i = 0; i < data.size(); i++) { npixels[i%nDACs] += data[i].pixels.size(); }
+    for(size_t i = 0; i < nDACs; i++) { result[i].second.second.reserve(npixels[i]); }
+  }
+
   size_t current1dac = dac1min;
   size_t current2dac = dac2min;
 
@@ -2161,9 +2199,10 @@ std::vector< std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > pxar
     }
     if(current1dac > dac1max) { current1dac = dac1min; }
 
-    result.at((current1dac-dac1min)/dac1step*((dac2max-dac2min)/dac2step+1) + (current2dac-dac2min)/dac2step).second.second.insert(result.at((current1dac-dac1min)/dac1step*((dac2max-dac2min)/dac2step+1) + (current2dac-dac2min)/dac2step).second.second.end(),
-												       Eventit->pixels.begin(),
-												       Eventit->pixels.end());
+    // Add the pixels to the list, taking over the pixel vector of the first event:
+    std::vector<pixel> & pixels = result.at((current1dac-dac1min)/dac1step*((dac2max-dac2min)/dac2step+1) + (current2dac-dac2min)/dac2step).second.second;
+    if(pixels.empty() && pixels.capacity() == 0) { pixels.swap(Eventit->pixels); }
+    else { pixels.insert(pixels.end(), Eventit->pixels.begin(), Eventit->pixels.end()); }
     i++;
     current2dac += dac2step;
   }
@@ -2221,6 +2260,9 @@ void pxarCore::MaskAndTrim(bool trim, std::vector<rocConfig>::iterator rocit) {
 // Program the calibrate bits in ROC PUCs:
 void pxarCore::SetCalibrateBits(bool enable) {
 
+  // Send the settings of all ROCs in one RPC batch:
+  rpcBatch batch(_hal);
+
   // Run over all existing ROCs:
   for (std::vector<rocConfig>::iterator rocit = _dut->roc.begin(); rocit != _dut->roc.end(); ++rocit) {
 
@@ -2237,7 +2279,7 @@ void pxarCore::SetCalibrateBits(bool enable) {
       _hal->RocClearCalibrate(rocit->i2c_address);
     }
   }
-
+  batch.end();
 }
 
 void pxarCore::checkTestboardDelays(std::vector<std::pair<std::string,uint8_t> > sig_delays) {
@@ -2461,6 +2503,9 @@ void pxarCore::setReportingLevel(std::string logLevel)
 {
   LOG(logQUIET) << "Changing Reporting Level from " << Log::ToString(Log::ReportingLevel()) << " to " << logLevel;
   Log::ReportingLevel() = Log::FromString(logLevel);
+  if(Log::ReportingLevel() > LogLevelCompiled()) {
+    LOG(logWARNING) << "Messages above log level " << Log::ToString(LogLevelCompiled()) << " are not compiled in.";
+  }
 }
 
 std::string pxarCore::getReportingLevel()
@@ -100,6 +100,24 @@ typedef unsigned char uint8_t;
  */
 #define FLAG_ENABLE_XORSUM_LOGGING 0x1000
 
+/** Flag to prefetch DAQ data from the DTB in the background while the current data block
+ *  is decoded. Meant for long readout runs such as daqTriggerLoop(). The RPC calls of the
+ *  readers are serialized with all other testboard calls.
+ */
+#define FLAG_DAQ_PREFETCH 0x2000
+
+/** Flag to pipeline the test loops: the data of each loop segment is copied off the DTB and
+ *  decoded in the background while the DTB already runs the next segment. Speeds up tests
+ *  with large data volumes, which are interrupted to read out the DTB memory several times.
+ */
+#define FLAG_PIPELINED_LOOPS 0x4000
+
+/** Flag to decode the channels of multi-channel modules in parallel, one thread per DAQ
+ *  channel, when reading events with daqGetEventBuffer(), daqProcessEvents() or
+ *  daqGetEventBatch(). Only used if the machine has more than one core.
+ */
+#define FLAG_PARALLEL_DECODING 0x8000
+
 
 /** Define a macro for calls to member functions through pointers 
  *  to member functions (used in the loop expansion routines).
@@ -794,6 +812,8 @@ namespace pxar {
     /** Function to return the full currently available raw data buffer from the
      *  testboard RAM. Neither decoding nor splitting is performed, this function
      *  returns the raw data blob from either of the deserializer modules.
+     *  Data already read from the testboard by a previous event readout but not
+     *  split into events yet is returned first.
      *
      *  If no data is available the function will throw a pxar::DataNoEvent
      *  exception. Catching this allows constant polling for new data.
@@ -812,6 +832,34 @@ namespace pxar {
      */
     std::vector<Event> daqGetEventBuffer();
 
+    /** Function to process the full currently available pxar::Event buffer from
+     *  the testboard RAM without storing it. Every decoded pxar::Event is handed
+     *  to the visitor as soon as it leaves the decoder, so the memory used does
+     *  not grow with the amount of data in the buffer. The function returns the
+     *  number of events processed.
+     *
+     *  This function can throw a pxar::DataDecodingError exception in case severe
+     *  problems were encountered during the readout.
+     *
+     *  If no events are available the function will throw a pxar::DataNoEvent
+     *  exception. Catching this allows constant polling for new events.
+     */
+    size_t daqProcessEvents(eventVisitor & visitor);
+
+    /** Function to read the full currently available pxar::Event buffer from
+     *  the testboard RAM into a pxar::eventBatch, which stores the pixels of
+     *  all events in contiguous columns. The batch is cleared first and its
+     *  memory is reused, so reading into the same batch repeatedly does not
+     *  allocate. The function returns the number of events read.
+     *
+     *  This function can throw a pxar::DataDecodingError exception in case severe
+     *  problems were encountered during the readout.
+     *
+     *  If no events are available the function will throw a pxar::DataNoEvent
+     *  exception. Catching this allows constant polling for new events.
+     */
+    size_t daqGetEventBatch(eventBatch & batch);
+
     /** Function to return the full currently available ROC slow readback value
      *  buffer. The data is stored until a new DAQ session or test is called and
      *  can be fetched once (deleted at read time). The return vector contains
@@ -845,14 +893,31 @@ namespace pxar {
      *  If you fetch your data via pxarCore::daqGetRawEvent() or
      *  pxarCore::daqGetRawEventBuffer() the statistics object will remain empty
      *  because the data has not been passed through the decoder. If you run
-     *  pxarCore::daqGetEvent() or pxarCore::daqGetEventBuffer() the statistics
-     *  object will be properly filled. Events will continue to be added to
+     *  pxarCore::daqGetEvent(), pxarCore::daqGetEventBuffer() or
+     *  pxarCore::daqProcessEvents() the statistics object will be properly filled. Events will continue to be added to
      *  these numbers until you either read them out (reading statistics resets
      *  the counters) or you re-started a new DAQ session (pxarCore::daqStart()
      *  initialises the counters to zero).
      */
     statistics getStatistics();
 
+    /** Function that returns the live decoding statistics of the running DAQ
+     *  session, one pxar::statistics object per DAQ channel.
+     *
+     *  Unlike pxarCore::getStatistics() this does not reset any counters, the
+     *  numbers cover everything decoded since pxarCore::daqStart(). It can be
+     *  called at any rate and from any thread, e.g. while
+     *  pxarCore::daqTriggerLoop() is running, without disturbing the readout.
+     *  The decoders publish their counters every few events, so the numbers
+     *  may lag slightly behind.
+     *
+     *  Besides the counters the objects carry the session duration, giving
+     *  the rates statistics::rate_words_read(), statistics::rate_events() and
+     *  statistics::rate_errors() and friends, as well as the highest DTB buffer
+     *  fill level in percent seen by pxarCore::daqStatus() so far.
+     */
+    std::vector<statistics> getLiveStatistics();
+
     /** DUT object for book keeping of settings
      */
     dut * _dut;
@@ -1005,6 +1070,35 @@ namespace pxar {
   }; // class pxarCore
 
 
+  /** Snapshot of the enabled ROCs and pixels of the DUT as used to expand the
+   *  test loops. The DUT keeps one and recomputes it only after its
+   *  configuration has changed.
+   */
+  struct DLLEXPORT dutSnapshot {
+  dutSnapshot() : version(0), rocIds(), rocI2C(), pixels(), identicalPixels(true), allPixels(false) {}
+
+    /** Configuration version of the DUT the snapshot was taken from
+     */
+    uint32_t version;
+
+    /** IDs and I2C addresses of the enabled ROCs
+     */
+    std::vector<uint8_t> rocIds;
+    std::vector<uint8_t> rocI2C;
+
+    /** Enabled pixels of every enabled ROC, in the order of rocIds
+     */
+    std::vector< std::vector<pixelConfig> > pixels;
+
+    /** True if all enabled ROCs have the same pixels enabled
+     */
+    bool identicalPixels;
+
+    /** True if all pixels are enabled, see dut::getAllPixelEnable()
+     */
+    bool allPixels;
+  };
+
   class DLLEXPORT dut {
     
     /** Allow the API class to access private members of the DUT - noone else
@@ -1017,7 +1111,8 @@ namespace pxar {
     /** Default DUT constructor
      */
     dut() : _initialized(false), _programmed(false), roc(), tbm(), sig_delays(),
-      va(0), vd(0), ia(0), id(0), pg_setup(), pg_sum(0), trigger_source(TRG_SEL_PG_DIR) {}
+      va(0), vd(0), ia(0), id(0), pg_setup(), pg_sum(0), trigger_source(TRG_SEL_PG_DIR),
+      _version(1), _snapshot() {}
 
     // GET functions to read information
 
@@ -1246,6 +1341,20 @@ namespace pxar {
      */
     uint16_t trigger_source;
 
+    /** Version of the ROC and pixel configuration, to be increased by every
+     *  function changing the enable, mask or trim settings
+     */
+    uint32_t _version;
+
+    /** Snapshot of the enabled ROCs and pixels, see getSnapshot()
+     */
+    dutSnapshot _snapshot;
+
+    /** Function returning the snapshot of the enabled ROCs and pixels, it is
+     *  only recomputed if the configuration version changed since
+     */
+    const dutSnapshot & getSnapshot();
+
   }; //class DUT
 
 } //namespace pxar
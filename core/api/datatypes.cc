@@ -7,6 +7,91 @@
 namespace pxar {
 
 
+  // Lookup tables for the pixel address decoding, indexed by the 15 address
+  // bits 9-23 of the raw pixel data. Every entry holds the row in the low and
+  // the column in the high byte, exactly as the arithmetic decoding yields them:
+  struct pixelAddressTable {
+    std::vector<uint16_t> dig;
+    std::vector<uint16_t> linear;
+
+    pixelAddressTable() : dig(0x8000), linear(0x8000) {
+      for(uint32_t index = 0; index < 0x8000; index++) {
+	uint32_t raw = index << 9;
+
+	// PSI46dig encoding, the inverted address is looked up with the row bits flipped:
+	int r = ((raw >> 15) & 7)*36 + ((raw >> 12) & 7)*6 + ((raw >> 9) & 7);
+	uint8_t row = static_cast<uint8_t>(80 - r/2);
+	uint8_t column = static_cast<uint8_t>(2*(((raw >> 21) & 7)*6 + ((raw >> 18) & 7)) + (r&1));
+	dig[index] = static_cast<uint16_t>(row | (column << 8));
+
+	// Linear address space:
+	column = static_cast<uint8_t>(((raw >> 17) & 0x07) + ((raw >> 18) & 0x38));
+	row = static_cast<uint8_t>(((raw >> 9) & 0x07) + ((raw >> 10) & 0x78));
+	linear[index] = static_cast<uint16_t>(row | (column << 8));
+      }
+    }
+  };
+
+  static const pixelAddressTable & addressTable() {
+    static const pixelAddressTable table;
+    return table;
+  }
+
+  pixel::decodeStatus pixel::decode(uint32_t raw, uint8_t rocid, bool invert, bool linear) {
+    _roc_id = rocid;
+    _variance = 0;
+
+    // Get the pulse height:
+    _mean = static_cast<int16_t>((raw & 0x0f) + ((raw >> 1) & 0xf0));
+    if((raw & 0x10) > 0) return DECODE_INVALID_PULSEHEIGHT;
+
+    // Decode the pixel address:
+    uint32_t index = (raw >> 9) & 0x7fff;
+    uint16_t address;
+    if(linear) {
+      // Check the fill bits:
+      if((raw & 0x1000) > 0 || (raw & 0x100000) > 0) return DECODE_INVALID_ADDRESS;
+      address = addressTable().linear[index];
+    }
+    else {
+      if(invert) { index ^= 0x1ff; }
+      address = addressTable().dig[index];
+    }
+    _row = static_cast<uint8_t>(address & 0xff);
+    _column = static_cast<uint8_t>(address >> 8);
+
+    // Perform range checks:
+    if(_row >= ROC_NUMROWS || _column >= ROC_NUMCOLS) {
+      if(_row == ROC_NUMROWS) return DECODE_CORRUPT_BUFFER;
+      else return DECODE_INVALID_ADDRESS;
+    }
+    return DECODE_OK;
+  }
+
+  pixel::decodeStatus pixel::decode(const uint16_t * analog, uint8_t rocid, int16_t black, const uint8_t * levels) {
+    _roc_id = rocid;
+    _variance = 0;
+
+    // Get the pulse height:
+    _mean = static_cast<int16_t>(expandSign(analog[5] & 0x0fff) - black);
+
+    // Decode the pixel address:
+    int c = levels[analog[0] & 0x0fff]*6 + levels[analog[1] & 0x0fff];
+    int r = (levels[analog[2] & 0x0fff]*6 + levels[analog[3] & 0x0fff])*6 + levels[analog[4] & 0x0fff];
+    _row = static_cast<uint8_t>(80 - r/2);
+    _column = static_cast<uint8_t>(2*c + (r&1));
+
+    // Perform range checks:
+    if(_row >= ROC_NUMROWS || _column >= ROC_NUMCOLS) return DECODE_INVALID_ADDRESS;
+    return DECODE_OK;
+  }
+
+  void pixel::analogLevels(int16_t ultrablack, int16_t black, uint8_t * levels) {
+    // Same levels as calculated by decodeAnalog:
+    int16_t level1 = (black - ultrablack)/4;
+    for(uint16_t x = 0; x < 0x1000; x++) { levels[x] = translateLevel(x,black,level1,level1/2); }
+  }
+
   void pixel::decodeRaw(uint32_t raw, bool invert) {
     // Get the pulse height:
     setValue(static_cast<double>((raw & 0x0f) + ((raw >> 1) & 0xf0)));
@@ -154,6 +239,113 @@ namespace pxar {
     return out;
   }
 
+  void eventBatch::clear() {
+    m_roc.clear(); m_column.clear(); m_row.clear(); m_value.clear();
+    m_header.clear(); m_trailer.clear();
+    m_pixelOffset.resize(1); m_headerOffset.resize(1); m_trailerOffset.resize(1);
+  }
+
+  void eventBatch::reserve(size_t events, size_t pixels) {
+    m_roc.reserve(pixels); m_column.reserve(pixels); m_row.reserve(pixels); m_value.reserve(pixels);
+    m_pixelOffset.reserve(events + 1);
+    m_headerOffset.reserve(events + 1);
+    m_trailerOffset.reserve(events + 1);
+  }
+
+  void eventBatch::append(const Event & evt) {
+    for(std::vector<pixel>::const_iterator px = evt.pixels.begin(); px != evt.pixels.end(); ++px) {
+      m_roc.push_back(px->roc());
+      m_column.push_back(px->column());
+      m_row.push_back(px->row());
+      m_value.push_back(static_cast<int16_t>(px->value()));
+    }
+    m_header.insert(m_header.end(), evt.header.begin(), evt.header.end());
+    m_trailer.insert(m_trailer.end(), evt.trailer.begin(), evt.trailer.end());
+  }
+
+  void eventBatch::close() {
+    m_pixelOffset.push_back(m_roc.size());
+    m_headerOffset.push_back(m_header.size());
+    m_trailerOffset.push_back(m_trailer.size());
+  }
+
+  void eventBatch::discard() {
+    size_t pixels = m_pixelOffset.back();
+    m_roc.resize(pixels); m_column.resize(pixels); m_row.resize(pixels); m_value.resize(pixels);
+    m_header.resize(m_headerOffset.back());
+    m_trailer.resize(m_trailerOffset.back());
+  }
+
+  std::vector<uint8_t> eventBatch::triggerCounts(size_t i) const {
+    std::vector<uint8_t> counts;
+    for(size_t h = m_headerOffset[i]; h < headerEnd(i); h++) { counts.push_back((m_header[h] >> 8) & 0xff); }
+    return counts;
+  }
+
+  bool eventBatch::equalTriggerCounts(size_t i) const {
+    for(size_t h = m_headerOffset[i]; h < headerEnd(i); h++) {
+      if(((m_header[h] ^ m_header[m_headerOffset[i]]) & 0xff00) != 0) return false;
+    }
+    return true;
+  }
+
+  Event eventBatch::getEvent(size_t i) const {
+    Event evt;
+    evt.pixels.reserve(pixelEnd(i) - pixelBegin(i));
+    for(size_t px = pixelBegin(i); px < pixelEnd(i); px++) { evt.pixels.push_back(getPixel(px)); }
+    evt.header.assign(m_header.begin() + m_headerOffset[i], m_header.begin() + m_headerOffset[i+1]);
+    evt.trailer.assign(m_trailer.begin() + m_trailerOffset[i], m_trailer.begin() + m_trailerOffset[i+1]);
+    return evt;
+  }
+
+  void rawEventArena::reserve(size_t words) {
+    if(!m_slab || m_slab->capacity() - m_slab->size() < words) { grow(words); }
+  }
+
+  void rawEventArena::grow(size_t words) {
+    size_t capacity = openSize() + words;
+    std::shared_ptr<std::vector<uint16_t> > slab(new std::vector<uint16_t>());
+    slab->reserve(capacity > m_slabsize ? capacity : m_slabsize);
+    // Move the open record over, the words of closed records stay with the old slab:
+    if(m_slab) { slab->assign(m_slab->begin() + m_open, m_slab->end()); }
+    m_slab = slab;
+    m_open = 0;
+    m_slabs++;
+  }
+
+  void rawEventArena::append(const rawEvent & record) {
+    // Never reallocate a slab, the closed records point into it:
+    reserve(record.GetSize());
+    size_t first = m_slab->size();
+    m_slab->insert(m_slab->end(), record.begin(), record.end());
+    record.ApplyHeaderTag(*m_slab, first);
+    m_flags |= record.flags;
+  }
+
+  rawEvent rawEventArena::close() {
+    rawEvent record;
+    record.flags = m_flags;
+    if(openSize() > 0) {
+      record.view_begin = &(*m_slab)[0] + m_open;
+      record.view_end = &(*m_slab)[0] + m_slab->size();
+      record.slab = m_slab;
+      m_open = m_slab->size();
+    }
+    m_flags = 0;
+    return record;
+  }
+
+  void rawEventArena::discard() {
+    if(m_slab) { m_slab->resize(m_open); }
+    m_flags = 0;
+  }
+
+  void rawEventArena::clear() {
+    m_slab.reset();
+    m_open = 0;
+    m_flags = 0;
+  }
+
   std::vector<uint8_t> Event::triggerCounts() {
     std::vector<uint8_t> counts;
     for(size_t i = 0; i < this->header.size(); i++) {
@@ -327,6 +519,13 @@ namespace pxar {
     LOG(logINFO) << "\t pixel address:            " << this->errors_pixel_address();
     LOG(logINFO) << "\t pulse height fill bit:    " << this->errors_pixel_pulseheight();
     LOG(logINFO) << "\t buffer corruption:        " << this->errors_pixel_buffer_corrupt();
+    if(m_info_duration > 0) {
+      LOG(logINFO) << "  Live rates over " << m_info_duration << "ms:";
+      LOG(logINFO) << "\t 16bit words per second:   " << this->rate_words_read();
+      LOG(logINFO) << "\t events per second:        " << this->rate_events();
+      LOG(logINFO) << "\t errors per second:        " << this->rate_errors();
+      LOG(logINFO) << "\t max. DTB buffer fill:     " << static_cast<int>(this->info_buffer_fill_max()) << "%";
+    }
   }
 
   void statistics::clear() {
@@ -355,6 +554,60 @@ namespace pxar {
     m_errors_pixel_address = 0;
     m_errors_pixel_pulseheight = 0;
     m_errors_pixel_buffer_corrupt = 0;
+
+    m_info_duration = 0;
+    m_info_buffer_fill_max = 0;
+  }
+
+  pixelConfig * rocConfig::findPixel(uint8_t column, uint8_t row) {
+
+    if(column >= ROC_NUMCOLS || row >= ROC_NUMROWS) return NULL;
+    checkIndex();
+
+    int16_t position = _index[column*ROC_NUMROWS + row];
+    if(position >= 0) {
+      pixelConfig & px = pixels[position];
+      if(px.column() == column && px.row() == row) return &px;
+      // The pixels have been reordered, index them again:
+      updateIndex();
+      position = _index[column*ROC_NUMROWS + row];
+    }
+    return (position >= 0 ? &pixels[position] : NULL);
+  }
+
+  void rocConfig::setPixelEnable(pixelConfig & px, bool enable) {
+    checkIndex();
+    if(px.enable() != enable) {
+      if(enable) _nenabled++;
+      else _nenabled--;
+    }
+    px.setEnable(enable);
+  }
+
+  void rocConfig::setPixelMask(pixelConfig & px, bool mask) {
+    checkIndex();
+    if(px.mask() != mask) {
+      if(mask) _nmasked++;
+      else _nmasked--;
+    }
+    px.setMask(mask);
+  }
+
+  void rocConfig::updateIndex() {
+
+    _index.assign(ROC_NUMCOLS*ROC_NUMROWS, -1);
+    _nenabled = 0;
+    _nmasked = 0;
+    for(size_t i = 0; i < pixels.size(); i++) {
+      if(pixels[i].column() < ROC_NUMCOLS && pixels[i].row() < ROC_NUMROWS) {
+	// Keep the first entry of duplicated pixels, as the linear search did:
+	int16_t & position = _index[pixels[i].column()*ROC_NUMROWS + pixels[i].row()];
+	if(position < 0) position = static_cast<int16_t>(i);
+      }
+      if(pixels[i].enable()) _nenabled++;
+      if(pixels[i].mask()) _nmasked++;
+    }
+    _indexed = pixels.size();
   }
 
   tbmConfig::tbmConfig(uint8_t tbmtype) : dacs(), type(tbmtype), hubid(31), core(0xE0), tokenchains(), enable(true) {
@@ -22,6 +22,11 @@ typedef unsigned char uint8_t;
 #include <map>
 #include <limits>
 #include <cmath>
+#include <stdexcept>
+#include <iterator>
+#include <cstddef>
+#include <memory>
+#include <utility>
 
 #include "constants.h"
 
@@ -42,14 +47,44 @@ namespace pxar {
 
     /** Constructor for pixel objects with rawdata pixel address & value and ROC id initialization.
      */
-  pixel(uint32_t rawdata, uint8_t rocid, bool invertAddress = false, bool linearAddress = false) : _roc_id(rocid) {
+  pixel(uint32_t rawdata, uint8_t rocid, bool invertAddress = false, bool linearAddress = false) : _roc_id(rocid), _variance(0) {
       if(linearAddress) { decodeLinear(rawdata); }
       else { decodeRaw(rawdata,invertAddress); }
     }
 
     /** Constructor for pixel objects with analog levels data, ultrablack & black levels and ROC id initialization.
      */
-  pixel(std::vector<uint16_t> analogdata, uint8_t rocid, int16_t ultrablack, int16_t black) : _roc_id(rocid) { decodeAnalog(analogdata,ultrablack,black); }
+  pixel(std::vector<uint16_t> analogdata, uint8_t rocid, int16_t ultrablack, int16_t black) : _roc_id(rocid), _variance(0) { decodeAnalog(analogdata,ultrablack,black); }
+
+    /** Status codes of the non-throwing pixel decoding
+     */
+    enum decodeStatus {
+      DECODE_OK = 0,
+      DECODE_INVALID_PULSEHEIGHT,
+      DECODE_INVALID_ADDRESS,
+      DECODE_CORRUPT_BUFFER
+    };
+
+    /** Decoding function for PSI46dig raw ROC data which does not throw but
+     *  returns the status of the decoding instead. The address is translated
+     *  via lookup tables for the PSI46dig encoding, inverted address or
+     *  linear address space. The checks and their order are the same as in
+     *  the decoding constructor, which throws the corresponding exceptions.
+     */
+    decodeStatus decode(uint32_t rawdata, uint8_t rocid, bool invertAddress = false, bool linearAddress = false);
+
+    /** Decoding function for the six ADC words of an analog pixel hit which does
+     *  not throw but returns the status of the decoding instead. The address
+     *  levels are looked up in a table filled by analogLevels() for the current
+     *  ultrablack and black levels. The result is the same as from the analog
+     *  decoding constructor.
+     */
+    decodeStatus decode(const uint16_t * analogdata, uint8_t rocid, int16_t black, const uint8_t * levels);
+
+    /** Fill the table of address levels for all 4096 ADC values, as used by the
+     *  analog decoding for the given ultrablack and black levels
+     */
+    static void analogLevels(int16_t ultrablack, int16_t black, uint8_t * levels);
 
     /** Getter function to return ROC ID
      */
@@ -85,7 +120,7 @@ namespace pxar {
 
     /** Member function to get the value stored for this pixel hit
      */
-    double value() { 
+    double value() const { 
       return static_cast<double>(_mean);
     };
 
@@ -172,7 +207,7 @@ namespace pxar {
 
     /** Helper function to translate ADC values into address levels
      */
-    uint8_t translateLevel(uint16_t x, int16_t level0, int16_t level1, int16_t levelS);
+    static uint8_t translateLevel(uint16_t x, int16_t level0, int16_t level1, int16_t levelS);
 
     /** Helper function to compress double input value into
      *  a 16bit fixed-width integer for storage
@@ -208,6 +243,9 @@ namespace pxar {
     header = evt.header;
     trailer = evt.trailer;
   }
+  Event(Event &&evt) noexcept : pixels(std::move(evt.pixels)), header(std::move(evt.header)), trailer(std::move(evt.trailer)) {}
+  Event & operator=(const Event &evt) = default;
+  Event & operator=(Event &&evt) noexcept = default;
 
     /** Helper function to clear the event content
      */
@@ -355,6 +393,174 @@ namespace pxar {
     /** Overloaded ostream operator for simple printing of Event data
      */
     friend std::ostream & operator<<(std::ostream &out, Event& evt);
+
+    /** The event batch stores and restores headers and trailers directly
+     */
+    friend class eventBatch;
+  };
+
+  /** Class to store a run of decoded Events as contiguous columns (structure
+   *  of arrays) of pixel ROC ids, columns, rows and values, with the offsets
+   *  of every Event into the columns. Headers and trailers are kept the same way.
+   *
+   *  Clearing the batch keeps its memory, so a batch reused for every readout
+   *  does not allocate once it has grown to the size of the data. Pixels are
+   *  accessed by their index, the pixels of Event i are found in the range
+   *  [pixelBegin(i), pixelEnd(i)). For code working on pxar::Event objects the
+   *  batch provides iterators which assemble the Events on access.
+   */
+  class DLLEXPORT eventBatch {
+  public:
+  eventBatch() : m_roc(), m_column(), m_row(), m_value(), m_header(), m_trailer(), m_pixelOffset(1,0), m_headerOffset(1,0), m_trailerOffset(1,0) {}
+
+    /** Number of Events stored
+     */
+    size_t size() const { return m_pixelOffset.size() - 1; }
+    bool empty() const { return size() == 0; }
+
+    /** Number of pixels stored in all Events
+     */
+    size_t pixelCount() const { return m_pixelOffset.back(); }
+
+    /** Remove all Events, the memory is kept for reuse
+     */
+    void clear();
+
+    /** Reserve memory for the given number of Events and pixels
+     */
+    void reserve(size_t events, size_t pixels);
+
+    /** Add the pixels, headers and trailers of the Event to the currently
+     *  open Event. This allows merging several readout channels into one
+     *  Event without assembling it first.
+     */
+    void append(const Event & evt);
+
+    /** Close the open Event, it is stored as next Event of the batch
+     */
+    void close();
+
+    /** Drop all data added to the open Event since the last close()
+     */
+    void discard();
+
+    /** Store a full Event
+     */
+    void push_back(const Event & evt) { append(evt); close(); }
+
+    /** Pixel index range of Event i
+     */
+    size_t pixelBegin(size_t i) const { return m_pixelOffset[i]; }
+    size_t pixelEnd(size_t i) const { return m_pixelOffset[i+1]; }
+
+    /** Access to the pixel columns by pixel index
+     */
+    uint8_t roc(size_t pix) const { return m_roc[pix]; }
+    uint8_t column(size_t pix) const { return m_column[pix]; }
+    uint8_t row(size_t pix) const { return m_row[pix]; }
+    double value(size_t pix) const { return static_cast<double>(m_value[pix]); }
+    pixel getPixel(size_t pix) const { return pixel(m_roc[pix], m_column[pix], m_row[pix], value(pix)); }
+
+    /** Number of TBM headers/trailers and their values for Event i
+     */
+    size_t headerCount(size_t i) const { return m_headerOffset[i+1] - m_headerOffset[i]; }
+    uint16_t getHeader(size_t i, uint8_t core = 0) const { return (core < headerCount(i) ? m_header[m_headerOffset[i] + core] : 0); }
+    size_t trailerCount(size_t i) const { return m_trailerOffset[i+1] - m_trailerOffset[i]; }
+    uint16_t getTrailer(size_t i, uint8_t core = 0) const { return (core < trailerCount(i) ? m_trailer[m_trailerOffset[i] + core] : 0); }
+
+    /** Trigger counts of all TBM cores of Event i as in Event::triggerCounts().
+     *  The index size() refers to the open Event.
+     */
+    std::vector<uint8_t> triggerCounts(size_t i) const;
+
+    /** Check whether all TBM cores of Event i report the same trigger count,
+     *  the index size() refers to the open Event.
+     */
+    bool equalTriggerCounts(size_t i) const;
+
+    /** Assemble Event i as pxar::Event
+     */
+    Event getEvent(size_t i) const;
+
+    /** Iterator over the Events of the batch. The Event is assembled when the
+     *  iterator is dereferenced and kept until the iterator moves on.
+     */
+    class const_iterator {
+    public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef Event value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef Event* pointer;
+      typedef Event& reference;
+
+    const_iterator() : m_batch(NULL), m_index(0), m_event(), m_loaded(false) {}
+    const_iterator(const eventBatch * batch, size_t index) : m_batch(batch), m_index(index), m_event(), m_loaded(false) {}
+      Event & operator*() const { load(); return m_event; }
+      Event * operator->() const { load(); return &m_event; }
+      const_iterator & operator++() { m_index++; m_loaded = false; return *this; }
+      const_iterator operator++(int) { const_iterator tmp(m_batch, m_index); ++(*this); return tmp; }
+      bool operator==(const const_iterator & rhs) const { return m_index == rhs.m_index; }
+      bool operator!=(const const_iterator & rhs) const { return m_index != rhs.m_index; }
+      size_t index() const { return m_index; }
+    private:
+      void load() const { if(!m_loaded) { m_event = m_batch->getEvent(m_index); m_loaded = true; } }
+      const eventBatch * m_batch;
+      size_t m_index;
+      mutable Event m_event;
+      mutable bool m_loaded;
+    };
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+  private:
+    /** Pixel columns
+     */
+    std::vector<uint8_t> m_roc;
+    std::vector<uint8_t> m_column;
+    std::vector<uint8_t> m_row;
+    std::vector<int16_t> m_value;
+
+    /** TBM headers and trailers of all Events
+     */
+    std::vector<uint16_t> m_header;
+    std::vector<uint16_t> m_trailer;
+
+    /** Start offsets of every Event into the columns, the last entry marks
+     *  the start of the open Event
+     */
+    std::vector<size_t> m_pixelOffset;
+    std::vector<size_t> m_headerOffset;
+    std::vector<size_t> m_trailerOffset;
+
+    /** End of the header range of Event i, including the open Event
+     */
+    size_t headerEnd(size_t i) const { return (i + 1 < m_headerOffset.size() ? m_headerOffset[i+1] : m_header.size()); }
+  };
+
+  /** Interface for consumers of the streaming DAQ readout in
+   *  pxarCore::daqProcessEvents(). Every decoded pxar::Event is handed to
+   *  processEvent() once all channels have been merged. The reference is only
+   *  valid during the call, the visitor may modify the Event.
+   */
+  class DLLEXPORT eventVisitor {
+  public:
+    virtual ~eventVisitor() {}
+    virtual void processEvent(Event & evt) = 0;
+  };
+
+  /** Adapter forwarding the events of pxarCore::daqProcessEvents() to a member
+   *  function of the consumer, e.g.
+   *    eventCallback<MyTest> visitor(this, &MyTest::fillEvent);
+   */
+  template <class T>
+    class eventCallback : public eventVisitor {
+  public:
+  eventCallback(T * object, void (T::*function)(Event &)) : m_object(object), m_function(function) {}
+    void processEvent(Event & evt) { (m_object->*m_function)(evt); }
+  private:
+    T * m_object;
+    void (T::*m_function)(Event &);
   };
 
 
@@ -364,22 +570,95 @@ namespace pxar {
    */
   class DLLEXPORT rawEvent {
   public:
-  rawEvent() : data(), flags(0) {}
+  rawEvent() : data(), flags(0), view_begin(NULL), view_end(NULL), head_tag(0), slab() {}
+    /** Copying a record yields a record owning its data, also when the original
+     *  is a view into an external data block. Only records stored in a
+     *  rawEventArena share the arena storage when copied:
+     */
+  rawEvent(const rawEvent &rhs) : data(), flags(rhs.flags), view_begin(NULL), view_end(NULL), head_tag(0), slab(rhs.slab) {
+      if(slab) { view_begin = rhs.view_begin; view_end = rhs.view_end; head_tag = rhs.head_tag; }
+      else { data.assign(rhs.begin(), rhs.end()); rhs.ApplyHeaderTag(data, 0); }
+    }
+    rawEvent& operator=(const rawEvent &rhs) {
+      if(this != &rhs) {
+	std::vector<uint16_t> tmp;
+	uint16_t tag = 0;
+	if(rhs.slab) { view_begin = rhs.view_begin; view_end = rhs.view_end; tag = rhs.head_tag; }
+	else {
+	  tmp.assign(rhs.begin(), rhs.end());
+	  rhs.ApplyHeaderTag(tmp, 0);
+	  view_begin = view_end = NULL;
+	}
+	data.swap(tmp);
+	flags = rhs.flags;
+	head_tag = tag;
+	slab = rhs.slab;
+      }
+      return *this;
+    }
     void SetStartError() { flags |= 1; }
     void SetEndError()   { flags |= 2; }
     void SetOverflow()   { flags |= 4; }
     void ResetStartError() { flags &= static_cast<unsigned int>(~1); }
     void ResetEndError()   { flags &= static_cast<unsigned int>(~2); }
     void ResetOverflow()   { flags &= static_cast<unsigned int>(~4); }
-    void Clear() { flags = 0; data.clear(); }
+    void Clear() { flags = 0; data.clear(); view_begin = view_end = NULL; head_tag = 0; slab.reset(); }
     bool IsStartError() { return (flags & 1) != 0; }
     bool IsEndError()   { return (flags & 2) != 0; }
     bool IsOverflow()   { return (flags & 4) != 0; }
 	
-    size_t GetSize() { return data.size(); }
-    void Add(uint16_t value) { data.push_back(value); }
-    uint16_t operator[](size_t index) { return data.at(index); }
+    size_t GetSize() const { return (view_begin ? static_cast<size_t>(view_end - view_begin) : data.size()); }
+    void Add(uint16_t value) { if(view_begin) { Detach(); } data.push_back(value); }
+    uint16_t operator[](size_t index) {
+      if(index >= GetSize()) { throw std::out_of_range("rawEvent: index out of range"); }
+      return (index == 0 ? static_cast<uint16_t>(begin()[0] | head_tag) : begin()[index]);
+    }
+
+    /** Let the record refer to the data words [first,last) of an external data block
+     *  instead of holding a copy. The block has to stay untouched as long as the
+     *  record is in use, copies of the record always own their data.
+     */
+    void SetView(uint16_t * first, uint16_t * last) {
+      if(first != view_begin) { head_tag = 0; }
+      view_begin = first; view_end = last;
+      if(slab) { slab.reset(); }
+    }
+
+    /** Bits to be set in the first data word of a view, e.g. the DAQ channel in
+     *  the TBM header. The external block is not modified, the bits are set in
+     *  every copy of the words and by operator[].
+     */
+    void SetHeaderTag(uint16_t bits) { if(view_begin) { head_tag = bits; } else if(!data.empty()) { data[0] |= bits; } }
+
+    /** Returns true if the record refers to an external data block
+     */
+    bool IsView() const { return (view_begin != NULL); }
+
+    /** Copy the data words of a view into the record's own storage
+     */
+    void Detach() {
+      if(!view_begin) return;
+      std::vector<uint16_t> tmp(view_begin, view_end);
+      ApplyHeaderTag(tmp, 0);
+      data.swap(tmp);
+      view_begin = view_end = NULL;
+      head_tag = 0;
+      slab.reset();
+    }
 
+    /** Access to the data words of the record, independent of whether it holds a
+     *  copy or refers to an external data block:
+     */
+    uint16_t * begin() { return (view_begin ? view_begin : (data.empty() ? NULL : &data[0])); }
+    uint16_t * end() { return (view_begin ? view_end : (data.empty() ? NULL : &data[0] + data.size())); }
+    const uint16_t * begin() const { return (view_begin ? view_begin : (data.empty() ? NULL : &data[0])); }
+    const uint16_t * end() const { return (view_begin ? view_end : (data.empty() ? NULL : &data[0] + data.size())); }
+
+    /** Data words owned by the record. Records returned by the pxarCore API
+     *  always own their data. Inside the data pipes records may refer to the
+     *  readout buffer and records stored in a rawEventArena to the arena
+     *  instead, use begin() and end() there.
+     */
     std::vector<uint16_t> data;
 
   private:
@@ -390,11 +669,31 @@ namespace pxar {
     */
     unsigned int flags;
 
+    /** Data block range the record refers to, NULL if the record owns its data
+     */
+    uint16_t * view_begin;
+    uint16_t * view_end;
+
+    /** Header bits of a view not present in the external block, see SetHeaderTag()
+     */
+    uint16_t head_tag;
+    void ApplyHeaderTag(std::vector<uint16_t> & words, size_t first) const {
+      if(head_tag && first < words.size()) { words[first] |= head_tag; }
+    }
+
+    /** Arena slab holding the data words the view refers to, if any
+     */
+    std::shared_ptr<std::vector<uint16_t> > slab;
+    friend class rawEventArena;
+
     /** Overloaded sum operator for adding up data from different events
      */
     friend rawEvent& operator+=(rawEvent &lhs, const rawEvent &rhs) {
       // Add the raw data:
-      lhs.data.insert(lhs.data.end(), rhs.data.begin(), rhs.data.end());
+      lhs.Detach();
+      size_t first = lhs.data.size();
+      lhs.data.insert(lhs.data.end(), rhs.begin(), rhs.end());
+      rhs.ApplyHeaderTag(lhs.data, first);
       // Also carry over event flags:
       lhs.flags |= rhs.flags;
       return lhs;
@@ -404,12 +703,65 @@ namespace pxar {
      */
     friend std::ostream & operator<<(std::ostream &out, rawEvent& record) {
       out << "====== " << std::hex << static_cast<uint16_t>(record.flags) << std::dec << " ====== ";
-      for (std::vector<uint16_t>::iterator it = record.data.begin(); it != record.data.end(); ++it)
-	out << std::hex << (*it) << std::dec << " ";
+      for (const uint16_t * it = record.begin(); it != record.end(); ++it)
+	out << std::hex << (it == record.begin() ? (*it | record.head_tag) : *it) << std::dec << " ";
       return out;
     }
   };
 
+  /** Storage for the data words of many raw event records, e.g. all records of
+   *  one DAQ readout. The words are written to large slabs which are reserved
+   *  once and never reallocated, so storing a record costs no allocation. The
+   *  records handed out refer to their slice of a slab and share the slab when
+   *  copied. It is released when the arena and all of its records are gone.
+   */
+  class DLLEXPORT rawEventArena {
+  public:
+  rawEventArena(size_t slabsize = 1 << 20) : m_slab(), m_open(0), m_flags(0), m_slabsize(slabsize), m_slabs(0) {}
+
+    /** Make sure the current slab has room for the given number of further
+     *  data words, allocates a new slab otherwise.
+     */
+    void reserve(size_t words);
+
+    /** Add the data words and flags of a record to the open record
+     */
+    void append(const rawEvent & record);
+
+    /** Finish the open record and return it, the record refers to the arena
+     *  storage.
+     */
+    rawEvent close();
+
+    /** Drop the data of the open record
+     */
+    void discard();
+
+    /** Release the current slab. Records handed out before remain valid.
+     */
+    void clear();
+
+    /** Number of data words in the open record
+     */
+    size_t openSize() const { return (m_slab ? m_slab->size() - m_open : 0); }
+
+    /** Number of slabs allocated by the arena so far
+     */
+    size_t slabCount() const { return m_slabs; }
+
+  private:
+    /** Start a new slab with room for the open record and the given number of
+     *  further data words, the open record is moved there
+     */
+    void grow(size_t words);
+
+    std::shared_ptr<std::vector<uint16_t> > m_slab;
+    size_t m_open;
+    unsigned int m_flags;
+    size_t m_slabsize;
+    size_t m_slabs;
+  };
+
   /** Class to store the configuration for single pixels (i.e. their mask state,
    *  trim bit settings and whether they belong to the currently run test ("enable").
    *  By default, pixelConfigs have the mask bit set.
@@ -450,18 +802,49 @@ namespace pxar {
    *
    *  Contains a DAC map for the ROC programming settings, a type flag, enable switch
    *  and a vector of pixelConfigs.
+   *
+   *  Pixels are looked up through an index over column and row, and the enabled
+   *  and masked pixels are counted. Both are rebuilt when the size of the pixels
+   *  vector changes. Flags changed directly on the pixels vector require a call to
+   *  updateIndex(), use setPixelEnable() and setPixelMask() instead.
    */
   class DLLEXPORT rocConfig {
   public:
-  rocConfig() : pixels(), dacs(), type(0), _enable(true) {}
+  rocConfig() : pixels(), dacs(), type(0), _enable(true), _index(), _indexed(0), _nenabled(0), _nmasked(0) {}
     std::vector< pixelConfig > pixels;
     std::map< uint8_t,uint8_t > dacs;
     uint8_t type;
     uint8_t i2c_address;
     bool enable() const { return _enable; }
     void setEnable(bool enable) { _enable = enable; }
+
+    /** Returns the configuration of the pixel at column and row, or NULL if the
+     *  pixel is not configured
+     */
+    pixelConfig * findPixel(uint8_t column, uint8_t row);
+
+    /** Number of enabled and masked pixels
+     */
+    size_t nEnabledPixels() { checkIndex(); return _nenabled; }
+    size_t nMaskedPixels() { checkIndex(); return _nmasked; }
+
+    /** Set the enable/mask flag of a pixel of this ROC, updating the counters
+     */
+    void setPixelEnable(pixelConfig & px, bool enable);
+    void setPixelMask(pixelConfig & px, bool mask);
+
+    /** Rebuild the pixel index and counters from the pixels vector
+     */
+    void updateIndex();
+
   private:
     bool _enable;
+    void checkIndex() { if(_index.empty() || _indexed != pixels.size()) updateIndex(); }
+    // Position of each pixel in the pixels vector (column*ROC_NUMROWS+row), -1 if not configured:
+    std::vector<int16_t> _index;
+    size_t _indexed;
+    size_t _nenabled;
+    size_t _nmasked;
   };
 
   /** Class for TBM states
@@ -494,6 +877,9 @@ namespace pxar {
     /** Allow the dtbEventDecoder to directly alter private members of the statistics
      */
     friend class dtbEventDecoder;
+    /** Allow the HAL to add the DTB buffer fill level to live statistics
+     */
+    friend class hal;
 
   public:
   statistics() :
@@ -517,7 +903,9 @@ namespace pxar {
       m_errors_pixel_incomplete(0),
       m_errors_pixel_address(0),
       m_errors_pixel_pulseheight(0),
-      m_errors_pixel_buffer_corrupt(0)
+      m_errors_pixel_buffer_corrupt(0),
+      m_info_duration(0),
+      m_info_buffer_fill_max(0)
 	{};
     // Print all statistics to stdout:
     void dump();
@@ -553,6 +941,10 @@ namespace pxar {
       lhs.m_errors_pixel_pulseheight += rhs.m_errors_pixel_pulseheight;
       lhs.m_errors_pixel_buffer_corrupt += rhs.m_errors_pixel_buffer_corrupt;
 
+      // Channels are read out in parallel, keep the longest duration and highest fill:
+      if(rhs.m_info_duration > lhs.m_info_duration) lhs.m_info_duration = rhs.m_info_duration;
+      if(rhs.m_info_buffer_fill_max > lhs.m_info_buffer_fill_max) lhs.m_info_buffer_fill_max = rhs.m_info_buffer_fill_max;
+
       return lhs;
     };
 
@@ -608,10 +1000,31 @@ namespace pxar {
     uint32_t errors_pixel_address() { return m_errors_pixel_address; };
     uint32_t errors_pixel_pulseheight() { return m_errors_pixel_pulseheight; };
     uint32_t errors_pixel_buffer_corrupt() { return m_errors_pixel_buffer_corrupt; };
+
+    /** Time since the start of the DAQ session in milliseconds, only set for
+     *  live statistics (see pxarCore::getLiveStatistics)
+     */
+    uint32_t info_duration() { return m_info_duration; }
+    /** Highest DTB buffer fill level in percent seen by pxarCore::daqStatus(),
+     *  only set for live statistics
+     */
+    uint8_t info_buffer_fill_max() { return m_info_buffer_fill_max; }
+
+    // Rates per second averaged over info_duration(), zero if no duration is set:
+    double rate_words_read() { return rate(info_words_read()); }
+    double rate_events() { return rate(info_events_total()); }
+    double rate_pixels() { return rate(info_pixels_valid()); }
+    double rate_errors() { return rate(errors()); }
+    double rate_errors_event() { return rate(errors_event()); }
+    double rate_errors_tbm() { return rate(errors_tbm()); }
+    double rate_errors_roc() { return rate(errors_roc()); }
+    double rate_errors_pixel() { return rate(errors_pixel()); }
   private:
     // Clear all statistics:
     void clear();
 
+    double rate(uint32_t count) { return (m_info_duration > 0 ? 1000.0*count/m_info_duration : 0.0); }
+
     // Total number of words read:
     uint32_t m_info_words_read;
     // Total number of empty events (no pixel hit):
@@ -658,6 +1071,11 @@ namespace pxar {
     uint32_t m_errors_pixel_pulseheight;
     // Total number of pixels with row 80:
     uint32_t m_errors_pixel_buffer_corrupt;
+
+    // Time since the start of the DAQ session in milliseconds:
+    uint32_t m_info_duration;
+    // Highest DTB buffer fill level in percent:
+    uint8_t m_info_buffer_fill_max;
   };
 }
 #endif
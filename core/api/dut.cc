@@ -43,7 +43,7 @@ void dut::info() {
 
 size_t dut::getNEnabledPixels(uint8_t rocid) {
   if (!_initialized || rocid >= roc.size()) return 0;
-  return std::count_if(roc.at(rocid).pixels.begin(),roc.at(rocid).pixels.end(),configEnableSet(true));
+  return roc.at(rocid).nEnabledPixels();
 }
 
 size_t dut::getNEnabledPixels() {
@@ -51,14 +51,14 @@ size_t dut::getNEnabledPixels() {
   size_t nenabled = 0;
   // Loop over all ROCs
   for (std::vector<rocConfig>::iterator rocit = roc.begin() ; rocit != roc.end(); ++rocit){
-    nenabled += std::count_if(rocit->pixels.begin(),rocit->pixels.end(),configEnableSet(true));
+    nenabled += rocit->nEnabledPixels();
   }
   return nenabled;
 }
 
 size_t dut::getNMaskedPixels(uint8_t rocid) {
   if (!_initialized || rocid >= roc.size()) return 0;
-  return std::count_if(roc.at(rocid).pixels.begin(),roc.at(rocid).pixels.end(),configMaskSet(true));
+  return roc.at(rocid).nMaskedPixels();
 }
 
 size_t dut::getNMaskedPixels() {
@@ -66,7 +66,7 @@ size_t dut::getNMaskedPixels() {
   size_t nmasked = 0;
   // Loop over all ROCs
   for (std::vector<rocConfig>::iterator rocit = roc.begin() ; rocit != roc.end(); ++rocit){
-    nmasked += std::count_if(rocit->pixels.begin(),rocit->pixels.end(),configMaskSet(true));
+    nmasked += rocit->nMaskedPixels();
   }
   return nmasked;
 }
@@ -281,20 +281,15 @@ std::vector< tbmConfig > dut::getEnabledTbms() {
 }
 
 bool dut::getPixelEnabled(uint8_t column, uint8_t row) {
-  std::vector<pixelConfig>::iterator it = std::find_if(roc.at(0).pixels.begin(),
-						       roc.at(0).pixels.end(),
-						       findPixelXY(column,row));
-  if(it != roc.at(0).pixels.end()) { return it->enable(); }
+  pixelConfig * px = roc.at(0).findPixel(column,row);
+  if(px != NULL) { return px->enable(); }
   return false;
 }
 
 bool dut::getAllPixelEnable(){
  if (!status()) return false;
- // search for pixels that DO NOT have enable set
- std::vector<pixelConfig>::iterator it = std::find_if(roc.at(0).pixels.begin(),
-						      roc.at(0).pixels.end(),
-						      configEnableSet(false));
- if(it != roc.at(0).pixels.end())
+ // check if there are pixels that DO NOT have enable set
+ if(roc.at(0).nEnabledPixels() != roc.at(0).pixels.size())
    return false; // found a disabled pixel
  else
    return true; // all pixels are enabled
@@ -320,12 +315,10 @@ pixelConfig dut::getPixelConfig(size_t rocid, uint8_t column, uint8_t row) {
   pixelConfig result; // initialized with 0 by constructor
   if (!status()) return result;
   // find pixel with specified column and row
-  std::vector<pixelConfig>::iterator it = std::find_if(roc.at(rocid).pixels.begin(),
-						       roc.at(rocid).pixels.end(),
-						       findPixelXY(column,row));
+  pixelConfig * px = roc.at(rocid).findPixel(column,row);
   // if pixel found, set result accordingly
-  if(it != roc.at(rocid).pixels.end()){
-    result = *it;
+  if(px != NULL){
+    result = *px;
   }
   return result;
 }
@@ -404,6 +397,8 @@ void dut::printDACs(size_t rocId) {
 
 void dut::setROCEnable(size_t rocId, bool enable) {
 
+  _version++;
+
   // Check if ROC exists:
   if(rocId < roc.size())
     // Set its status to the desired value:
@@ -420,16 +415,16 @@ void dut::setTBMEnable(size_t tbmId, bool enable) {
 
 void dut:: maskPixel(uint8_t column, uint8_t row, bool mask) {
 
+  _version++;
+
   if(status()) {
     // Loop over all ROCs
     for (std::vector<rocConfig>::iterator rocit = roc.begin() ; rocit != roc.end(); ++rocit){
       // Find pixel with specified column and row
-      std::vector<pixelConfig>::iterator it = std::find_if(rocit->pixels.begin(),
-							   rocit->pixels.end(),
-							   findPixelXY(column,row));
+      pixelConfig * px = rocit->findPixel(column,row);
       // Set enable bit
-      if(it != rocit->pixels.end()) {
-	it->setMask(mask);
+      if(px != NULL) {
+	rocit->setPixelMask(*px,mask);
       } else {
 	LOG(logWARNING) << "Pixel at column " << static_cast<int>(column) << " and row " << static_cast<int>(row) << " not found for ROC " << static_cast<int>(rocit - roc.begin()) << "!" ;
       }
@@ -439,14 +434,14 @@ void dut:: maskPixel(uint8_t column, uint8_t row, bool mask) {
 
 void dut:: maskPixel(uint8_t column, uint8_t row, bool mask, uint8_t rocid) {
 
+  _version++;
+
   if(status() && rocid < roc.size()) {
     // Find pixel with specified column and row
-    std::vector<pixelConfig>::iterator it = std::find_if(roc.at(rocid).pixels.begin(),
-							 roc.at(rocid).pixels.end(),
-							 findPixelXY(column,row));
+    pixelConfig * px = roc.at(rocid).findPixel(column,row);
     // Set mask:
-    if(it != roc.at(rocid).pixels.end()){
-      it->setMask(mask);
+    if(px != NULL){
+      roc.at(rocid).setPixelMask(*px,mask);
     } else {
       LOG(logWARNING) << "Pixel at column " << static_cast<int>(column) << " and row " << static_cast<int>(row) << " not found for ROC " << static_cast<int>(rocid)<< "!" ;
     }
@@ -455,16 +450,16 @@ void dut:: maskPixel(uint8_t column, uint8_t row, bool mask, uint8_t rocid) {
 
 void dut::testPixel(uint8_t column, uint8_t row, bool enable) {
 
+  _version++;
+
   if(status()) {
     // Loop over all ROCs
     for (std::vector<rocConfig>::iterator rocit = roc.begin() ; rocit != roc.end(); ++rocit){
       // Find pixel with specified column and row
-      std::vector<pixelConfig>::iterator it = std::find_if(rocit->pixels.begin(),
-							   rocit->pixels.end(),
-							   findPixelXY(column,row));
+      pixelConfig * px = rocit->findPixel(column,row);
       // Set enable bit
-      if(it != rocit->pixels.end()) {
-	it->setEnable(enable);
+      if(px != NULL) {
+	rocit->setPixelEnable(*px,enable);
       } else {
 	LOG(logWARNING) << "Pixel at column " << static_cast<int>(column) << " and row " << static_cast<int>(row) << " not found for ROC " << static_cast<int>(rocit - roc.begin())<< "!" ;
       }
@@ -474,14 +469,14 @@ void dut::testPixel(uint8_t column, uint8_t row, bool enable) {
 
 void dut::testPixel(uint8_t column, uint8_t row, bool enable, uint8_t rocid) {
 
+  _version++;
+
   if(status() && rocid < roc.size()) {
     // Find pixel with specified column and row
-    std::vector<pixelConfig>::iterator it = std::find_if(roc.at(rocid).pixels.begin(),
-							 roc.at(rocid).pixels.end(),
-							 findPixelXY(column,row));
+    pixelConfig * px = roc.at(rocid).findPixel(column,row);
     // Set mask:
-    if(it != roc.at(rocid).pixels.end()){
-      it->setEnable(enable);
+    if(px != NULL){
+      roc.at(rocid).setPixelEnable(*px,enable);
     } else {
       LOG(logWARNING) << "Pixel at column " << static_cast<int>(column) << " and row " << static_cast<int>(row) << " not found for ROC " << static_cast<int>(rocid)<< "!" ;
     }
@@ -490,13 +485,15 @@ void dut::testPixel(uint8_t column, uint8_t row, bool enable, uint8_t rocid) {
 
 void dut::maskAllPixels(bool mask) {
 
+  _version++;
+
   if(status()) {
     LOG(logDEBUGAPI) << "Set mask bit to " << static_cast<int>(mask) << " for all pixels on all ROCs.";
     // Loop over all ROCs
     for (std::vector<rocConfig>::iterator rocit = roc.begin() ; rocit != roc.end(); ++rocit){
       // loop over all pixel, set enable according to parameter
       for (std::vector<pixelConfig>::iterator pixelit = rocit->pixels.begin() ; pixelit != rocit->pixels.end(); ++pixelit){
-	pixelit->setMask(mask);
+	rocit->setPixelMask(*pixelit,mask);
       }
     }
   }
@@ -504,35 +501,41 @@ void dut::maskAllPixels(bool mask) {
 
 void dut::maskAllPixels(bool mask, uint8_t rocid) {
 
+  _version++;
+
   if(status() && rocid < roc.size()) {
     LOG(logDEBUGAPI) << "Set mask bit to " << static_cast<int>(mask) << " for all pixels on ROC " << static_cast<int>(rocid);
     // loop over all pixel, set enable according to parameter
     for (std::vector<pixelConfig>::iterator pixelit = roc.at(rocid).pixels.begin() ; pixelit != roc.at(rocid).pixels.end(); ++pixelit){
-      pixelit->setMask(mask);
+      roc.at(rocid).setPixelMask(*pixelit,mask);
     }
   }
 }
 
 void dut::testAllPixels(bool enable, uint8_t rocid) {
 
+  _version++;
+
   if(status() && rocid < roc.size()) {
     LOG(logDEBUGAPI) << "Set enable bit to " << static_cast<int>(enable) << " for all pixels on ROC " << static_cast<int>(rocid);
     // loop over all pixel, set enable according to parameter
     for (std::vector<pixelConfig>::iterator pixelit = roc.at(rocid).pixels.begin() ; pixelit != roc.at(rocid).pixels.end(); ++pixelit){
-      pixelit->setEnable(enable);
+      roc.at(rocid).setPixelEnable(*pixelit,enable);
     }
   }
 }
 
 void dut::testAllPixels(bool enable) {
 
+  _version++;
+
   if(status()) {
     LOG(logDEBUGAPI) << "Set enable bit to " << static_cast<int>(enable) << " for all pixels on all ROCs";
     // Loop over all ROCs
     for (std::vector<rocConfig>::iterator rocit = roc.begin() ; rocit != roc.end(); ++rocit){
       // loop over all pixel, set enable according to parameter
       for (std::vector<pixelConfig>::iterator pixelit = rocit->pixels.begin() ; pixelit != rocit->pixels.end(); ++pixelit){
-	pixelit->setEnable(enable);
+	rocit->setPixelEnable(*pixelit,enable);
       }
     }
   }
@@ -540,14 +543,14 @@ void dut::testAllPixels(bool enable) {
 
 bool dut::updateTrimBits(pixelConfig trimming, uint8_t rocid) {
 
+  _version++;
+
   if(status() && rocid < roc.size()) {
 
     // Find the pixel in the given ROC pixels vector:
-    std::vector<pixelConfig>::iterator px = std::find_if(roc.at(rocid).pixels.begin(),
-							 roc.at(rocid).pixels.end(),
-							 findPixelXY(trimming.column(),trimming.row()));
+    pixelConfig * px = roc.at(rocid).findPixel(trimming.column(),trimming.row());
     // Pixel was not found:
-    if(px == roc.at(0).pixels.end()) return false;
+    if(px == NULL) return false;
     // Pixel was found, set the new trimming values:
     px->setTrim(trimming.trim());
     return true;
@@ -557,14 +560,14 @@ bool dut::updateTrimBits(pixelConfig trimming, uint8_t rocid) {
 
 bool dut::updateTrimBits(uint8_t column, uint8_t row, uint8_t trim, uint8_t rocid) {
 
+  _version++;
+
   if(status() && rocid < roc.size()) {
 
     // Find the pixel in the given ROC pixels vector:
-    std::vector<pixelConfig>::iterator px = std::find_if(roc.at(rocid).pixels.begin(),
-							 roc.at(rocid).pixels.end(),
-							 findPixelXY(column,row));
+    pixelConfig * px = roc.at(rocid).findPixel(column,row);
     // Pixel was not found:
-    if(px == roc.at(0).pixels.end()) return false;
+    if(px == NULL) return false;
     // Pixel was found, set the new trimming values:
     px->setTrim(trim);
     return true;
@@ -574,16 +577,16 @@ bool dut::updateTrimBits(uint8_t column, uint8_t row, uint8_t trim, uint8_t roci
 
 bool dut::updateTrimBits(std::vector<pixelConfig> trimming, uint8_t rocid) {
 
+  _version++;
+
   if(status() && rocid < roc.size()) {
     // Loop over all trimbit pixelConfigs we got as parameter:
     for (std::vector<pixelConfig>::iterator it = trimming.begin(); it != trimming.end(); ++it){
 
       // Find the pixel in the given ROC pixels vector:
-      std::vector<pixelConfig>::iterator px = std::find_if(roc.at(rocid).pixels.begin(),
-							   roc.at(rocid).pixels.end(),
-							   findPixelXY(it->column(),it->row()));
+      pixelConfig * px = roc.at(rocid).findPixel(it->column(),it->row());
       // Pixel was not found:
-      if(px == roc.at(0).pixels.end()) return false;
+      if(px == NULL) return false;
       // Pixel was found, set the new trimming values:
       px->setTrim(it->trim());
     }
@@ -592,6 +595,27 @@ bool dut::updateTrimBits(std::vector<pixelConfig> trimming, uint8_t rocid) {
   else { return false; }
 }
 
+const dutSnapshot & dut::getSnapshot() {
+
+  if(_snapshot.version == _version) return _snapshot;
+  LOG(logDEBUGAPI) << "DUT configuration changed, updating the snapshot of enabled ROCs and pixels.";
+
+  _snapshot.rocIds = getEnabledRocIDs();
+  _snapshot.rocI2C = getEnabledRocI2Caddr();
+  _snapshot.allPixels = getAllPixelEnable();
+
+  _snapshot.pixels.clear();
+  _snapshot.identicalPixels = true;
+  for(std::vector<uint8_t>::iterator rc = _snapshot.rocIds.begin(); rc != _snapshot.rocIds.end(); ++rc) {
+    _snapshot.pixels.push_back(getEnabledPixels(*rc));
+    // Compare the configuration of the first ROC with all others:
+    if(!comparePixelConfiguration(_snapshot.pixels.front(),_snapshot.pixels.back())) { _snapshot.identicalPixels = false; }
+  }
+
+  _snapshot.version = _version;
+  return _snapshot;
+}
+
 bool dut::status() {
 
   if(!_initialized || !_programmed) {
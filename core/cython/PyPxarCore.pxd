@@ -19,6 +19,9 @@ cdef extern from "api.h" namespace "pxar":
     cdef int _flag_disable_readback_collection "FLAG_DISABLE_READBACK_COLLECTION"
     cdef int _flag_disable_eventid_check "FLAG_DISABLE_EVENTID_CHECK"
     cdef int _flag_enable_xorsum_logging "FLAG_ENABLE_XORSUM_LOGGING"
+    cdef int _flag_daq_prefetch "FLAG_DAQ_PREFETCH"
+    cdef int _flag_pipelined_loops "FLAG_PIPELINED_LOOPS"
+    cdef int _flag_parallel_decoding "FLAG_PARALLEL_DECODING"
 
 cdef extern from "api.h" namespace "pxar":
     cdef cppclass pixel:
@@ -21,6 +21,9 @@ FLAG_DUMP_FLAWED_EVENTS = int(_flag_dump_flawed_events)
 FLAG_DISABLE_READBACK_COLLECTION = int(_flag_disable_readback_collection)
 FLAG_DISABLE_EVENTID_CHECK = int(_flag_disable_eventid_check)
 FLAG_ENABLE_XORSUM_LOGGING = int(_flag_enable_xorsum_logging)
+FLAG_DAQ_PREFETCH = int(_flag_daq_prefetch)
+FLAG_PIPELINED_LOOPS = int(_flag_pipelined_loops)
+FLAG_PARALLEL_DECODING = int(_flag_parallel_decoding)
 
 cdef class Pixel:
     cdef pixel *thisptr      # hold a C++ instance which we're wrapping
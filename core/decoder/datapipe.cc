@@ -17,77 +17,128 @@ namespace pxar {
     else { SplitDeser400(); }
 
     LOG(logDEBUGPIPES) << "SINGLE SPLIT EVENT:";
-    if(GetDeviceType() < ROC_PSI46DIG) { LOG(logDEBUGPIPES) << listVector(record.data,false,true); }
-    else { LOG(logDEBUGPIPES) << listVector(record.data,true); }
+    if(GetDeviceType() < ROC_PSI46DIG) { LOG(logDEBUGPIPES) << listVector(std::vector<uint16_t>(record.begin(),record.end()),false,true); }
+    else { LOG(logDEBUGPIPES) << listVector(std::vector<uint16_t>(record.begin(),record.end()),true); }
     LOG(logDEBUGPIPES) << "-------------------------";
 
     return &record;
   }
 
+  void dtbEventSplitter::NextBlock() {
+    // The source is going to reuse its buffer, copy what we have of the current event:
+    record.Detach();
+    try { GetBlock(blockPos, blockEnd); }
+    catch(...) {
+      // Do not keep pointers into a block the source may have released:
+      blockPos = blockEnd = NULL;
+      throw;
+    }
+    scanner.Reset();
+  }
+
+  inline void dtbEventSplitter::Keep(uint16_t value, uint16_t tag) {
+    // Add the last word read to the record. As long as the event is contiguous in the
+    // current block and the word is kept unchanged, only the view on the block is
+    // extended. The source block itself is never modified, the tag bits of the first
+    // word are carried by the record:
+    uint16_t * word = (blockPos ? blockPos - 1 : NULL);
+    bool first = (record.GetSize() == 0);
+    if(word && *word == value && ((record.IsView() && record.end() == word) || (!record.IsView() && first)) && (first || tag == 0)) {
+      record.SetView(first ? word : record.begin(), word + 1);
+      if(first) { record.SetHeaderTag(tag); }
+    }
+    else { record.Add(value | tag); }
+  }
+
+  void dtbEventSplitter::KeepRange(uint16_t * first, uint16_t * last) {
+    if(first == last) return;
+    // Extend the view if the words directly follow the current record:
+    if((record.IsView() && record.end() == first) || (!record.IsView() && record.GetSize() == 0)) {
+      record.SetView(record.GetSize() == 0 ? first : record.begin(), last);
+    }
+    else { for(uint16_t * word = first; word != last; word++) record.Add(*word); }
+  }
+
+  uint16_t dtbEventSplitter::NextMarker(uint16_t mask1, uint16_t value1, uint16_t mask2, uint16_t value2) {
+    // Add all words up to the next marker to the record in one go, then read the marker.
+    // Stops early when the record reaches its maximum size, the caller handles that:
+    scanner.SetMarkers(mask1, value1, mask2, value2);
+    while(record.GetSize() < 40000) {
+      if(blockPos == blockEnd) { NextBlock(); }
+      size_t room = 40000 - record.GetSize();
+      uint16_t * last = (static_cast<size_t>(blockEnd - blockPos) > room ? blockPos + room : blockEnd);
+      uint16_t * marker = scanner.Find(blockPos, last);
+      KeepRange(blockPos, marker);
+      blockPos = marker;
+      if(marker != blockEnd) break;
+    }
+    return Next();
+  }
+
   void dtbEventSplitter::SplitDeser400() {
     // If last one had Event end marker, get a new sample:
-    if (!nextStartDetected) { Get(); }
+    if (!nextStartDetected) { Next(); }
 
     // If new sample does not have start marker keep on reading until we find it:
-    if ((GetLast() & 0xe000) != 0xa000) {
+    if ((lastWord & 0xe000) != 0xa000) {
       record.SetStartError();
-      Get();
+      Next();
     }
     // Store the TBM header word and attach the channel ID in unused header bits:
-    record.Add(GetLast() | ((GetChannel() & 0x7) << 8));
+    Keep(lastWord, static_cast<uint16_t>((GetChannel() & 0x7) << 8));
 
     // Else keep reading and adding samples until we find any marker.
-    while ((Get() & 0xe000) != 0xc000) {
+    while ((NextMarker(0xe000, 0xc000, 0xe000, 0xa000) & 0xe000) != 0xc000) {
       // Check if the last read sample has Event end marker:
-      if ((GetLast() & 0xe000) == 0xa000) {
+      if ((lastWord & 0xe000) == 0xa000) {
 	record.SetEndError();
 	nextStartDetected = true;
 	return;
       }
       // If total Event size is too big, break:
-      if (record.GetSize() < 40000) record.Add(GetLast());
+      if (record.GetSize() < 40000) Keep(lastWord);
       else record.SetOverflow();
     }
-    record.Add(GetLast());
+    Keep(lastWord);
     nextStartDetected = false;
   }
 
   void dtbEventSplitter::SplitSoftTBM() {
     // If last one had Event end marker, get a new sample:
-    if (!nextStartDetected) { Get(); }
+    if (!nextStartDetected) { Next(); }
 
     // If new sample does not have start marker keep on reading until we find it:
-    if ((GetLast() & 0xe000) != 0xa000) {
+    if ((lastWord & 0xe000) != 0xa000) {
       record.SetStartError();
-      Get();
+      Next();
     }
-    record.Add(GetLast());
+    Keep(lastWord);
 
     // Else keep reading and adding samples until we find the last trailer marker.
     // Make sure to look for "c0" and not "c" - the latter one is also the DESER160 end marker!
-    while ((Get() & 0xef00) != 0xc000) {
+    while ((NextMarker(0xef00, 0xc000, 0xe000, 0xa000) & 0xef00) != 0xc000) {
       // Check if the last read sample has Event end marker:
-      if ((GetLast() & 0xe000) == 0xa000) {
+      if ((lastWord & 0xe000) == 0xa000) {
 	record.SetEndError();
 	nextStartDetected = true;
 	return;
       }
       // If total Event size is too big, break:
-      if (record.GetSize() < 40000) record.Add(GetLast());
+      if (record.GetSize() < 40000) Keep(lastWord);
       else record.SetOverflow();
     }
-    record.Add(GetLast());
+    Keep(lastWord);
     nextStartDetected = false;
   }
 
   void dtbEventSplitter::SplitDeser160() {
     // If last one had Event end marker, get a new sample:
-    if (GetLast() & 0x4000) { Get(); }
+    if (lastWord & 0x4000) { Next(); }
 
     // If new sample does not have start marker keep on reading until we find it:
-    if (!(GetLast() & 0x8000)) {
+    if (!(lastWord & 0x8000)) {
       record.SetStartError();
-      while (!(GetLast() & 0x8000)) Get();
+      while (!(lastWord & 0x8000)) Next();
     }
 
     // Else keep reading and adding samples until we find any marker.
@@ -100,13 +151,13 @@ namespace pxar {
 
       // FIXME Very first Event starts with 0xC - which srews up empty Event detection here!
       // If the Event start sample is also Event end sample, write and quit:
-      if((GetLast() & 0xc000) == 0xc000) { break; }
+      if((lastWord & 0xc000) == 0xc000) { break; }
 
-      record.Add(GetLast());
-    } while ((Get() & 0xc000) == 0);
+      Keep(lastWord);
+    } while ((NextMarker(0x8000, 0x8000, 0x4000, 0x4000) & 0xc000) == 0);
 
     // Check if the last read sample has Event end marker:
-    if (GetLast() & 0x4000) record.Add(GetLast());
+    if (lastWord & 0x4000) Keep(lastWord);
     // Else set Event end error:
     else record.SetEndError();
   }
@@ -125,7 +176,13 @@ namespace pxar {
   Event* dtbEventDecoder::Read() {
 
     roc_Event.Clear();
-    rawEvent *sample = Get();
+    rawEvent *sample;
+    try { sample = Get(); }
+    catch(dsBufferEmpty &) {
+      // The readout of the channel is complete, make sure the final numbers are visible:
+      PublishStatistics(true);
+      throw;
+    }
 
     if(dump_count < 100 && (GetFlags() & FLAG_DUMP_FLAWED_EVENTS) != 0) {
       // Store the current error count for comparison:
@@ -134,8 +191,11 @@ namespace pxar {
 	+ decodingStats.errors_tbm()
 	+ decodingStats.errors_roc();
 
-      std::stringstream thisevent; thisevent << *sample;
-      event_ringbuffer.at(total_event%7) = thisevent.str();
+      // Copy the data words into the ring buffer slot, reusing its storage:
+      rawEvent & slot = event_ringbuffer.at(total_event%7);
+      slot.Clear();
+      slot += *sample;
+      event_stored.at(total_event%7) = true;
     }
 
     // Count possibe error states:
@@ -169,7 +229,8 @@ namespace pxar {
 	// Dump the ring buffer:
 	LOG(logERROR) << "Dumping the flawed event +- 3 events:";
 	for(size_t i = total_event; i < total_event+event_ringbuffer.size(); i++) {
-	  LOG(logERROR) << event_ringbuffer.at(i%7);
+	  if(event_stored.at(i%7)) { LOG(logERROR) << event_ringbuffer.at(i%7); }
+	  else { LOG(logERROR) << ""; }
 	}
 	dump_count++;
 	if(dump_count == 100) {
@@ -179,6 +240,8 @@ namespace pxar {
       total_event++;
     }
 
+    if(++publishCount % DTB_STATISTICS_PUBLISH == 0) { PublishStatistics(false); }
+
     LOG(logDEBUGPIPES) << roc_Event;
     return &roc_Event;
   }
@@ -227,17 +290,40 @@ namespace pxar {
     unsigned int size = sample->GetSize();
 
     // TBM Header:
-    ProcessTBMHeader(sample->data.at(0),sample->data.at(1));
+    ProcessTBMHeader((*sample)[0],(*sample)[1]);
 
     // TBM Trailer:
-    ProcessTBMTrailer(sample->data.at(size-2),sample->data.at(size-1));
+    ProcessTBMTrailer((*sample)[size-2],(*sample)[size-1]);
     
     // Check for correct TBM event ID:
     CheckEventID();
 
-    // Remove header and trailer:
-    sample->data.erase(sample->data.begin(), sample->data.begin() + 2);
-    sample->data.erase(sample->data.end() - 2, sample->data.end());
+    // Remove header and trailer by restricting the record to the ROC data:
+    sample->SetView(sample->begin() + 2, sample->end() - 2);
+  }
+
+  inline void dtbEventDecoder::AddPixel(uint32_t raw, uint8_t roc, bool invertedAddress, bool linearAddress) {
+    pixel pix;
+    pixel::decodeStatus status = pix.decode(raw, roc, invertedAddress, linearAddress);
+    if(status == pixel::DECODE_OK) {
+      roc_Event.pixels.push_back(pix);
+      decodingStats.m_info_pixels_valid++;
+      return;
+    }
+
+    LOG(logDEBUGPIPES) << "Invalid pixel from raw value of " << std::hex << raw << std::dec << ": " << pix;
+    if(status == pixel::DECODE_INVALID_ADDRESS) {
+      // decoding of raw address lead to invalid address
+      decodingStats.m_errors_pixel_address++;
+    }
+    else if(status == pixel::DECODE_INVALID_PULSEHEIGHT) {
+      // decoding of pulse height featured non-zero fill bit
+      decodingStats.m_errors_pixel_pulseheight++;
+    }
+    else {
+      // decoding returned row 80 - corrupt data buffer
+      decodingStats.m_errors_pixel_buffer_corrupt++;
+    }
   }
 
   void dtbEventDecoder::DecodeDeser400(rawEvent * sample) {
@@ -252,7 +338,7 @@ namespace pxar {
     bool linearAddress = ( GetDeviceType() >= ROC_PROC600 ? true : false );
 
     // Loop over the full data:
-    for(std::vector<uint16_t>::iterator word = sample->data.begin(); word != sample->data.end(); word++) {
+    for(uint16_t * word = sample->begin(); word != sample->end(); word++) {
 
       // Check if we have a ROC header:
       if(((*word) & 0xe000) == 0x4000) {
@@ -288,7 +374,7 @@ namespace pxar {
       else if(((*word) & 0xe000) <= 0x2000) {
 
 	// Only one word left or unexpected alignment marker:
-	if(sample->data.end() - word < 2 || ((*word) & 0x8000)) {
+	if(sample->end() - word < 2 || ((*word) & 0x8000)) {
 	  decodingStats.m_errors_pixel_incomplete++;
 	  break;
 	}
@@ -297,34 +383,20 @@ namespace pxar {
 	// (*word) >> 13 == 0
 	// (*(word+1) >> 13 == 1
 
-	uint32_t raw = (((*word) & 0x0fff) << 12) + ((*(++word)) & 0x0fff);
-	try {
-	  // Check if this is just fill bits of the TBM09 data stream 
-	  // accounting for the other channel:
-	  if(GetEnvelopeType() >= TBM_09 && (raw&0xffffff) == 0xffffff) {
-	    LOG(logDEBUGPIPES) << "Empty hit detected (TBM09 data streams). Skipping.";
-	    continue;
-	  }
-
-	  // Get the correct ROC id: Channel number x ROC offset (= token chain length)
-	  // TBM08x: channel 0: 0-7, channel 1: 8-15
-	  // TBM09x: channel 0: 0-3, channel 1: 4-7, channel 2: 8-11, channel 3: 12-15
-	  pixel pix(raw,static_cast<uint8_t>(roc_n + GetTokenChainOffset()),invertedAddress,linearAddress);
-	  roc_Event.pixels.push_back(pix);
-	  decodingStats.m_info_pixels_valid++;
-	}
-	catch(DataInvalidAddressError /*&e*/){
-	  // decoding of raw address lead to invalid address
-	  decodingStats.m_errors_pixel_address++;
-	}
-	catch(DataInvalidPulseheightError /*&e*/){
-	  // decoding of pulse height featured non-zero fill bit
-	  decodingStats.m_errors_pixel_pulseheight++;
-	}
-	catch(DataCorruptBufferError /*&e*/){
-	  // decoding returned row 80 - corrupt data buffer
-	  decodingStats.m_errors_pixel_buffer_corrupt++;
+	uint32_t raw = ((word[0] & 0x0fff) << 12) + (word[1] & 0x0fff);
+	word++;
+
+	// Check if this is just fill bits of the TBM09 data stream 
+	// accounting for the other channel:
+	if(GetEnvelopeType() >= TBM_09 && (raw&0xffffff) == 0xffffff) {
+	  LOG(logDEBUGPIPES) << "Empty hit detected (TBM09 data streams). Skipping.";
+	  continue;
 	}
+
+	// Get the correct ROC id: Channel number x ROC offset (= token chain length)
+	// TBM08x: channel 0: 0-7, channel 1: 8-15
+	// TBM09x: channel 0: 0-3, channel 1: 4-7, channel 2: 8-11, channel 3: 12-15
+	AddPixel(raw,static_cast<uint8_t>(roc_n + GetTokenChainOffset()),invertedAddress,linearAddress);
       }
     }
 
@@ -346,10 +418,10 @@ namespace pxar {
     }
 
     // Loop over the full data:
-    for(std::vector<uint16_t>::iterator word = sample->data.begin(); word != sample->data.end(); word++) {
+    for(uint16_t * word = sample->begin(); word != sample->end(); word++) {
 
       // Not enough data for anything, stop here - and assume it was half a pixel hit:
-      if((sample->data.end() - word < 2)) { 
+      if((sample->end() - word < 2)) { 
 	decodingStats.m_errors_pixel_incomplete++;
 	break;
       }
@@ -381,25 +453,23 @@ namespace pxar {
       // We have a pixel hit:
       else {
 	// Not enough data for a new pixel hit (six words):
-	if(sample->data.end() - word < 6) {
+	if(sample->end() - word < 6) {
 	  decodingStats.m_errors_pixel_incomplete++;
 	  break;
 	}
 
-	std::vector<uint16_t> data;
-	data.push_back((*word) & 0x0fff);
-	for(size_t i = 0; i < 5; i++) { data.push_back((*(++word)) & 0x0fff); }
- 
-	try{
-	  LOG(logDEBUGPIPES) << "Trying to decode pixel: " << listVector(data,false,true);
-	  pixel pix(data,roc_n,ultrablack,black);
+	// Decode the six words in place, looking up the address levels:
+	LOG(logDEBUGPIPES) << "Trying to decode pixel: " << listVector(std::vector<uint16_t>(word,word+6),false,true);
+	pixel pix;
+	if(pix.decode(word,roc_n,static_cast<int16_t>(black),&levelTable[0]) == pixel::DECODE_OK) {
 	  roc_Event.pixels.push_back(pix);
 	  decodingStats.m_info_pixels_valid++;
 	}
-	catch(DataDecodingError /*&e*/){
+	else {
 	  // decoding of raw address lead to invalid address
 	  decodingStats.m_errors_pixel_address++;
 	}
+	word += 5;
       }
     }
 
@@ -424,7 +494,7 @@ namespace pxar {
     }
 
     // Loop over the full data:
-    for(std::vector<uint16_t>::iterator word = sample->data.begin(); word != sample->data.end(); word++) {
+    for(uint16_t * word = sample->begin(); word != sample->end(); word++) {
 
       // Check if we have a ROC header:
       if(((*word) & 0x0ffc) == 0x07f8) {
@@ -437,29 +507,14 @@ namespace pxar {
       // Require that we found at least one ROC header and have two or more words left:
       else if(roc_n >= 0) {
 	// It's not a ROC header but the last word:
-	if(sample->data.end() - word < 2) {
+	if(sample->end() - word < 2) {
 	  decodingStats.m_errors_pixel_incomplete++;
 	  continue;
 	}
 
-	uint32_t raw = (((*word) & 0x0fff) << 12) + ((*(++word)) & 0x0fff);
-	try {
-	  pixel pix(raw,roc_n,invertedAddress,linearAddress);
-	  roc_Event.pixels.push_back(pix);
-	  decodingStats.m_info_pixels_valid++;
-	}
-	catch(DataInvalidAddressError /*&e*/) {
-	  // decoding of raw address lead to invalid address
-	  decodingStats.m_errors_pixel_address++;
-	}
-	catch(DataInvalidPulseheightError /*&e*/) {
-	  // decoding of pulse height featured non-zero fill bit
-	  decodingStats.m_errors_pixel_pulseheight++;
-	}
-	catch(DataCorruptBufferError /*&e*/) {
-	  // decoding returned row 80 - corrupt data buffer
-	  decodingStats.m_errors_pixel_buffer_corrupt++;
-	}
+	uint32_t raw = ((word[0] & 0x0fff) << 12) + (word[1] & 0x0fff);
+	word++;
+	AddPixel(raw,static_cast<uint8_t>(roc_n),invertedAddress,linearAddress);
       }
     }
 
@@ -556,6 +611,13 @@ namespace pxar {
       black = static_cast<float>(999)/1000*black + static_cast<float>(1)/1000*expandSign(word2 & 0x0fff);
     }
     levelS = (black - ultrablack)/8;
+
+    // Refresh the address level table if the levels moved:
+    if(static_cast<int16_t>(ultrablack) != tableUltrablack || static_cast<int16_t>(black) != tableBlack) {
+      tableUltrablack = static_cast<int16_t>(ultrablack);
+      tableBlack = static_cast<int16_t>(black);
+      pixel::analogLevels(tableUltrablack, tableBlack, &levelTable[0]);
+    }
   }
 
   void dtbEventDecoder::evalDeser400Errors(uint16_t data) {
@@ -647,10 +709,19 @@ namespace pxar {
   statistics dtbEventDecoder::getStatistics() { 
     // Automatically clear the statistics after it was read out:
     statistics tmp = decodingStats;
+    clearedStats += decodingStats;
     decodingStats.clear();
     return tmp;
   }
 
+  void dtbEventDecoder::PublishStatistics(bool wait) {
+    statistics live = clearedStats;
+    live += decodingStats;
+    live.m_info_duration = static_cast<uint32_t>(sessionTimer.get());
+    if(wait) { liveStats.set(live); }
+    else { liveStats.tryPublish(live); }
+  }
+
   std::vector<std::vector<uint16_t> > dtbEventDecoder::getReadback() {
     // Automatically clear the readback vector after it was read out:
     std::vector<std::vector<uint16_t> > tmp = readback;
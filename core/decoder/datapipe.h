@@ -2,8 +2,11 @@
 #define PXAR_DATAPIPE_H
 
 #include <stdexcept>
+#include <mutex>
 #include "datatypes.h"
 #include "constants.h"
+#include "timer.h"
+#include "markerscan.h"
 
 namespace pxar {
 
@@ -17,6 +20,21 @@ namespace pxar {
   dpNotConnected() : dataPipeException("Not connected") {}
   };
 
+  // Configuration of a readout channel for one DAQ session. It is provided by
+  // the data source and handed on to every stage when the pipe is connected,
+  // so the stages read it directly instead of asking back along the pipe:
+  struct pipeConfig {
+  pipeConfig() : channel(0), flags(0), tokenChainLength(0), tokenChainOffset(0), envelopeType(0), deviceType(0) {}
+  pipeConfig(uint8_t daqchannel, uint16_t daqflags, uint8_t chainlength, uint8_t chainoffset, uint8_t tbmtype, uint8_t roctype) :
+    channel(daqchannel), flags(daqflags), tokenChainLength(chainlength), tokenChainOffset(chainoffset), envelopeType(tbmtype), deviceType(roctype) {}
+    uint8_t channel;
+    uint16_t flags;
+    uint8_t tokenChainLength;
+    uint8_t tokenChainOffset;
+    uint8_t envelopeType;
+    uint8_t deviceType;
+  };
+
   // Data pipe classes
 
   template <class T> 
@@ -30,7 +48,26 @@ namespace pxar {
     virtual uint8_t ReadTokenChainOffset() = 0;
     virtual uint8_t ReadEnvelopeType() = 0;
     virtual uint8_t ReadDeviceType() = 0;
+    // Block access: hands out all samples of the current data block at once
+    // and marks them as read. Sources holding a buffer should override this,
+    // by default single samples are passed on:
+    virtual void ReadBlock(T *&first, T *&last) {
+      blockSample = Read();
+      first = &blockSample;
+      last = first + 1;
+    }
+    T blockSample;
+    // Configuration handed to the sinks when connecting, the sinks keep a copy of
+    // it. Sources keeping a pipeConfig return their own, by default it is
+    // collected from the Read functions at connection time:
+    virtual const pipeConfig * ReadConfig() {
+      try { sourceConfig = pipeConfig(ReadChannel(), ReadFlags(), ReadTokenChainLength(), ReadTokenChainOffset(), ReadEnvelopeType(), ReadDeviceType()); }
+      catch(dpNotConnected &) { sourceConfig = pipeConfig(); }
+      return &sourceConfig;
+    }
+    pipeConfig sourceConfig;
   public:
+    dataSource() : blockSample(), sourceConfig() {}
     virtual ~dataSource() {}
     template <class S> friend class dataSink;
   };
@@ -61,16 +98,26 @@ namespace pxar {
   protected: 
     dataSource<T> *src;
     static nullSource<T> null;
+    // Copy of the configuration of the connected source, taken when connecting
+    // so it stays valid if a short-lived source goes away:
+    pipeConfig config;
+    void Connect(dataSource<T> *source) {
+      src = source;
+      config = *src->ReadConfig();
+    }
   public: 
-  dataSink() : src(&null) {}
+  dataSink() : src(&null), config() {}
     T GetLast() { return src->ReadLast(); }
     T Get() { return src->Read(); }
-    uint8_t GetChannel() { return src->ReadChannel(); }
-    uint16_t GetFlags() { return src->ReadFlags(); }
-    uint8_t GetTokenChainLength() { return src->ReadTokenChainLength(); }
-    uint8_t GetTokenChainOffset() { return src->ReadTokenChainOffset(); }
-    uint8_t GetEnvelopeType() { return src->ReadEnvelopeType(); }
-    uint8_t GetDeviceType() { return src->ReadDeviceType(); }
+    void GetBlock(T *&first, T *&last) { src->ReadBlock(first, last); }
+    // The channel metadata is read from the configuration taken over when connecting:
+    uint8_t GetChannel() { return config.channel; }
+    uint16_t GetFlags() { return config.flags; }
+    uint8_t GetTokenChainLength() { return config.tokenChainLength; }
+    uint8_t GetTokenChainOffset() { return config.tokenChainOffset; }
+    uint8_t GetEnvelopeType() { return config.envelopeType; }
+    uint8_t GetDeviceType() { return config.deviceType; }
+    const pipeConfig & GetConfig() { return config; }
     void GetAll() { while (true) Get(); }
     template <class TI, class TO> friend void operator >> (dataSource<TI> &, dataSink<TO> &); 
     template  <class TI, class TO> friend dataSource<TO>& operator >> (dataSource<TI> &in, dataPipe<TI,TO> &out);
@@ -79,20 +126,23 @@ namespace pxar {
   template <class T>
     nullSource<T> dataSink<T>::null;
    
-  // The data pipe:
+  // The data pipe, passing on the configuration of its source:
   template <class TI, class TO=TI>
-    class dataPipe : public dataSink<TI>, public dataSource<TO> {};
+    class dataPipe : public dataSink<TI>, public dataSource<TO> {
+    const pipeConfig * ReadConfig() { return &this->config; }
+  };
 
   // Operator to connect source -> sink; source -> datapipe
   template <class TI, class TO>
     void operator >> (dataSource<TI> &in, dataSink<TO> &out) {
-    out.src = &in;
+    out.Connect(&in);
   }
     
   // Operator to connect source -> datapipe -> datapipe -> sink
+  // The configuration is passed on from the source, so connect in this order:
   template <class TI, class TO>
     dataSource<TO>& operator >> (dataSource<TI> &in, dataPipe<TI,TO> &out) {
-    out.src = &in;
+    out.Connect(&in);
     return out;
   }
 
@@ -109,6 +159,9 @@ namespace pxar {
   };
 
   // DTB data Event splitter
+  // Scans the data blocks of the source directly, the records handed out are
+  // views into the current source block. Only events spanning two blocks are
+  // copied.
   class dtbEventSplitter : public dataPipe<uint16_t, rawEvent*> {
     rawEvent record;
     rawEvent* Read();
@@ -125,10 +178,33 @@ namespace pxar {
     void SplitDeser400();
     void SplitSoftTBM();
 
+    // Block access to the source data:
+    uint16_t * blockPos;
+    uint16_t * blockEnd;
+    uint16_t lastWord;
+    void NextBlock();
+    inline uint16_t Next() {
+      if(blockPos == blockEnd) { NextBlock(); }
+      return (lastWord = *blockPos++);
+    }
+    inline void Keep(uint16_t value, uint16_t tag = 0);
+    void KeepRange(uint16_t * first, uint16_t * last);
+    uint16_t NextMarker(uint16_t mask1, uint16_t value1, uint16_t mask2, uint16_t value2);
+    markerScanner scanner;
+
     bool nextStartDetected;
   public:
   dtbEventSplitter() :
-    nextStartDetected(false) {}
+    blockPos(NULL), blockEnd(NULL), lastWord(0x4000), nextStartDetected(false) {}
+    void Clear() { record.Clear(); blockPos = blockEnd = NULL; lastWord = 0x4000; nextStartDetected = false; scanner.Reset(); }
+    // Append the words taken from the source but not split yet and start over, the
+    // next event is searched for in the following source data:
+    size_t Drain(std::vector<uint16_t> & words) {
+      size_t pending = static_cast<size_t>(blockEnd - blockPos);
+      if(pending > 0) { words.insert(words.end(), blockPos, blockEnd); }
+      Clear();
+      return pending;
+    }
   };
 
   // This "splitter" does nothing than passing through all input data as one raw event
@@ -147,6 +223,25 @@ namespace pxar {
     passthroughSplitter() {}
   };
 
+  // Statistics published by a decoder for readers in other threads. The
+  // decoder only tries to publish, so it never waits for a reader:
+  class statisticsSlot {
+    statistics stats;
+    mutable std::mutex lock;
+  public:
+    statisticsSlot() : stats() {}
+    statisticsSlot(const statisticsSlot & other) : stats(other.get()) {}
+    statisticsSlot & operator=(const statisticsSlot & other) { set(other.get()); return *this; }
+    bool tryPublish(const statistics & s) {
+      std::unique_lock<std::mutex> l(lock, std::try_to_lock);
+      if(!l.owns_lock()) return false;
+      stats = s;
+      return true;
+    }
+    void set(const statistics & s) { std::lock_guard<std::mutex> l(lock); stats = s; }
+    statistics get() const { std::lock_guard<std::mutex> l(lock); return stats; }
+  };
+
   // DTB data decoding class
   class dtbEventDecoder : public dataPipe<rawEvent*, Event*> {
     Event roc_Event;
@@ -167,6 +262,17 @@ namespace pxar {
     void ProcessTBMTrailer(uint16_t t1, uint16_t t2);
     statistics decodingStats;
 
+    // Live statistics of the DAQ session, including the counts already handed
+    // out by getStatistics, published every DTB_STATISTICS_PUBLISH events:
+    void PublishStatistics(bool wait);
+    statistics clearedStats;
+    statisticsSlot liveStats;
+    timer sessionTimer;
+    uint32_t publishCount;
+
+    // Decode a pixel hit without exceptions, counting the decoding errors:
+    inline void AddPixel(uint32_t raw, uint8_t roc, bool invertedAddress, bool linearAddress);
+
     // Readback decoding:
     void evalReadback(uint8_t roc, uint16_t val);
     std::vector<bool> readback_dirty;
@@ -190,18 +296,25 @@ namespace pxar {
     int16_t levelS;
     int32_t sumUB, sumB;
     size_t slidingWindow;
+    // Address level of every ADC value, updated when the levels move:
+    std::vector<uint8_t> levelTable;
+    int16_t tableUltrablack, tableBlack;
     
     // Last DAC storage for analog ROCs:
     void evalLastDAC(uint8_t roc, uint16_t val);
 
-    // Debugging mechanism for problematic events
+    // Debugging mechanism for problematic events, keeping copies of the raw
+    // data words of the last events which are only formatted when dumped:
     uint32_t total_event, flawed_event, error_count, dump_count;
-    std::vector<std::string> event_ringbuffer;
+    std::vector<rawEvent> event_ringbuffer;
+    std::vector<bool> event_stored;
 
   public:
-  dtbEventDecoder() : decodingStats(), readback_dirty(), count(), shiftReg(), readback(), eventID(-1), ultrablack(0xfff), black(0xfff), levelS(0), sumUB(0), sumB(0), slidingWindow(0), total_event(5), flawed_event(0), error_count(0), dump_count(0), event_ringbuffer(7) {};
-    void Clear() { decodingStats.clear(); readback.clear(); count.clear(); shiftReg.clear(); eventID = -1; };
+  dtbEventDecoder() : decodingStats(), clearedStats(), liveStats(), sessionTimer(), publishCount(0), readback_dirty(), count(), shiftReg(), readback(), eventID(-1), ultrablack(0xfff), black(0xfff), levelS(0), sumUB(0), sumB(0), slidingWindow(0), levelTable(0x1000,0), tableUltrablack(0xfff), tableBlack(0xfff), total_event(5), flawed_event(0), error_count(0), dump_count(0), event_ringbuffer(7), event_stored(7,false) {};
+    void Clear() { decodingStats.clear(); clearedStats.clear(); liveStats.set(statistics()); sessionTimer = timer(); publishCount = 0; readback.clear(); count.clear(); shiftReg.clear(); eventID = -1; };
     statistics getStatistics();
+    // Non-destructive copy of the statistics since Clear(), safe to call from any thread:
+    statistics getLiveStatistics() { return liveStats.get(); }
     std::vector<std::vector<uint16_t> > getReadback();
     std::vector<uint8_t> getXORsum();
   };
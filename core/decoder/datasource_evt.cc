@@ -6,13 +6,13 @@
 
 namespace pxar {
 
-  evtSource::evtSource(uint8_t daqchannel, uint8_t tokenChainLength, uint8_t offset, uint8_t tbmtype, uint8_t roctype, uint16_t daqflags) : channel(daqchannel), flags(daqflags), chainlength(tokenChainLength), chainlengthOffset(offset), envelopetype(tbmtype), devicetype(roctype), lastSample(0x4000), pos(0), connected(true) {
+  evtSource::evtSource(uint8_t daqchannel, uint8_t tokenChainLength, uint8_t offset, uint8_t tbmtype, uint8_t roctype, uint16_t daqflags) : config(daqchannel, daqflags, tokenChainLength, offset, tbmtype, roctype), lastSample(0x4000), pos(0), connected(true) {
     LOG(logDEBUGPIPES) << "New evtSource instantiated with properties:";
     LOG(logDEBUGPIPES) << "-------------------------";
-    LOG(logDEBUGPIPES) << "Channel " << static_cast<int>(channel)
-		       << " (" << static_cast<int>(chainlength) << " ROCs, "
-		       << static_cast<int>(chainlengthOffset) << "-" << static_cast<int>(chainlengthOffset+chainlength)<< ")"
-		       << (envelopetype == TBM_NONE ? " DESER160 " : (envelopetype == TBM_EMU ? " SOFTTBM " : " DESER400 "));
+    LOG(logDEBUGPIPES) << "Channel " << static_cast<int>(config.channel)
+		       << " (" << static_cast<int>(config.tokenChainLength) << " ROCs, "
+		       << static_cast<int>(config.tokenChainOffset) << "-" << static_cast<int>(config.tokenChainOffset+config.tokenChainLength)<< ")"
+		       << (config.envelopeType == TBM_NONE ? " DESER160 " : (config.envelopeType == TBM_EMU ? " SOFTTBM " : " DESER400 "));
   }
   
   uint16_t evtSource::Read() {
@@ -36,7 +36,7 @@ namespace pxar {
     buffer.insert(buffer.end(), data.begin(), data.end());
     LOG(logDEBUGPIPES) << "-------------------------";
     LOG(logDEBUGPIPES) << "FULL RAW DATA BLOB (" << buffer.size() << " words buffered):";
-    if(devicetype < ROC_PSI46DIG) { LOG(logDEBUGPIPES) << listVector(buffer,false,true); }
+    if(config.deviceType < ROC_PSI46DIG) { LOG(logDEBUGPIPES) << listVector(buffer,false,true); }
     else { LOG(logDEBUGPIPES) << listVector(buffer,true); }
     LOG(logDEBUGPIPES) << "-------------------------";
   }
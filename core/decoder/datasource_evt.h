@@ -11,12 +11,7 @@ namespace pxar {
   // Single event data source class
   class evtSource : public dataSource<uint16_t> {
     // --- Control/state
-    uint8_t channel;
-    uint16_t flags;
-    uint8_t chainlength;
-    uint8_t chainlengthOffset;
-    uint8_t envelopetype;
-    uint8_t devicetype;
+    pipeConfig config;
 
     // --- data buffer
     uint16_t lastSample;
@@ -32,28 +27,29 @@ namespace pxar {
     }
     uint8_t ReadChannel() {
       if(!connected) throw dpNotConnected();
-      return channel;
+      return config.channel;
     }
     uint16_t ReadFlags() {
       if(!connected) throw dpNotConnected();
-      return flags;
+      return config.flags;
     }
     uint8_t ReadTokenChainLength() {
       if(!connected) throw dpNotConnected();
-      return chainlength;
+      return config.tokenChainLength;
     }
     uint8_t ReadTokenChainOffset() {
       if(!connected) throw dpNotConnected();
-      return chainlengthOffset;
+      return config.tokenChainOffset;
     }
     uint8_t ReadEnvelopeType() {
       if(!connected) throw dpNotConnected();
-      return envelopetype;
+      return config.envelopeType;
     }
     uint8_t ReadDeviceType() {
       if(!connected) throw dpNotConnected();
-      return devicetype;
+      return config.deviceType;
     }
+    const pipeConfig * ReadConfig() { return &config; }
   public:
     evtSource(uint8_t daqchannel, uint8_t tokenChainLength, uint8_t offset, uint8_t tbmtype, uint8_t roctype, uint16_t daqflags = 0);
   evtSource() : connected(false) {};
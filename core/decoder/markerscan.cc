@@ -0,0 +1,173 @@
+#include "markerscan.h"
+
+// The vector kernels are built with per-function target attributes, so the
+// library itself does not require SSE2/AVX2 and the decision is made at runtime:
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PXAR_MARKERSCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace pxar {
+
+  typedef uint64_t (*classifyFunction)(const uint16_t *, size_t, uint16_t, uint16_t, uint16_t, uint16_t);
+
+  static uint64_t classifyScalar(const uint16_t * first, size_t n, uint16_t mask1, uint16_t value1, uint16_t mask2, uint16_t value2) {
+    uint64_t bits = 0;
+    for(size_t i = 0; i < n; i++) {
+      if((first[i] & mask1) == value1 || (first[i] & mask2) == value2) { bits |= (static_cast<uint64_t>(1) << i); }
+    }
+    return bits;
+  }
+
+#ifdef PXAR_MARKERSCAN_X86
+  __attribute__((target("sse2")))
+  static uint64_t classifySSE2(const uint16_t * first, size_t n, uint16_t mask1, uint16_t value1, uint16_t mask2, uint16_t value2) {
+    const __m128i m1 = _mm_set1_epi16(static_cast<short>(mask1));
+    const __m128i v1 = _mm_set1_epi16(static_cast<short>(value1));
+    const __m128i m2 = _mm_set1_epi16(static_cast<short>(mask2));
+    const __m128i v2 = _mm_set1_epi16(static_cast<short>(value2));
+    const __m128i zero = _mm_setzero_si128();
+
+    uint64_t bits = 0;
+    size_t i = 0;
+    // Eight words per step, the 16bit compare results are packed to one byte each:
+    for(; i + 8 <= n; i += 8) {
+      __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));
+      __m128i hit = _mm_or_si128(_mm_cmpeq_epi16(_mm_and_si128(w, m1), v1),
+				 _mm_cmpeq_epi16(_mm_and_si128(w, m2), v2));
+      bits |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_packs_epi16(hit, zero))) << i;
+    }
+    if(i < n) { bits |= classifyScalar(first + i, n - i, mask1, value1, mask2, value2) << i; }
+    return bits;
+  }
+
+  __attribute__((target("avx2")))
+  static uint64_t classifyAVX2(const uint16_t * first, size_t n, uint16_t mask1, uint16_t value1, uint16_t mask2, uint16_t value2) {
+    const __m256i m1 = _mm256_set1_epi16(static_cast<short>(mask1));
+    const __m256i v1 = _mm256_set1_epi16(static_cast<short>(value1));
+    const __m256i m2 = _mm256_set1_epi16(static_cast<short>(mask2));
+    const __m256i v2 = _mm256_set1_epi16(static_cast<short>(value2));
+
+    uint64_t bits = 0;
+    size_t i = 0;
+    // 32 words per step. Packing works per 128bit lane, so the quadwords have to be
+    // brought back into word order before extracting the byte mask:
+    for(; i + 32 <= n; i += 32) {
+      __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + i));
+      __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + i + 16));
+      __m256i hita = _mm256_or_si256(_mm256_cmpeq_epi16(_mm256_and_si256(a, m1), v1),
+				     _mm256_cmpeq_epi16(_mm256_and_si256(a, m2), v2));
+      __m256i hitb = _mm256_or_si256(_mm256_cmpeq_epi16(_mm256_and_si256(b, m1), v1),
+				     _mm256_cmpeq_epi16(_mm256_and_si256(b, m2), v2));
+      __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(hita, hitb), 0xd8);
+      bits |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(packed))) << i;
+    }
+    // Remaining words in 128bit steps. These are VEX encoded here, calling the SSE2
+    // kernel instead would pay the AVX-SSE transition penalty:
+    for(; i + 8 <= n; i += 8) {
+      __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));
+      __m128i hit = _mm_or_si128(_mm_cmpeq_epi16(_mm_and_si128(w, _mm256_castsi256_si128(m1)), _mm256_castsi256_si128(v1)),
+				 _mm_cmpeq_epi16(_mm_and_si128(w, _mm256_castsi256_si128(m2)), _mm256_castsi256_si128(v2)));
+      bits |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_packs_epi16(hit, _mm_setzero_si128()))) << i;
+    }
+    if(i < n) { bits |= classifyScalar(first + i, n - i, mask1, value1, mask2, value2) << i; }
+    return bits;
+  }
+#endif
+
+  static bool kernelSupported(markerKernel kernel) {
+    if(kernel == MARKER_SCALAR) return true;
+#ifdef PXAR_MARKERSCAN_X86
+    __builtin_cpu_init();
+    if(kernel == MARKER_SSE2) return __builtin_cpu_supports("sse2");
+    if(kernel == MARKER_AVX2) return __builtin_cpu_supports("avx2");
+#endif
+    return false;
+  }
+
+  static classifyFunction kernelFunction(markerKernel kernel) {
+#ifdef PXAR_MARKERSCAN_X86
+    if(kernel == MARKER_AVX2) return classifyAVX2;
+    if(kernel == MARKER_SSE2) return classifySSE2;
+#endif
+    return classifyScalar;
+  }
+
+  static markerKernel bestKernel() {
+    if(kernelSupported(MARKER_AVX2)) return MARKER_AVX2;
+    if(kernelSupported(MARKER_SSE2)) return MARKER_SSE2;
+    return MARKER_SCALAR;
+  }
+
+  static markerKernel currentKernel = bestKernel();
+  static classifyFunction classify = kernelFunction(currentKernel);
+
+  static inline size_t firstBit(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<size_t>(__builtin_ctzll(bits));
+#else
+    size_t i = 0;
+    while(!(bits & 1)) { bits >>= 1; i++; }
+    return i;
+#endif
+  }
+
+  uint64_t classifyMarkers(const uint16_t * first, size_t n, uint16_t mask1, uint16_t value1, uint16_t mask2, uint16_t value2) {
+    return classify(first, (n > 64 ? 64 : n), mask1, value1, mask2, value2);
+  }
+
+  uint16_t * findMarker(uint16_t * first, uint16_t * last, uint16_t mask1, uint16_t value1, uint16_t mask2, uint16_t value2) {
+    while(first < last) {
+      size_t n = static_cast<size_t>(last - first);
+      if(n > 64) { n = 64; }
+      uint64_t bits = classify(first, n, mask1, value1, mask2, value2);
+      if(bits) { return first + firstBit(bits); }
+      first += n;
+    }
+    return last;
+  }
+
+  void markerScanner::SetMarkers(uint16_t mask1, uint16_t value1, uint16_t mask2, uint16_t value2) {
+    if(mask1 == m_mask1 && value1 == m_value1 && mask2 == m_mask2 && value2 == m_value2) return;
+    m_mask1 = mask1; m_value1 = value1;
+    m_mask2 = mask2; m_value2 = value2;
+    Reset();
+  }
+
+  uint16_t * markerScanner::Find(uint16_t * first, uint16_t * last) {
+    while(first < last) {
+      // Classify the next 64 words unless the position is covered by the last block:
+      if(first < m_base || first >= m_base + m_length) {
+	m_base = first;
+	m_length = static_cast<size_t>(last - first);
+	if(m_length > 64) { m_length = 64; }
+	m_bits = classify(m_base, m_length, m_mask1, m_value1, m_mask2, m_value2);
+      }
+
+      // Jump to the next marker in the classified block:
+      uint64_t pending = m_bits >> (first - m_base);
+      if(pending) {
+	uint16_t * marker = first + firstBit(pending);
+	return (marker < last ? marker : last);
+      }
+      first = m_base + m_length;
+    }
+    return last;
+  }
+
+  markerKernel getMarkerKernel() { return currentKernel; }
+
+  bool setMarkerKernel(markerKernel kernel) {
+    if(!kernelSupported(kernel)) return false;
+    currentKernel = kernel;
+    classify = kernelFunction(kernel);
+    return true;
+  }
+
+  const char * getMarkerKernelName(markerKernel kernel) {
+    if(kernel == MARKER_AVX2) return "AVX2";
+    if(kernel == MARKER_SSE2) return "SSE2";
+    return "scalar";
+  }
+
+} // namespace pxar
@@ -0,0 +1,75 @@
+#ifndef PXAR_MARKERSCAN_H
+#define PXAR_MARKERSCAN_H
+
+#include <stdint.h>
+#include <cstddef>
+#include "pxardllexport.h"
+
+namespace pxar {
+
+  // Marker scanning on raw DTB data words
+  // A word matches a marker if (word & mask) == value. The kernels classify
+  // blocks of up to 64 words at once, SSE2 and AVX2 implementations are
+  // selected at runtime if the CPU supports them, with a scalar fallback.
+
+  enum markerKernel {
+    MARKER_SCALAR,
+    MARKER_SSE2,
+    MARKER_AVX2
+  };
+
+  /** Classify the words [first,first+n) with n <= 64: bit i of the returned
+   *  mask is set if word i matches marker 1 or marker 2.
+   */
+  DLLEXPORT uint64_t classifyMarkers(const uint16_t * first, size_t n, uint16_t mask1, uint16_t value1, uint16_t mask2, uint16_t value2);
+
+  /** Return the first word in [first,last) matching marker 1 or marker 2,
+   *  or last if there is none.
+   */
+  DLLEXPORT uint16_t * findMarker(uint16_t * first, uint16_t * last, uint16_t mask1, uint16_t value1, uint16_t mask2, uint16_t value2);
+
+  /** Marker search on a data block, classifying each word only once: the
+   *  classification of the last 64 words is kept, so consecutive searches
+   *  jump between the markers found there. The data words must not change
+   *  between calls, Reset() has to be called when moving to a new block.
+   */
+  class DLLEXPORT markerScanner {
+  public:
+  markerScanner() : m_mask1(0), m_value1(1), m_mask2(0), m_value2(1), m_base(NULL), m_length(0), m_bits(0) {}
+
+    /** Set the two markers to search for, resets the scanner if they changed
+     */
+    void SetMarkers(uint16_t mask1, uint16_t value1, uint16_t mask2, uint16_t value2);
+
+    /** Return the first word in [first,last) matching one of the markers,
+     *  or last if there is none.
+     */
+    uint16_t * Find(uint16_t * first, uint16_t * last);
+
+    /** Forget the classification of the previous data block
+     */
+    void Reset() { m_base = NULL; m_length = 0; m_bits = 0; }
+
+  private:
+    uint16_t m_mask1, m_value1, m_mask2, m_value2;
+    uint16_t * m_base;
+    size_t m_length;
+    uint64_t m_bits;
+  };
+
+  /** Kernel currently used by classifyMarkers and findMarker
+   */
+  DLLEXPORT markerKernel getMarkerKernel();
+
+  /** Select the kernel to be used. Returns false and keeps the current one if
+   *  the CPU does not support the requested kernel.
+   */
+  DLLEXPORT bool setMarkerKernel(markerKernel kernel);
+
+  /** Returns the name of the kernel, e.g. for benchmark output
+   */
+  DLLEXPORT const char * getMarkerKernelName(markerKernel kernel);
+
+} // namespace pxar
+
+#endif // PXAR_MARKERSCAN_H
@@ -3,31 +3,107 @@
 #include "log.h"
 #include "constants.h"
 #include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "generator.h"
 
 namespace pxar {
   
-  pxar::pixel getNoiseHit(uint8_t rocid, size_t i, size_t j) {
+  emulatorEngine::emulatorEngine() : m_seed(EMULATOR_SEED), m_triggers(0), m_threads(1) {
+    setThreads(0);
+  }
+
+  void emulatorEngine::setThreads(size_t threads) {
+    if(threads == 0) threads = std::thread::hardware_concurrency();
+    m_threads = std::max(threads, static_cast<size_t>(1));
+  }
+
+  void emulatorEngine::generate(std::vector<std::vector<uint16_t> > & buffers, const std::vector<size_t> & rocs, uint8_t tbm, size_t firstEvent, size_t nTriggers, const std::vector<uint16_t> & pattern, uint32_t flags, bool noise, const emulatorLoop & loop) {
+
+    size_t channels = rocs.size();
+    if(channels == 0 || nTriggers == 0) return;
+    uint64_t firstTrigger = m_triggers;
+    m_triggers += nTriggers;
+
+    // Split every channel into enough shards to keep all threads busy:
+    size_t chunks = std::min((m_threads + channels - 1)/channels, nTriggers/EMULATOR_SHARD_MIN);
+    if(chunks == 0) chunks = 1;
+    size_t nshards = channels*chunks;
+    size_t nthreads = std::min(m_threads, nshards);
+
+    // Serial generation writes to the channel buffers directly:
+    if(nthreads <= 1) {
+      for(size_t ch = 0; ch < channels; ch++) {
+	fillShard(buffers.at(ch), ch, rocs.at(ch), tbm, firstEvent, firstTrigger, 0, nTriggers, pattern, flags, noise, loop);
+      }
+      return;
+    }
+
+    LOG(logDEBUGRPC) << "Generating " << nTriggers << " triggers on " << channels << " channels in "
+		     << nshards << " shards, " << nthreads << " threads";
+    std::vector<std::vector<uint16_t> > shards(nshards);
+    std::atomic<size_t> next(0);
+    std::function<void()> worker = [&]() {
+      for(size_t s = next++; s < nshards; s = next++) {
+	size_t ch = s/chunks, chunk = s%chunks;
+	fillShard(shards.at(s), ch, rocs.at(ch), tbm, firstEvent, firstTrigger, nTriggers*chunk/chunks, nTriggers*(chunk+1)/chunks, pattern, flags, noise, loop);
+      }
+    };
+    std::vector<std::thread> pool;
+    for(size_t t = 1; t < nthreads; t++) { pool.push_back(std::thread(worker)); }
+    worker();
+    for(std::vector<std::thread>::iterator t = pool.begin(); t != pool.end(); ++t) { t->join(); }
+
+    // Append the shards of every channel in trigger order:
+    for(size_t ch = 0; ch < channels; ch++) {
+      std::vector<uint16_t> & data = buffers.at(ch);
+      size_t size = data.size();
+      for(size_t chunk = 0; chunk < chunks; chunk++) { size += shards.at(ch*chunks + chunk).size(); }
+      if(data.capacity() < size) { data.reserve(std::max(size, 2*data.capacity())); }
+      for(size_t chunk = 0; chunk < chunks; chunk++) {
+	std::vector<uint16_t> & shard = shards.at(ch*chunks + chunk);
+	data.insert(data.end(), shard.begin(), shard.end());
+      }
+    }
+  }
+
+  void emulatorEngine::fillShard(std::vector<uint16_t> & data, size_t channel, size_t nrocs, uint8_t tbm, size_t firstEvent, uint64_t firstTrigger, size_t first, size_t last, const std::vector<uint16_t> & pattern, uint32_t flags, bool noise, const emulatorLoop & loop) {
+
+    // Headers, trailers and one hit per ROC, growing geometrically over repeated calls:
+    size_t size = data.size() + (last - first)*(4 + 3*nrocs);
+    if(data.capacity() < size) { data.reserve(std::max(size, 2*data.capacity())); }
+
+    for(size_t n = first; n < last; n++) {
+      emulatorRandom rng(m_seed, firstTrigger + n, channel);
+      uint8_t col = 0, row = 0;
+      bool respond = loop(n, rng, col, row);
+      fillRawData(firstEvent + n, data, tbm, nrocs, !respond, noise, col, row, rng, pattern, flags);
+    }
+  }
+
+  pxar::pixel getNoiseHit(uint8_t rocid, size_t i, size_t j, emulatorRandom & rng) {
 
     // Generate a slightly random pulse height between 80 and 100:
-    uint16_t pulseheight = rand()%20 + 80;
+    uint16_t pulseheight = rng()%20 + 80;
 
     // We can't pulse the same pixel twice in one trigger:
-    size_t col = rand()%52;
-    while(col == i) col = rand()%52;
-    size_t row = rand()%80;
-    while(row == j) row = rand()%80;
+    size_t col = rng()%52;
+    while(col == i) col = rng()%52;
+    size_t row = rng()%80;
+    while(row == j) row = rng()%80;
 
     pixel px = pixel(rocid,col,row,pulseheight);
     LOG(logDEBUGPIPES) << "Adding noise hit: " << px;
     return px;
   }
 
-  pxar::pixel getTriggeredHit(uint8_t rocid, size_t col, size_t row, uint32_t flags) {
+  pxar::pixel getTriggeredHit(uint8_t rocid, size_t col, size_t row, uint32_t flags, emulatorRandom & rng) {
 
     pixel px;
 
     // Generate a slightly random pulse height between 90 and 100:
-    uint16_t pulseheight = rand() % 2 + 90;
+    uint16_t pulseheight = rng() % 2 + 90;
 
     // Introduce some address encoding issues:
     if((flags&FLAG_CHECK_ORDER) != 0 && col == 0 && row == 1) { px = pixel(rocid,col,row+1,pulseheight); } // PX 0,1 answers as PX 0,2
@@ -37,7 +113,7 @@ namespace pxar {
     return px;
   }
   
-  bool isInTornadoRegion(size_t dac1min, size_t dac1max, size_t dac1, size_t dac2min, size_t dac2max, size_t dac2) {
+  bool isInTornadoRegion(size_t dac1min, size_t dac1max, size_t dac1, size_t dac2min, size_t dac2max, size_t dac2, emulatorRandom & rng) {
 
     size_t epsilon = 5;
     double tornadowidth = 40;
@@ -46,17 +122,17 @@ namespace pxar {
     if(dac2 < ymax && dac2 > ymin) {
       size_t dymax = ymax - dac2;
       size_t dymin = dac2 - ymin;
-      if(dymax < epsilon) return (rand()%(epsilon-dymax) == 0);
-      else if(dymin < epsilon) return (rand()%(epsilon-dymin) == 0);
+      if(dymax < epsilon) return (rng()%(epsilon-dymax) == 0);
+      else if(dymin < epsilon) return (rng()%(epsilon-dymin) == 0);
       else return true;
     }
     else return false;
   }
 
-  void fillEvent(pxar::Event * evt, uint8_t rocid, size_t col, size_t row, uint32_t flags) {
+  void fillEvent(pxar::Event * evt, uint8_t rocid, size_t col, size_t row, uint32_t flags, emulatorRandom & rng) {
 
     // Generate a slightly random pulse height between 90 and 100:
-    uint16_t pulseheight = rand() % 2 + 90;
+    uint16_t pulseheight = rng() % 2 + 90;
 
     // Introduce some address encoding issues:
     if((flags&FLAG_CHECK_ORDER) != 0 && col == 0 && row == 1) { evt->pixels.push_back(pixel(rocid,col,row+1,pulseheight));} // PX 0,1 answers as PX 0,2
@@ -65,11 +141,11 @@ namespace pxar {
     else { evt->pixels.push_back(pixel(rocid,col,row,pulseheight)); }
 
     // If the full chip is unmasked, add some noise hits:
-    if((flags&FLAG_FORCE_UNMASKED) != 0 && (rand()%4) == 0) { evt->pixels.push_back(getNoiseHit(rocid,col,row)); }
+    if((flags&FLAG_FORCE_UNMASKED) != 0 && (rng()%4) == 0) { evt->pixels.push_back(getNoiseHit(rocid,col,row,rng)); }
 
   }
 
-  void fillRawData(uint32_t event, std::vector<uint16_t> &data, uint8_t tbm, uint8_t nroc, bool empty, bool noise, size_t col, size_t row, std::vector<uint16_t> pattern, uint32_t flags) {
+  void fillRawData(uint32_t event, std::vector<uint16_t> &data, uint8_t tbm, uint8_t nroc, bool empty, bool noise, size_t col, size_t row, emulatorRandom & rng, const std::vector<uint16_t> & pattern, uint32_t flags) {
 
     size_t pos = data.size();
     
@@ -89,17 +165,18 @@ namespace pxar {
       if(!empty) {
 	// Add pixel hit:
 	pxar::pixel px;
-	if(noise) px = getNoiseHit(roc,col,row);
-	else px = getTriggeredHit(roc,col,row,flags);
+	if(noise) px = getNoiseHit(roc,col,row,rng);
+	else px = getTriggeredHit(roc,col,row,flags,rng);
       
-	data.push_back(0x0000 | ((px.encode() >> 12) & 0x0fff));
-	data.push_back(0x2000 | (px.encode() & 0x0fff));
+	uint32_t raw = px.encode();
+	data.push_back(0x0000 | ((raw >> 12) & 0x0fff));
+	data.push_back(0x2000 | (raw & 0x0fff));
 
 	// If the full chip is unmasked, add some noise hits:
-	if((flags&FLAG_FORCE_UNMASKED) != 0 && (rand()%4) == 0) {
-	  px = getNoiseHit(roc,col,row);
-	  data.push_back(0x0000 | ((px.encode() >> 12) & 0x0fff));
-	  data.push_back(0x2000 | (px.encode() & 0x0fff));
+	if((flags&FLAG_FORCE_UNMASKED) != 0 && (rng()%4) == 0) {
+	  raw = getNoiseHit(roc,col,row,rng).encode();
+	  data.push_back(0x0000 | ((raw >> 12) & 0x0fff));
+	  data.push_back(0x2000 | (raw & 0x0fff));
 	}
       }
     }
@@ -27,15 +27,75 @@ typedef unsigned char uint8_t;
 #include "api.h"
 #include "datatypes.h"
 #include <stdlib.h>
+#include <functional>
+
+// Default seed of the emulator random number streams:
+#define EMULATOR_SEED 0x5eed
+// Minimum number of triggers per shard when generating data in parallel:
+#define EMULATOR_SHARD_MIN 256
 
 namespace pxar {
+
+  /** Random numbers for the emulator. Every trigger and channel has its own
+   *  stream derived from the engine seed, so the generated data neither depends
+   *  on the order the triggers are processed in nor on the number of threads.
+   */
+  class emulatorRandom {
+  public:
+  emulatorRandom(uint64_t seed, uint64_t trigger, uint64_t channel) : m_state(mix(mix(seed + mix(channel + 1)) + trigger)) {}
+    uint32_t operator()() { return static_cast<uint32_t>(mix(m_state += 0x9e3779b97f4a7c15ULL) >> 32); }
+  private:
+    // splitmix64 finalizer:
+    static uint64_t mix(uint64_t z) {
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      return z ^ (z >> 31);
+    }
+    uint64_t m_state;
+  };
+
+  /** Trigger sequence of a test loop: sets the pixel to be calibrated for trigger n
+   *  and returns whether the ROCs respond to it.
+   */
+  typedef std::function<bool(size_t n, emulatorRandom & rng, uint8_t & col, uint8_t & row)> emulatorLoop;
+
+  /** Data generation of the DTB emulator. The triggers of every channel are split
+   *  into shards which are generated concurrently and appended in trigger order.
+   */
+  class emulatorEngine {
+  public:
+    emulatorEngine();
+
+    /** Restart the random number streams from the given seed
+     */
+    void setSeed(uint64_t seed) { m_seed = seed; m_triggers = 0; }
+
+    /** Set the number of generator threads, 0 selects the hardware concurrency
+     */
+    void setThreads(size_t threads);
+
+    /** Append nTriggers events starting at event number firstEvent to the buffers of
+     *  channels 0 to rocs.size()-1, with rocs[ch] ROCs read out on channel ch.
+     */
+    void generate(std::vector<std::vector<uint16_t> > & buffers, const std::vector<size_t> & rocs, uint8_t tbm, size_t firstEvent, size_t nTriggers, const std::vector<uint16_t> & pattern, uint32_t flags, bool noise, const emulatorLoop & loop);
+
+    /** Random number stream for a single trigger outside the test loops
+     */
+    emulatorRandom random(size_t channel) { return emulatorRandom(m_seed, m_triggers++, channel); }
+
+  private:
+    void fillShard(std::vector<uint16_t> & data, size_t channel, size_t nrocs, uint8_t tbm, size_t firstEvent, uint64_t firstTrigger, size_t first, size_t last, const std::vector<uint16_t> & pattern, uint32_t flags, bool noise, const emulatorLoop & loop);
+    uint64_t m_seed;
+    uint64_t m_triggers;
+    size_t m_threads;
+  };
+
+  pxar::pixel getNoiseHit(uint8_t rocid, size_t i, size_t j, emulatorRandom & rng);
+  pxar::pixel getTriggeredHit(uint8_t rocid, size_t col, size_t row, uint32_t flags, emulatorRandom & rng);
   
-  pxar::pixel getNoiseHit(uint8_t rocid, size_t i, size_t j);
-  pxar::pixel getTriggeredHit(uint8_t rocid, size_t col, size_t row, uint32_t flags);
-  
-  bool isInTornadoRegion(size_t dac1min, size_t dac1max, size_t dac1, size_t dac2min, size_t dac2max, size_t dac2);
-  void fillEvent(pxar::Event * evt, uint8_t rocid, size_t col, size_t row, uint32_t flags);
-  void fillRawData(uint32_t event, std::vector<uint16_t> &data, uint8_t tbm, uint8_t nrocs, bool empty, bool noise, size_t col, size_t row, std::vector<uint16_t> pattern = std::vector<uint16_t>(), uint32_t flags = 0);
+  bool isInTornadoRegion(size_t dac1min, size_t dac1max, size_t dac1, size_t dac2min, size_t dac2max, size_t dac2, emulatorRandom & rng);
+  void fillEvent(pxar::Event * evt, uint8_t rocid, size_t col, size_t row, uint32_t flags, emulatorRandom & rng);
+  void fillRawData(uint32_t event, std::vector<uint16_t> &data, uint8_t tbm, uint8_t nrocs, bool empty, bool noise, size_t col, size_t row, emulatorRandom & rng, const std::vector<uint16_t> & pattern = std::vector<uint16_t>(), uint32_t flags = 0);
   
 }
 
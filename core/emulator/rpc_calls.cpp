@@ -283,17 +283,9 @@ void CTestboard::Pg_Trigger() {
 void CTestboard::Pg_Triggers(uint32_t nTriggers, uint16_t) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
-  // Check how many open DAQ channels we have:
-  size_t channels = std::count(daq_status.begin(), daq_status.end(), true);
-  // Distribute the ROCs evenly:
-  size_t roc_per_ch = roci2c.size()/channels;
-
-  for(size_t i = 0; i < nTriggers; i++) {
-    for(size_t ch = 0; ch < channels; ch++) {
-      size_t rocs = notokenpass(tbmtype,ch) ? 0 : roc_per_ch;
-      fillRawData(i,daq_buffer.at(ch),tbmtype,rocs,false,true,0,0);
-    }
-  }
+  // One noise hit per ROC on every trigger:
+  emulator.generate(daq_buffer, rocsPerChannel(roci2c.size(),true), tbmtype, 0, nTriggers, std::vector<uint16_t>(), 0, true,
+		    [](size_t, pxar::emulatorRandom &, uint8_t &, uint8_t &) { return true; });
 }
 
 // FIXME Receiving loop command
@@ -407,7 +399,8 @@ uint8_t CTestboard::Daq_Read(std::vector<uint16_t> &data, uint32_t blocksize, ui
     eventcounter++;
     LOG(logDEBUGRPC) << "Event counter: " << eventcounter;
     if(!daq_status.at(channel)) { available = 0; return 0; }
-    fillRawData(daq_event.at(channel)++,daq_buffer.at(channel),tbmtype,roci2c.size(),false,true,0,0,pg_setup);
+    pxar::emulatorRandom rng = emulator.random(channel);
+    fillRawData(daq_event.at(channel)++,daq_buffer.at(channel),tbmtype,roci2c.size(),false,true,0,0,rng,pg_setup);
     mDelay(10);
   }
 
@@ -615,26 +608,30 @@ bool CTestboard::notokenpass(uint8_t tbmtype, uint8_t channel) {
   return (tbm_registers.at(hubid).at(core)[0x0]&0x40);
 }
 
-bool CTestboard::LoopMultiRocAllPixelsCalibrate(std::vector<uint8_t> &roci2cs, uint16_t nTriggers, uint16_t flags) {
-  LOG(pxar::logDEBUGRPC) << "called.";
+std::vector<size_t> CTestboard::rocsPerChannel(size_t nrocs, bool tokenpass) {
 
   // Check how many open DAQ channels we have:
   size_t channels = std::count(daq_status.begin(), daq_status.end(), true);
   // Distribute the ROCs evenly:
-  size_t roc_per_ch = (roci2cs.size()/channels);
-
-  uint32_t event = 0;
-  for(size_t i = 0; i < ROC_NUMCOLS; i++) {
-    for(size_t j = 0; j < ROC_NUMROWS; j++) {
-      for(size_t k = 0; k < nTriggers; k++) {
-	for(size_t ch = 0; ch < channels; ch++) {
-	  size_t rocs = notokenpass(tbmtype,ch) ? 0 : roc_per_ch;
-	  fillRawData(event,daq_buffer.at(ch),tbmtype,rocs,false,false,i,j,pg_setup,flags);
-	}
-	event++;
-      }
-    }
+  std::vector<size_t> rocs(channels, channels ? nrocs/channels : 0);
+  if(tokenpass) {
+    for(size_t ch = 0; ch < channels; ch++) { if(notokenpass(tbmtype,ch)) rocs.at(ch) = 0; }
   }
+  return rocs;
+}
+
+bool CTestboard::LoopMultiRocAllPixelsCalibrate(std::vector<uint8_t> &roci2cs, uint16_t nTriggers, uint16_t flags) {
+  LOG(pxar::logDEBUGRPC) << "called.";
+
+  size_t & event = daq_event.at(0);
+  size_t n = ROC_NUMCOLS*ROC_NUMROWS*nTriggers;
+  emulator.generate(daq_buffer, rocsPerChannel(roci2cs.size(),true), tbmtype, event, n, pg_setup, flags, false,
+		    [&](size_t trg, pxar::emulatorRandom &, uint8_t & col, uint8_t & row) {
+		      size_t px = trg/nTriggers;
+		      col = px/ROC_NUMROWS; row = px%ROC_NUMROWS;
+		      return true;
+		    });
+  event += n;
   
   return 1;
 }
@@ -642,18 +639,13 @@ bool CTestboard::LoopMultiRocAllPixelsCalibrate(std::vector<uint8_t> &roci2cs, u
 bool CTestboard::LoopMultiRocOnePixelCalibrate(std::vector<uint8_t> &roci2cs, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
-  // Check how many open DAQ channels we have:
-  size_t channels = std::count(daq_status.begin(), daq_status.end(), true);
-  // Distribute the ROCs evenly:
-  size_t roc_per_ch = roci2cs.size()/channels;
-
-  uint32_t event = 0;
-  for(size_t k = 0; k < nTriggers; k++) {
-    for(size_t ch = 0; ch < channels; ch++) {
-      fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,false,false,column,row,pg_setup,flags);
-    }
-    event++;
-  }
+  size_t & event = daq_event.at(0);
+  emulator.generate(daq_buffer, rocsPerChannel(roci2cs.size(),false), tbmtype, event, nTriggers, pg_setup, flags, false,
+		    [&](size_t, pxar::emulatorRandom &, uint8_t & col, uint8_t & r) {
+		      col = column; r = row;
+		      return true;
+		    });
+  event += nTriggers;
   
   return 1;
 }
@@ -661,15 +653,15 @@ bool CTestboard::LoopMultiRocOnePixelCalibrate(std::vector<uint8_t> &roci2cs, ui
 bool CTestboard::LoopSingleRocAllPixelsCalibrate(uint8_t, uint16_t nTriggers, uint16_t flags) {
   LOG(pxar::logDEBUGRPC) << "called.";
   
-  uint32_t event = 0;
-  for(size_t i = 0; i < ROC_NUMCOLS; i++) {
-    for(size_t j = 0; j < ROC_NUMROWS; j++) {
-      for(size_t k = 0; k < nTriggers; k++) {
-	fillRawData(event,daq_buffer.at(0),tbmtype,1,false,false,i,j,pg_setup,flags);
-	event++;
-      }
-    }
-  }
+  size_t & event = daq_event.at(0);
+  size_t n = ROC_NUMCOLS*ROC_NUMROWS*nTriggers;
+  emulator.generate(daq_buffer, std::vector<size_t>(1,1), tbmtype, event, n, pg_setup, flags, false,
+		    [&](size_t trg, pxar::emulatorRandom &, uint8_t & col, uint8_t & row) {
+		      size_t px = trg/nTriggers;
+		      col = px/ROC_NUMROWS; row = px%ROC_NUMROWS;
+		      return true;
+		    });
+  event += n;
   
   return 1;
 }
@@ -677,15 +669,23 @@ bool CTestboard::LoopSingleRocAllPixelsCalibrate(uint8_t, uint16_t nTriggers, ui
 bool CTestboard::LoopSingleRocOnePixelCalibrate(uint8_t, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
-  uint32_t event = 0;
-  for(size_t k = 0; k < nTriggers; k++) {
-    fillRawData(event,daq_buffer.at(0),tbmtype,1,false,false,column,row,pg_setup,flags);
-    event++;
-  }
+  size_t & event = daq_event.at(0);
+  emulator.generate(daq_buffer, std::vector<size_t>(1,1), tbmtype, event, nTriggers, pg_setup, flags, false,
+		    [&](size_t, pxar::emulatorRandom &, uint8_t & col, uint8_t & r) {
+		      col = column; r = row;
+		      return true;
+		    });
+  event += nTriggers;
   
   return 1;
 }
 
+// Mimic some edge at 50% of the DAC range:
+static bool hasDacEdge(size_t dac, uint8_t dacmin, uint8_t dacmax, uint16_t flags) {
+  uint8_t dachalf = static_cast<uint8_t>(dacmax-dacmin)/2;
+  return (((flags&FLAG_RISING_EDGE) && dac > dachalf) || (!(flags&FLAG_RISING_EDGE) && dac < dachalf));
+}
+
 bool CTestboard::LoopMultiRocAllPixelsDacScan(std::vector<uint8_t> &roci2cs, uint16_t nTriggers, uint16_t flags, uint8_t dacreg, uint8_t dacmin, uint8_t dacmax) {
   return LoopMultiRocAllPixelsDacScan(roci2cs, nTriggers, flags, dacreg, 1, dacmin, dacmax);
 }
@@ -693,30 +693,16 @@ bool CTestboard::LoopMultiRocAllPixelsDacScan(std::vector<uint8_t> &roci2cs, uin
 bool CTestboard::LoopMultiRocAllPixelsDacScan(std::vector<uint8_t> &roci2cs, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dacstep, uint8_t dacmin, uint8_t dacmax) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
-  // Check how many open DAQ channels we have:
-  size_t channels = std::count(daq_status.begin(), daq_status.end(), true);
-  // Distribute the ROCs evenly:
-  size_t roc_per_ch = roci2cs.size()/channels;
-
-  uint8_t dachalf = static_cast<uint8_t>(dacmax-dacmin)/2;
-  uint32_t event = 0;
-
-  for(size_t i = 0; i < ROC_NUMCOLS; i++) {
-    for(size_t j = 0; j < ROC_NUMROWS; j++) {
-      for(size_t dac = 0; dac < static_cast<size_t>(dacmax-dacmin+1); dac += dacstep) {
-	for(size_t k = 0; k < nTriggers; k++) {
-	  for(size_t ch = 0; ch < channels; ch++) {
-	    // Mimic some edge at 50% of the DAC range:
-	    if(((flags&FLAG_RISING_EDGE) && dac > dachalf) || (!(flags&FLAG_RISING_EDGE) && dac < dachalf)) {
-	      fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,false,false,i,j,pg_setup,flags);
-	    }
-	    else { fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,true, false,i,j,pg_setup,flags); }
-	  }
-	  event++;
-	}
-      }
-    }
-  }
+  size_t & event = daq_event.at(0);
+  size_t ndac = (dacmax-dacmin)/dacstep + 1;
+  size_t n = ROC_NUMCOLS*ROC_NUMROWS*ndac*nTriggers;
+  emulator.generate(daq_buffer, rocsPerChannel(roci2cs.size(),false), tbmtype, event, n, pg_setup, flags, false,
+		    [&](size_t trg, pxar::emulatorRandom &, uint8_t & col, uint8_t & row) {
+		      size_t step = trg/nTriggers, px = step/ndac;
+		      col = px/ROC_NUMROWS; row = px%ROC_NUMROWS;
+		      return hasDacEdge((step%ndac)*dacstep, dacmin, dacmax, flags);
+		    });
+  event += n;
   
   return 1;
 }
@@ -728,26 +714,14 @@ bool CTestboard::LoopMultiRocOnePixelDacScan(std::vector<uint8_t> &roci2cs, uint
 bool CTestboard::LoopMultiRocOnePixelDacScan(std::vector<uint8_t> &roci2cs, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dacstep, uint8_t dacmin, uint8_t dacmax) {
   LOG(pxar::logDEBUGRPC) << "called.";
   
-  // Check how many open DAQ channels we have:
-  size_t channels = std::count(daq_status.begin(), daq_status.end(), true);
-  // Distribute the ROCs evenly:
-  size_t roc_per_ch = roci2cs.size()/channels;
-
-  uint8_t dachalf = static_cast<uint8_t>(dacmax-dacmin)/2;
-  uint32_t event = 0;
-
-  for(size_t dac = 0; dac < static_cast<size_t>(dacmax-dacmin+1); dac += dacstep) {
-    for(size_t k = 0; k < nTriggers; k++) {
-      for(size_t ch = 0; ch < channels; ch++) {
-	// Mimic some edge at 50% of the DAC range:
-	if(((flags&FLAG_RISING_EDGE) && dac > dachalf) || (!(flags&FLAG_RISING_EDGE) && dac < dachalf)) {
-	  fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,false,false,column,row,pg_setup,flags);
-	}
-	else { fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,true, false,column,row,pg_setup,flags); }
-      }
-      event++;
-    }
-  }
+  size_t & event = daq_event.at(0);
+  size_t n = ((dacmax-dacmin)/dacstep + 1)*nTriggers;
+  emulator.generate(daq_buffer, rocsPerChannel(roci2cs.size(),false), tbmtype, event, n, pg_setup, flags, false,
+		    [&](size_t trg, pxar::emulatorRandom &, uint8_t & col, uint8_t & r) {
+		      col = column; r = row;
+		      return hasDacEdge((trg/nTriggers)*dacstep, dacmin, dacmax, flags);
+		    });
+  event += n;
   
   return 1;
 }
@@ -759,23 +733,16 @@ bool CTestboard::LoopSingleRocAllPixelsDacScan(uint8_t roci2c, uint16_t nTrigger
 bool CTestboard::LoopSingleRocAllPixelsDacScan(uint8_t, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dacstep, uint8_t dacmin, uint8_t dacmax) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
-  uint8_t dachalf = static_cast<uint8_t>(dacmax-dacmin)/2;
-  uint32_t event = 0;
-
-  for(size_t i = 0; i < ROC_NUMCOLS; i++) {
-    for(size_t j = 0; j < ROC_NUMROWS; j++) {
-      for(size_t dac = 0; dac < static_cast<size_t>(dacmax-dacmin+1); dac += dacstep) {
-	for(size_t k = 0; k < nTriggers; k++) {
-	  // Mimic some edge at 50% of the DAC range:
-	  if(((flags&FLAG_RISING_EDGE) && dac > dachalf) || (!(flags&FLAG_RISING_EDGE) && dac < dachalf)) {
-	    fillRawData(event,daq_buffer.at(0),tbmtype,1,false,false,i,j,pg_setup,flags);
-	  }
-	  else { fillRawData(event,daq_buffer.at(0),tbmtype,1,true, false,i,j,pg_setup,flags); }
-	  event++;
-	}
-      }
-    }
-  }
+  size_t & event = daq_event.at(0);
+  size_t ndac = (dacmax-dacmin)/dacstep + 1;
+  size_t n = ROC_NUMCOLS*ROC_NUMROWS*ndac*nTriggers;
+  emulator.generate(daq_buffer, std::vector<size_t>(1,1), tbmtype, event, n, pg_setup, flags, false,
+		    [&](size_t trg, pxar::emulatorRandom &, uint8_t & col, uint8_t & row) {
+		      size_t step = trg/nTriggers, px = step/ndac;
+		      col = px/ROC_NUMROWS; row = px%ROC_NUMROWS;
+		      return hasDacEdge((step%ndac)*dacstep, dacmin, dacmax, flags);
+		    });
+  event += n;
   
   return 1;
 }
@@ -787,19 +754,14 @@ bool CTestboard::LoopSingleRocOnePixelDacScan(uint8_t roci2c, uint8_t column, ui
 bool CTestboard::LoopSingleRocOnePixelDacScan(uint8_t, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dacstep, uint8_t dacmin, uint8_t dacmax) {
   LOG(pxar::logDEBUGRPC) << "called.";
   
-  uint8_t dachalf = static_cast<uint8_t>(dacmax-dacmin)/2;
-  uint32_t event = 0;
-
-  for(size_t dac = 0; dac < static_cast<size_t>(dacmax-dacmin+1); dac += dacstep) {
-    for(size_t k = 0; k < nTriggers; k++) {
-      // Mimic some edge at 50% of the DAC range:
-      if(((flags&FLAG_RISING_EDGE) && dac > dachalf) || (!(flags&FLAG_RISING_EDGE) && dac < dachalf)) {
-	fillRawData(event,daq_buffer.at(0),tbmtype,1,false,false,column,row,pg_setup,flags);
-      }
-      else { fillRawData(event,daq_buffer.at(0),tbmtype,1,true, false,column,row,pg_setup,flags); }
-    }
-    event++;
-  }
+  size_t & event = daq_event.at(0);
+  size_t n = ((dacmax-dacmin)/dacstep + 1)*nTriggers;
+  emulator.generate(daq_buffer, std::vector<size_t>(1,1), tbmtype, event, n, pg_setup, flags, false,
+		    [&](size_t trg, pxar::emulatorRandom &, uint8_t & col, uint8_t & r) {
+		      col = column; r = row;
+		      return hasDacEdge((trg/nTriggers)*dacstep, dacmin, dacmax, flags);
+		    });
+  event += n;
   
   return 1;
 }
@@ -811,31 +773,17 @@ bool CTestboard::LoopMultiRocAllPixelsDacDacScan(std::vector<uint8_t> &roci2cs,
 bool CTestboard::LoopMultiRocAllPixelsDacDacScan(std::vector<uint8_t> &roci2cs, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
-  // Check how many open DAQ channels we have:
-  size_t channels = std::count(daq_status.begin(), daq_status.end(), true);
-  // Distribute the ROCs evenly:
-  size_t roc_per_ch = roci2cs.size()/channels;
-
-  uint32_t event = 0;
-
-  for(size_t i = 0; i < ROC_NUMCOLS; i++) {
-    for(size_t j = 0; j < ROC_NUMROWS; j++) {
-      for(size_t dac1 = 0; dac1 < static_cast<size_t>(dac1max-dac1min+1); dac1 += dac1step) {
-	for(size_t dac2 = 0; dac2 < static_cast<size_t>(dac2max-dac2min+1); dac2 += dac2step) {
-	  for(size_t k = 0; k < nTriggers; k++) {
-	    for(size_t ch = 0; ch < channels; ch++) {
-	      // Mimic some working band of the two DACs:
-	      if(isInTornadoRegion(dac1min, dac1max, dac1, dac2min, dac2max, dac2)) {
-		fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,false,false,i,j,pg_setup,flags);
-	      }
-	      else { fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,true, false,i,j,pg_setup,flags); }
-	    }
-	    event++;
-	  }
-	}
-      }
-    }
-  }
+  size_t & event = daq_event.at(0);
+  size_t ndac1 = (dac1max-dac1min)/dac1step + 1, ndac2 = (dac2max-dac2min)/dac2step + 1;
+  size_t n = ROC_NUMCOLS*ROC_NUMROWS*ndac1*ndac2*nTriggers;
+  emulator.generate(daq_buffer, rocsPerChannel(roci2cs.size(),false), tbmtype, event, n, pg_setup, flags, false,
+		    [&](size_t trg, pxar::emulatorRandom & rng, uint8_t & col, uint8_t & row) {
+		      size_t step = trg/nTriggers, px = step/(ndac1*ndac2);
+		      col = px/ROC_NUMROWS; row = px%ROC_NUMROWS;
+		      // Mimic some working band of the two DACs:
+		      return isInTornadoRegion(dac1min, dac1max, ((step/ndac2)%ndac1)*dac1step, dac2min, dac2max, (step%ndac2)*dac2step, rng);
+		    });
+  event += n;
   
   return 1;
 }
@@ -847,27 +795,17 @@ bool CTestboard::LoopMultiRocOnePixelDacDacScan(std::vector<uint8_t> &roci2cs, u
 bool CTestboard::LoopMultiRocOnePixelDacDacScan(std::vector<uint8_t> &roci2cs, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
-  // Check how many open DAQ channels we have:
-  size_t channels = std::count(daq_status.begin(), daq_status.end(), true);
-  // Distribute the ROCs evenly:
-  size_t roc_per_ch = roci2cs.size()/channels;
-
-  uint32_t event = 0;
-
-  for(size_t dac1 = 0; dac1 < static_cast<size_t>(dac1max-dac1min+1); dac1 += dac1step) {
-    for(size_t dac2 = 0; dac2 < static_cast<size_t>(dac2max-dac2min+1); dac2 += dac2step) {
-      for(size_t k = 0; k < nTriggers; k++) {
-	for(size_t ch = 0; ch < channels; ch++) {
-	  // Mimic some working band of the two DACs:
-	  if(isInTornadoRegion(dac1min, dac1max, dac1, dac2min, dac2max, dac2)) {
-	    fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,false,false,column,row,pg_setup,flags);
-	  }
-	  else { fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,true, false,column,row,pg_setup,flags); }
-	}
-	event++;
-      }
-    }
-  }
+  size_t & event = daq_event.at(0);
+  size_t ndac2 = (dac2max-dac2min)/dac2step + 1;
+  size_t n = ((dac1max-dac1min)/dac1step + 1)*ndac2*nTriggers;
+  emulator.generate(daq_buffer, rocsPerChannel(roci2cs.size(),false), tbmtype, event, n, pg_setup, flags, false,
+		    [&](size_t trg, pxar::emulatorRandom & rng, uint8_t & col, uint8_t & r) {
+		      size_t step = trg/nTriggers;
+		      col = column; r = row;
+		      // Mimic some working band of the two DACs:
+		      return isInTornadoRegion(dac1min, dac1max, (step/ndac2)*dac1step, dac2min, dac2max, (step%ndac2)*dac2step, rng);
+		    });
+  event += n;
   
   return 1;
 }
@@ -879,24 +817,17 @@ bool CTestboard::LoopSingleRocAllPixelsDacDacScan(uint8_t roci2c, uint16_t nTrig
 bool CTestboard::LoopSingleRocAllPixelsDacDacScan(uint8_t, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
-  uint32_t event = 0;
-
-  for(size_t i = 0; i < ROC_NUMCOLS; i++) {
-    for(size_t j = 0; j < ROC_NUMROWS; j++) {
-      for(size_t dac1 = 0; dac1 < static_cast<size_t>(dac1max-dac1min+1); dac1 += dac1step) {
-	for(size_t dac2 = 0; dac2 < static_cast<size_t>(dac2max-dac2min+1); dac2 += dac2step) {
-	  for(size_t k = 0; k < nTriggers; k++) {
-	    // Mimic some working band of the two DACs:
-	    if(isInTornadoRegion(dac1min, dac1max, dac1, dac2min, dac2max, dac2)) {
-	      fillRawData(event,daq_buffer.at(0),tbmtype,1,false,false,i,j,pg_setup,flags);
-	    }
-	    else { fillRawData(event,daq_buffer.at(0),tbmtype,1,true, false,i,j,pg_setup,flags); }
-	  }
-	  event++;
-	}
-      }
-    }
-  }
+  size_t & event = daq_event.at(0);
+  size_t ndac1 = (dac1max-dac1min)/dac1step + 1, ndac2 = (dac2max-dac2min)/dac2step + 1;
+  size_t n = ROC_NUMCOLS*ROC_NUMROWS*ndac1*ndac2*nTriggers;
+  emulator.generate(daq_buffer, std::vector<size_t>(1,1), tbmtype, event, n, pg_setup, flags, false,
+		    [&](size_t trg, pxar::emulatorRandom & rng, uint8_t & col, uint8_t & row) {
+		      size_t step = trg/nTriggers, px = step/(ndac1*ndac2);
+		      col = px/ROC_NUMROWS; row = px%ROC_NUMROWS;
+		      // Mimic some working band of the two DACs:
+		      return isInTornadoRegion(dac1min, dac1max, ((step/ndac2)%ndac1)*dac1step, dac2min, dac2max, (step%ndac2)*dac2step, rng);
+		    });
+  event += n;
   
   return 1;
 }
@@ -908,20 +839,17 @@ bool CTestboard::LoopSingleRocOnePixelDacDacScan(uint8_t roci2c, uint8_t column,
 bool CTestboard::LoopSingleRocOnePixelDacDacScan(uint8_t, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
-  uint32_t event = 0;
-
-  for(size_t dac1 = 0; dac1 < static_cast<size_t>(dac1max-dac1min+1); dac1 += dac1step) {
-    for(size_t dac2 = 0; dac2 < static_cast<size_t>(dac2max-dac2min+1); dac2 += dac2step) {
-      for(size_t k = 0; k < nTriggers; k++) {
-	// Mimic some working band of the two DACs:
-	if(isInTornadoRegion(dac1min, dac1max, dac1, dac2min, dac2max, dac2)) {
-	  fillRawData(event,daq_buffer.at(0),tbmtype,1,false,false,column,row,pg_setup,flags);
-	}
-	else { fillRawData(event,daq_buffer.at(0),tbmtype,1,true, false,column,row,pg_setup,flags); }
-      }
-      event++;
-    }
-  }
+  size_t & event = daq_event.at(0);
+  size_t ndac2 = (dac2max-dac2min)/dac2step + 1;
+  size_t n = ((dac1max-dac1min)/dac1step + 1)*ndac2*nTriggers;
+  emulator.generate(daq_buffer, std::vector<size_t>(1,1), tbmtype, event, n, pg_setup, flags, false,
+		    [&](size_t trg, pxar::emulatorRandom & rng, uint8_t & col, uint8_t & r) {
+		      size_t step = trg/nTriggers;
+		      col = column; r = row;
+		      // Mimic some working band of the two DACs:
+		      return isInTornadoRegion(dac1min, dac1max, (step/ndac2)*dac1step, dac2min, dac2max, (step%ndac2)*dac2step, rng);
+		    });
+  event += n;
   
   return 1;
 }
@@ -4,6 +4,7 @@
 
 #include "log.h"
 #include "constants.h"
+#include "generator.h"
 
 class CRpcError {
  public:
@@ -30,18 +31,20 @@ class CTestboard {
   
   std::vector<std::vector<uint16_t> > daq_buffer; // Data buffers
   std::vector<bool> daq_status; // Channel status
-  std::vector<size_t> daq_event; // Event counters
+  std::vector<size_t> daq_event; // Event counters, continued by the test loops
 
   std::vector<uint16_t> pg_setup; // pattern generator
   // hub map of core maps of registers
   std::map<uint8_t,std::map<uint8_t, std::map<uint8_t, uint8_t> > > tbm_registers;
   uint8_t active_tbm;
+  unsigned int batch_level;
+  pxar::emulatorEngine emulator; // Data generation for the DAQ channels
 
  public:
  CTestboard() : vd(0), va(0), id(0), ia(0),
     nrocs_loops(0), roci2c(), tbmtype(TBM_NONE),trigger(TRG_SEL_PG_DIR),
     eventcounter(0),
-    daq_buffer(), daq_status(), daq_event(), tbm_registers(), active_tbm(0)
+    daq_buffer(), daq_status(), daq_event(), tbm_registers(), active_tbm(0), batch_level(0), emulator()
   {
     // Initialize all available DAQ channels:
     for(size_t i = 0; i < DTB_DAQ_CHANNELS; i++) {
@@ -94,6 +97,13 @@ class CTestboard {
   void Flush() { }
   void Clear() { }
 
+  // RPC batching: nothing to collect without a connection, only the nesting is tracked:
+  void BatchStart() { batch_level++; }
+  bool BatchEnd() { if(batch_level == 0 || --batch_level > 0) return false; return true; }
+  void GetBatchStatistics(uint32_t &commands, uint32_t &bytes, uint32_t &coalesced, uint32_t &savedBytes, uint32_t &savedFlushes) {
+    commands = bytes = coalesced = savedBytes = savedFlushes = 0;
+  }
+
 
   // === DTB identification ================================================
 
@@ -289,6 +299,7 @@ class CTestboard {
   int16_t TrimChip(std::vector<int16_t> &trim);
 
   bool notokenpass(uint8_t tbmtype, uint8_t channel);
+  std::vector<size_t> rocsPerChannel(size_t nrocs, bool tokenpass);
   
   // == Trigger Loop functions for Host-side DAQ ROC/Module testing ==============
   // Exported RPC-Calls for the Trimbit storage setup:
@@ -8,9 +8,30 @@
 namespace pxar {
 
   uint16_t dtbSource::FillBuffer() {
+    FetchBlock();
+    return lastSample = buffer[pos++];
+  }
+
+  void dtbSource::ReadBlock(uint16_t *&first, uint16_t *&last) {
+    if(!connected) throw dpNotConnected();
+    if(pos >= buffer.size()) { FetchBlock(); }
+
+    // Hand out the remainder of the current block and mark it as read:
+    first = &buffer[pos];
+    last = &buffer[0] + buffer.size();
+    pos = buffer.size();
+    lastSample = buffer.back();
+  }
+
+  void dtbSource::FetchBlock() {
     pos = 0;
     do {
-      dtbState = tb->Daq_Read(buffer, DTB_SOURCE_BLOCK_SIZE, dtbRemainingSize, channel);
+      if(prefetcher) { prefetcher->Fetch(buffer, dtbState, dtbRemainingSize); }
+      else if(daqlock) {
+	std::lock_guard<std::mutex> guard(*daqlock);
+	dtbState = tb->Daq_Read(buffer, DTB_SOURCE_BLOCK_SIZE, dtbRemainingSize, config.channel);
+      }
+      else { dtbState = tb->Daq_Read(buffer, DTB_SOURCE_BLOCK_SIZE, dtbRemainingSize, config.channel); }
     
       if (buffer.size() == 0) {
 	if (stopAtEmptyData) throw dsBufferEmpty();
@@ -19,17 +40,88 @@ namespace pxar {
     } while (buffer.size() == 0);
 
     LOG(logDEBUGPIPES) << "-------------------------";
-    LOG(logDEBUGPIPES) << "Channel " << static_cast<int>(channel)
-		       << " (" << static_cast<int>(chainlength) << " ROCs, "
-		       << static_cast<int>(chainlengthOffset) << "-" << static_cast<int>(chainlengthOffset+chainlength-1)<< ")"
-		       << (envelopetype == TBM_NONE ? " DESER160 " : (envelopetype == TBM_EMU ? " SOFTTBM " : " DESER400 "));
+    LOG(logDEBUGPIPES) << "Channel " << static_cast<int>(config.channel)
+		       << " (" << static_cast<int>(config.tokenChainLength) << " ROCs, "
+		       << static_cast<int>(config.tokenChainOffset) << "-" << static_cast<int>(config.tokenChainOffset+config.tokenChainLength-1)<< ")"
+		       << (config.envelopeType == TBM_NONE ? " DESER160 " : (config.envelopeType == TBM_EMU ? " SOFTTBM " : " DESER400 "));
     LOG(logDEBUGPIPES) << "Remaining " << static_cast<int>(dtbRemainingSize);
     LOG(logDEBUGPIPES) << "-------------------------";
     LOG(logDEBUGPIPES) << "FULL RAW DATA BLOB:";
     LOG(logDEBUGPIPES) << listVector(buffer,true);
     LOG(logDEBUGPIPES) << "-------------------------";
+  }
 
-    return lastSample = buffer[pos++];
+  void dtbPrefetcher::Fetch(std::vector<uint16_t> & buffer, uint8_t & state, uint32_t & remaining) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Start the reader with the first request:
+    if(!reader.joinable()) { reader = std::thread(&dtbPrefetcher::Run, this); }
+
+    // Nothing read ahead, wake up the reader if it went idle:
+    if(filled.empty()) {
+      active = true;
+      changed.notify_all();
+    }
+    while(filled.empty()) { changed.wait(lock); }
+
+    block & next = filled.front();
+    buffer.swap(next.data);
+    state = next.state;
+    remaining = next.remaining;
+    std::exception_ptr error = next.error;
+    spare.push_back(std::vector<uint16_t>());
+    spare.back().swap(next.data);
+    filled.pop_front();
+    changed.notify_all();
+
+    if(error) { std::rethrow_exception(error); }
+  }
+
+  void dtbPrefetcher::Run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(1) {
+      while(!stop && !(active && filled.size() < nblocks)) { changed.wait(lock); }
+      if(stop) return;
+
+      block next;
+      if(!spare.empty()) {
+	next.data.swap(spare.back());
+	spare.pop_back();
+      }
+
+      // Read from the testboard without blocking the consumer:
+      lock.unlock();
+      try {
+	if(daqlock) {
+	  std::lock_guard<std::mutex> guard(*daqlock);
+	  next.state = tb->Daq_Read(next.data, DTB_SOURCE_BLOCK_SIZE, next.remaining, channel);
+	}
+	else { next.state = tb->Daq_Read(next.data, DTB_SOURCE_BLOCK_SIZE, next.remaining, channel); }
+      }
+      catch(...) {
+	next.data.clear();
+	next.error = std::current_exception();
+      }
+      lock.lock();
+
+      // Go idle when the channel ran empty, until the next block is requested:
+      if(next.data.empty()) { active = false; }
+      filled.push_back(block());
+      filled.back().data.swap(next.data);
+      filled.back().state = next.state;
+      filled.back().remaining = next.remaining;
+      filled.back().error = next.error;
+      changed.notify_all();
+    }
+  }
+
+  dtbPrefetcher::~dtbPrefetcher() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+      changed.notify_all();
+    }
+    if(reader.joinable()) { reader.join(); }
   }
 
 }
@@ -2,31 +2,76 @@
 #define PXAR_DATASOURCE_DTB_H
 
 #include <stdexcept>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <deque>
+#include <exception>
 #include "datapipe.h"
 #include "rpc_calls.h"
 
 namespace pxar {
 
+  // DTB data prefetching
+  // A background reader keeps up to a fixed number of data blocks of one DAQ
+  // channel in flight while the current block is processed. The block buffers
+  // are recycled. The reader goes idle whenever the channel runs empty and only
+  // continues when the next block is requested.
+  class dtbPrefetcher {
+    CTestboard * tb;
+    uint8_t channel;
+    std::mutex * daqlock;
+    size_t nblocks;
+
+    // Blocks read but not handed out yet, and spare buffers for reuse:
+    struct block {
+      std::vector<uint16_t> data;
+      uint8_t state;
+      uint32_t remaining;
+      std::exception_ptr error;
+    block() : data(), state(0), remaining(0), error() {}
+    };
+    std::deque<block> filled;
+    std::vector<std::vector<uint16_t> > spare;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool active;
+    bool stop;
+    std::thread reader;
+    void Run();
+
+  public:
+    dtbPrefetcher(CTestboard * src, uint8_t daqchannel, std::mutex * lock, size_t blocks)
+      : tb(src), channel(daqchannel), daqlock(lock), nblocks(blocks), filled(), spare(), active(false), stop(false) {}
+    ~dtbPrefetcher();
+
+    // Swap the next block read into buffer, the old buffer is recycled:
+    void Fetch(std::vector<uint16_t> & buffer, uint8_t & state, uint32_t & remaining);
+  };
+
   // DTB data source class
   class dtbSource : public dataSource<uint16_t> {
     volatile bool stopAtEmptyData;
 
     // --- DTB control/state
     CTestboard * tb;
-    uint8_t channel;
-    uint16_t flags;
-    uint8_t chainlength;
-    uint8_t chainlengthOffset;
+    // Channel, flags and devices of this DAQ session:
+    pipeConfig config;
     uint32_t dtbRemainingSize;
     uint8_t  dtbState;
     bool connected;
-    uint8_t envelopetype;
-    uint8_t devicetype;
+    // Lock for the testboard, held while reading data (optional):
+    std::mutex * daqlock;
+    // Background reader, only used in prefetching mode:
+    std::shared_ptr<dtbPrefetcher> prefetcher;
 
     // --- data buffer
     uint16_t lastSample;
     unsigned int pos;
     std::vector<uint16_t> buffer;
+    void FetchBlock();
     uint16_t FillBuffer();
 
     // --- virtual data access methods
@@ -34,39 +79,43 @@ namespace pxar {
       if(!connected) throw dpNotConnected();
       return (pos < buffer.size()) ? lastSample = buffer[pos++] : FillBuffer();
     }
+    void ReadBlock(uint16_t *&first, uint16_t *&last);
     uint16_t ReadLast() {
       if(!connected) throw dpNotConnected();
       return lastSample;
     }
     uint8_t ReadChannel() {
       if(!connected) throw dpNotConnected();
-      return channel;
+      return config.channel;
     }
     uint16_t ReadFlags() {
       if(!connected) throw dpNotConnected();
-      return flags;
+      return config.flags;
     }
     uint8_t ReadTokenChainLength() {
       if(!connected) throw dpNotConnected();
-      return chainlength;
+      return config.tokenChainLength;
     }
     uint8_t ReadTokenChainOffset() {
       if(!connected) throw dpNotConnected();
-      return chainlengthOffset;
+      return config.tokenChainOffset;
     }
     uint8_t ReadEnvelopeType() {
       if(!connected) throw dpNotConnected();
-      return envelopetype;
+      return config.envelopeType;
     }
     uint8_t ReadDeviceType() {
       if(!connected) throw dpNotConnected();
-      return devicetype;
+      return config.deviceType;
     }
+    const pipeConfig * ReadConfig() { return &config; }
   public:
-  dtbSource(CTestboard * src, uint8_t daqchannel, uint8_t tokenChainLength, uint8_t offset, uint8_t tbmtype, uint8_t roctype, bool endlessStream, uint16_t daqflags = 0)
-    : stopAtEmptyData(endlessStream), tb(src), channel(daqchannel), flags(daqflags), chainlength(tokenChainLength), chainlengthOffset(offset), connected(true), envelopetype(tbmtype), devicetype(roctype), lastSample(0x4000), pos(0) {}
-  dtbSource() : connected(false) {}
+  dtbSource(CTestboard * src, uint8_t daqchannel, uint8_t tokenChainLength, uint8_t offset, uint8_t tbmtype, uint8_t roctype, bool endlessStream, uint16_t daqflags = 0, std::mutex * lock = NULL, size_t prefetchBlocks = 0)
+    : stopAtEmptyData(endlessStream), tb(src), config(daqchannel, daqflags, tokenChainLength, offset, tbmtype, roctype), connected(true), daqlock(lock),
+    prefetcher(prefetchBlocks > 0 ? std::make_shared<dtbPrefetcher>(src, daqchannel, lock, prefetchBlocks) : std::shared_ptr<dtbPrefetcher>()), lastSample(0x4000), pos(0) {}
+  dtbSource() : connected(false), daqlock(NULL) {}
     bool isConnected() { return connected; }
+    const pipeConfig & GetConfig() const { return config; }
 
     // --- control and status
     uint8_t  GetState() { return dtbState; }
@@ -74,5 +123,42 @@ namespace pxar {
     void Stop() { stopAtEmptyData = true; }
   };
 
+  // Source replaying a copy of the data read from a DTB channel, used to decode the
+  // data of one test loop segment while the DTB runs the next one:
+  class dtbCaptureSource : public dataSource<uint16_t> {
+    pipeConfig config;
+    std::vector<uint16_t> buffer;
+    size_t pos;
+    uint16_t lastSample;
+
+    uint16_t Read() {
+      if(pos >= buffer.size()) throw dsBufferEmpty();
+      return lastSample = buffer[pos++];
+    }
+    void ReadBlock(uint16_t *&first, uint16_t *&last) {
+      if(pos >= buffer.size()) throw dsBufferEmpty();
+      first = &buffer[pos];
+      last = &buffer[0] + buffer.size();
+      pos = buffer.size();
+      lastSample = buffer.back();
+    }
+    uint16_t ReadLast() { return lastSample; }
+    uint8_t ReadChannel() { return config.channel; }
+    uint16_t ReadFlags() { return config.flags; }
+    uint8_t ReadTokenChainLength() { return config.tokenChainLength; }
+    uint8_t ReadTokenChainOffset() { return config.tokenChainOffset; }
+    uint8_t ReadEnvelopeType() { return config.envelopeType; }
+    uint8_t ReadDeviceType() { return config.deviceType; }
+    const pipeConfig * ReadConfig() { return &config; }
+  public:
+  dtbCaptureSource() : config(), buffer(), pos(0), lastSample(0x4000) {}
+    // Take over the data and the configuration of the channel it was read from:
+    void Fill(const pipeConfig & channel, std::vector<uint16_t> & data) {
+      config = channel;
+      buffer.swap(data);
+      pos = 0;
+    }
+  };
+
 }
 #endif // PXAR_DATASOURCE_DTB_H
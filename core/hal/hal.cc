@@ -6,9 +6,34 @@
 #include "constants.h"
 #include <fstream>
 #include <algorithm>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+#include <exception>
+#include <iterator>
 
 using namespace pxar;
 
+namespace pxar {
+  // Decoded events of one DAQ channel, filled by its worker in daqProcessEventsParallel:
+  struct daqChannelQueue {
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<Event> events;
+    // The worker waits for the caller to take over events if too many are queued,
+    // so the memory stays bounded. Cancelled when the caller stops reading:
+    std::condition_variable space;
+    bool cancelled;
+    // Set when the worker is done, either the channel is drained or an error occured:
+    bool finished;
+    // Data pipe errors are reported with their message, anything else is rethrown:
+    bool pipeError;
+    std::string message;
+    std::exception_ptr error;
+  daqChannelQueue() : events(), cancelled(false), finished(false), pipeError(false), message(), error() {}
+  };
+}
+
 
 
 hal::hal(std::string name) :
@@ -26,8 +51,25 @@ hal::hal(std::string name) :
   _currentTrgSrc(TRG_SEL_PG_DIR),
   m_src(),
   m_splitter(),
-  m_decoder()
+  m_decoder(),
+  m_daqcaptured(false),
+  m_daqbuffersize(DTB_SOURCE_BUFFER_SIZE),
+  m_condensetable(MOD_NUMROCS*ROC_NUMCOLS*ROC_NUMROWS),
+  m_condensepass(0),
+  m_condenseout(NULL),
+  m_condensetriggers(1),
+  m_condenseefficiency(true),
+  m_condensegroup(0),
+  m_rocshadow(),
+  m_tbmshadow(),
+  m_shadowhub(0xff, 0xff),
+  m_rocpixels(),
+  m_niostrims(),
+  m_niosi2c(),
+  m_shadowhits(0),
+  m_shadowmisses(0)
 {
+  for(size_t ch = 0; ch < DTB_DAQ_CHANNELS; ch++) { m_daqfillmax[ch] = 0; }
 
   // Get a new CTestboard class instance:
   _testboard = new CTestboard();
@@ -85,6 +127,9 @@ hal::hal(std::string name) :
 
 hal::~hal() {
   // Shut down and close the testboard connection on destruction of HAL object:
+
+  // Disconnect the data pipes, this stops any background readers:
+  for(size_t ch = 0; ch < m_src.size(); ch++) { m_src.at(ch) = dtbSource(); }
   
   // Turn High Voltage off:
   _testboard->HVoff();
@@ -549,15 +594,20 @@ void hal::setTBvd(double VD) {
 void hal::setHubId(uint8_t hubid) {
   LOG(logDEBUGHAL) << "Setting Hub ID: " << static_cast<int>(hubid);
   _testboard->mod_Addr(hubid);
+  shadowHub(hubid, hubid);
 }
 
 void hal::setHubId(uint8_t hub0, uint8_t hub1) {
   LOG(logDEBUGHAL) << "Setting both Layer 1 Hub IDs: " << static_cast<int>(hub0) << ", " << static_cast<int>(hub1);
   _testboard->mod_Addr(hub0, hub1);
+  shadowHub(hub0, hub1);
 }
 
 bool hal::rocSetDACs(uint8_t roci2c, std::map< uint8_t, uint8_t > dacPairs) {
 
+  // Send all register settings in one batch:
+  rpcBatch batch(this);
+
   // Make sure we are writing to the correct ROC by setting the I2C address:
   _testboard->roc_I2cAddr(roci2c);
 
@@ -570,6 +620,7 @@ bool hal::rocSetDACs(uint8_t roci2c, std::map< uint8_t, uint8_t > dacPairs) {
   // Iterate over all DAC id/value pairs and set the DAC
   for(std::map< uint8_t,uint8_t >::iterator it = dacPairs.begin(); it != dacPairs.end(); ++it) {
     if(it->first == ROC_DAC_RangeTemp) { rangetemp = it; continue; }
+    if(!shadowRocDAC(roci2c,it->first,it->second)) { continue; }
 
     LOG(logDEBUGHAL) << "Set DAC" << static_cast<int>(it->first) << " to " << static_cast<int>(it->second);
     _testboard->roc_SetDAC(it->first,it->second);
@@ -590,12 +641,23 @@ bool hal::rocSetDACs(uint8_t roci2c, std::map< uint8_t, uint8_t > dacPairs) {
 
   // Send all queued commands to the testboard:
   _testboard->Flush();
+  batch.end();
+  for(std::map< uint8_t,uint8_t >::iterator it = dacPairs.begin(); it != dacPairs.end(); ++it) {
+    shadowRocDACWritten(roci2c,it->first,it->second);
+  }
   // Everything went all right:
   return true;
 }
 
 bool hal::rocSetDAC(uint8_t roci2c, uint8_t dacId, uint8_t dacValue) {
 
+  // Skip the write if the DAC holds this value already:
+  if(!shadowRocDAC(roci2c,dacId,dacValue)) {
+    LOG(logDEBUGHAL) << "ROC@I2C " << static_cast<size_t>(roci2c)
+		     << ": DAC" << static_cast<int>(dacId) << " is set to " << static_cast<int>(dacValue) << " already.";
+    return true;
+  }
+
   // Make sure we are writing to the correct ROC by setting the I2C address:
   _testboard->roc_I2cAddr(roci2c);
 
@@ -603,6 +665,7 @@ bool hal::rocSetDAC(uint8_t roci2c, uint8_t dacId, uint8_t dacValue) {
 		   << ": Set DAC" << static_cast<int>(dacId) << " to " << static_cast<int>(dacValue);
   _testboard->roc_SetDAC(dacId,dacValue);
   _testboard->Flush();
+  shadowRocDACWritten(roci2c,dacId,dacValue);
 
   // Make sure to issue a ROC Reset after the DAc WBC has been programmed:
   if(dacId == ROC_DAC_WBC) {
@@ -614,6 +677,9 @@ bool hal::rocSetDAC(uint8_t roci2c, uint8_t dacId, uint8_t dacValue) {
 
 bool hal::tbmSetRegs(uint8_t hubid, uint8_t core, std::map< uint8_t, uint8_t > regPairs) {
 
+  // Send all register settings in one batch:
+  rpcBatch batch(this);
+
   // Iterate over all register id/value pairs and set them
   for(std::map< uint8_t,uint8_t >::iterator it = regPairs.begin(); it != regPairs.end(); ++it) {
     // One of the register settings had an issue, abort:
@@ -622,39 +688,152 @@ bool hal::tbmSetRegs(uint8_t hubid, uint8_t core, std::map< uint8_t, uint8_t > r
 
   // Send all queued commands to the testboard:
   _testboard->Flush();
+  batch.end();
   // Everything went all right:
   return true;
 }
 
 bool hal::tbmSetReg(uint8_t hubid, uint8_t regId, uint8_t regValue, bool flush) {
 
+  // Skip the write if the register holds this value already:
+  if(!shadowTbmReg(hubid,regId,regValue)) {
+    LOG(logDEBUGHAL) << "TBM@HUB " << static_cast<int>(hubid)
+		     << ": register \"0x" << std::hex << static_cast<int>(regId)
+		     << "\" is set to 0x" << static_cast<int>(regValue) << std::dec << " already.";
+    return true;
+  }
+
   LOG(logDEBUGHAL) << "TBM@HUB " << static_cast<int>(hubid)
 		   << ": set register \"0x" << std::hex << static_cast<int>(regId) 
 		   << "\" to 0x" << static_cast<int>(regValue) << std::dec;
 
   // Make sure we are writing to the correct TBM by setting the module's hub id:
   _testboard->mod_Addr(hubid);
+  shadowHub(hubid, hubid);
 
   // Set this register:
   _testboard->tbm_Set(regId,regValue);
 
   // If requested, flush immediately:
   if(flush) _testboard->Flush();
+  shadowTbmRegWritten(hubid,regId,regValue);
   return true;
 }
 
+void hal::rpcBatchStart() {
+  _testboard->BatchStart();
+}
+
+void hal::rpcBatchEnd() {
+
+  // The registers written in the batch are in an unknown state if it could not be sent:
+  try { if(!_testboard->BatchEnd()) return; }
+  catch(...) { shadowInvalidate(); throw; }
+
+  uint32_t commands, bytes, coalesced, savedBytes, savedFlushes;
+  _testboard->GetBatchStatistics(commands, bytes, coalesced, savedBytes, savedFlushes);
+  if(commands == 0) return;
+  LOG(logDEBUGHAL) << "RPC batch sent: " << commands << " calls, " << bytes << " bytes, "
+		   << coalesced << " address selects dropped (" << savedBytes << " bytes), "
+		   << savedFlushes << " flushes saved.";
+}
+
+bool hal::shadowRocDAC(uint8_t roci2c, uint8_t dacId, uint8_t dacValue) {
+
+  // Writing these registers triggers a readback, always send them:
+  if(dacId == ROC_DAC_RangeTemp || dacId == ROC_DAC_Readback) { return true; }
+
+  uint16_t key = (static_cast<uint16_t>(roci2c) << 8) | dacId;
+  std::map<uint16_t, uint8_t>::iterator reg = m_rocshadow.find(key);
+  if(reg != m_rocshadow.end() && reg->second == dacValue) { m_shadowhits++; return false; }
+
+  m_shadowmisses++;
+  return true;
+}
+
+void hal::shadowRocDACWritten(uint8_t roci2c, uint8_t dacId, uint8_t dacValue) {
+  if(dacId == ROC_DAC_RangeTemp || dacId == ROC_DAC_Readback) return;
+  m_rocshadow[(static_cast<uint16_t>(roci2c) << 8) | dacId] = dacValue;
+}
+
+bool hal::shadowTbmReg(uint8_t hubid, uint8_t regId, uint8_t regValue) {
+
+  // The clear/inject register issues commands, always send it:
+  if((regId & 0x0F) == TBM_REG_CLEAR_INJECT) { return true; }
+
+  uint16_t key = (static_cast<uint16_t>(hubid) << 8) | regId;
+  std::map<uint16_t, uint8_t>::iterator reg = m_tbmshadow.find(key);
+  if(reg != m_tbmshadow.end() && reg->second == regValue) { m_shadowhits++; return false; }
+
+  m_shadowmisses++;
+  return true;
+}
+
+void hal::shadowTbmRegWritten(uint8_t hubid, uint8_t regId, uint8_t regValue) {
+  if((regId & 0x0F) == TBM_REG_CLEAR_INJECT) return;
+  m_tbmshadow[(static_cast<uint16_t>(hubid) << 8) | regId] = regValue;
+}
+
+void hal::shadowHub(uint8_t hub0, uint8_t hub1) {
+  // The ROC registers are only known for the ROCs behind the hub they were written to:
+  if(m_shadowhub == std::make_pair(hub0, hub1)) return;
+  m_shadowhub = std::make_pair(hub0, hub1);
+  m_rocshadow.clear();
+  m_rocpixels.clear();
+}
+
+void hal::shadowForgetDAC(uint8_t dacId) {
+  for(std::map<uint16_t, uint8_t>::iterator reg = m_rocshadow.begin(); reg != m_rocshadow.end();) {
+    if((reg->first & 0xff) == dacId) { m_rocshadow.erase(reg++); }
+    else { ++reg; }
+  }
+}
+
+void hal::shadowInvalidate() {
+  if(!m_rocshadow.empty() || !m_tbmshadow.empty()) {
+    LOG(logDEBUGHAL) << "Clearing shadow registers, " << m_shadowhits << " writes skipped, "
+		     << m_shadowmisses << " writes sent so far.";
+  }
+  m_rocshadow.clear();
+  m_tbmshadow.clear();
+  m_rocpixels.clear();
+}
+
+rpcBatch::rpcBatch(hal * h) : m_hal(h), m_ended(false) { m_hal->rpcBatchStart(); }
+
+rpcBatch::~rpcBatch() {
+  if(m_ended) return;
+  // Already leaving with an error, don't throw from the destructor:
+  try { m_hal->rpcBatchEnd(); }
+  catch(...) { LOG(logCRITICAL) << "Failed to send the RPC batch to the testboard."; }
+}
+
+void rpcBatch::end() {
+  m_ended = true;
+  m_hal->rpcBatchEnd();
+}
+
 void hal::tbmSelectRDA(uint8_t rda_id) {
   _testboard->tbm_SelectRDA(rda_id);
 }
 
 void hal::SetupI2CValues(std::vector<uint8_t> roci2cs) {
 
+  // The NIOS storage holds these addresses already:
+  if(roci2cs == m_niosi2c) {
+    LOG(logDEBUGHAL) << "I2C devices in NIOS storage unchanged.";
+    return;
+  }
+
   LOG(logDEBUGHAL) << "Writing the following available I2C devices into NIOS storage:";
   LOG(logDEBUGHAL) << listVector(roci2cs);
 
   // Write all ROC I2C addresses to the NIOS storage:
   _testboard->SetI2CAddresses(roci2cs);
 
+  // The trim values have to be transmitted again for the new set of devices:
+  m_niosi2c = roci2cs;
+  m_niostrims.clear();
 }
 
 void hal::SetupTrimValues(uint8_t roci2c, std::vector<pixelConfig> pixels) {
@@ -673,10 +852,20 @@ void hal::SetupTrimValues(uint8_t roci2c, std::vector<pixelConfig> pixels) {
     else trim[position] = pxIt->trim();
   }
 
+  // Skip the upload if the NIOS storage holds this configuration already:
+  std::vector<uint8_t> & image = m_niostrims[roci2c];
+  if(image == trim) {
+    LOG(logDEBUGHAL) << "NIOS trimming & masking configuration for ROC with I2C address "
+		     << static_cast<int>(roci2c) << " unchanged.";
+    return;
+  }
+
   LOG(logDEBUGHAL) << "Updating NIOS trimming & masking configuration for ROC with I2C address " 
 		   << static_cast<int>(roci2c) << ".";
 
+  image.clear();
   _testboard->SetTrimValues(roci2c,trim);
+  image.swap(trim);
 }
 
 void hal::RocSetMask(uint8_t roci2c, bool mask, std::vector<pixelConfig> pixels) {
@@ -689,7 +878,9 @@ void hal::RocSetMask(uint8_t roci2c, bool mask, std::vector<pixelConfig> pixels)
     LOG(logDEBUGHAL) << "Masking full ROC@I2C " << static_cast<int>(roci2c);
 
     // Mask the PUC and detach all DC from their readout (both done on NIOS):
+    m_rocpixels.erase(roci2c);
     _testboard->roc_Chip_Mask();
+    m_rocpixels[roci2c].assign(ROC_NUMCOLS*ROC_NUMROWS, -1);
   }
   else {
     // Prepare configuration of the pixels, linearize vector:
@@ -705,11 +896,45 @@ void hal::RocSetMask(uint8_t roci2c, bool mask, std::vector<pixelConfig> pixels)
       else trim[position] = pxIt->trim();
     }
 
+    // Compare to the pixel configuration last programmed, if known. The image is
+    // dropped while programming, an interrupted upload leaves the pixels unknown:
+    std::map<uint8_t, std::vector<int16_t> >::iterator image = m_rocpixels.find(roci2c);
+    if(image != m_rocpixels.end()) {
+      std::vector<size_t> changed;
+      for(size_t i = 0; i < trim.size() && changed.size() <= ROC_TRIM_SPARSE_LIMIT; i++) {
+	if(trim[i] != image->second[i]) changed.push_back(i);
+      }
+
+      if(changed.empty()) {
+	LOG(logDEBUGHAL) << "Mask bits & trim values of ROC@I2C " << static_cast<int>(roci2c) << " unchanged.";
+	return;
+      }
+      m_rocpixels.erase(image);
+
+      // Only a few pixels differ, program them one by one:
+      if(changed.size() <= ROC_TRIM_SPARSE_LIMIT) {
+	LOG(logDEBUGHAL) << "Updating mask bits & trim values of " << changed.size()
+			 << " pixels of ROC@I2C " << static_cast<int>(roci2c);
+	rpcBatch batch(this);
+	for(std::vector<size_t>::iterator px = changed.begin(); px != changed.end(); ++px) {
+	  uint8_t column = static_cast<uint8_t>(*px/ROC_NUMROWS);
+	  uint8_t row = static_cast<uint8_t>(*px%ROC_NUMROWS);
+	  if(trim[*px] < 0) _testboard->roc_Pix_Mask(column,row);
+	  else _testboard->roc_Pix_Trim(column,row,static_cast<uint8_t>(trim[*px]));
+	}
+	batch.end();
+	m_rocpixels[roci2c].swap(trim);
+	return;
+      }
+    }
+
     // We really want to program that full thing with correct mask/trim bits:
     LOG(logDEBUGHAL) << "Updating mask bits & trim values of ROC@I2C " << static_cast<int>(roci2c);
 
     // Trim the whole ROC:
+    m_rocpixels.erase(roci2c);
     _testboard->TrimChip(trim);
+    m_rocpixels[roci2c].swap(trim);
   }
 }
 
@@ -740,6 +965,9 @@ void hal::PixelSetCalibrate(uint8_t roci2c, uint8_t column, uint8_t row, uint16_
 
 void hal::RocSetCalibrate(uint8_t roci2c, std::vector<pixelConfig> pixels, uint16_t flags) {
 
+  // Send the pixel settings in one batch:
+  rpcBatch batch(this);
+
   // Set the correct ROC I2C address:
   _testboard->roc_I2cAddr(roci2c);
 
@@ -750,6 +978,7 @@ void hal::RocSetCalibrate(uint8_t roci2c, std::vector<pixelConfig> pixels, uint1
   for(std::vector<pixelConfig>::iterator pxIt = pixels.begin(); pxIt != pixels.end(); ++pxIt) {
     _testboard->roc_Pix_Cal(pxIt->column(),pxIt->row(),useSensorPadForCalibration);
   }
+  batch.end();
 }
 
 void hal::RocClearCalibrate(uint8_t roci2c) {
@@ -761,19 +990,19 @@ void hal::RocClearCalibrate(uint8_t roci2c) {
  _testboard->roc_ClrCal();
 }
 
-void hal::estimateDataVolume(uint32_t events, uint8_t nROCs) {
+uint64_t hal::estimateDataVolume(uint32_t events, uint8_t nROCs) {
 
-  uint32_t nSamples = 0;
+  uint64_t nSamples = 0;
   // DESER400: header 3 words, pixel 6 words
-  if(m_tbmtype != TBM_NONE && m_tbmtype != TBM_EMU) { nSamples = events*nROCs*(3+6); }
+  if(m_tbmtype != TBM_NONE && m_tbmtype != TBM_EMU) { nSamples = static_cast<uint64_t>(events)*nROCs*(3+6); }
   // DESER160: header 1 word, pixel 2 words
-  else { nSamples = events*nROCs*(1+2); }
+  else { nSamples = static_cast<uint64_t>(events)*nROCs*(1+2); }
 
   LOG(logINFO) << "Expecting " << events << " events.";
   LOG(logDEBUGHAL) << "Estimated data volume: "
 		   << (nSamples/1000) << "k/" << (DTB_SOURCE_BUFFER_SIZE/1000) 
 		   << "k (~" << (100*static_cast<double>(nSamples)/DTB_SOURCE_BUFFER_SIZE) << "% allocated DTB RAM)";
-
+  return nSamples;
 }
 
 // ---------------- TEST FUNCTIONS ----------------------
@@ -796,13 +1025,8 @@ std::vector<Event> hal::MultiRocAllPixelsCalibrate(std::vector<uint8_t> roci2cs,
   timer t;
 
   // Call the RPC command containing the trigger loop:
-  bool done = false;
   std::vector<Event> data = std::vector<Event>();
-  while(!done) {
-    done = _testboard->LoopMultiRocAllPixelsCalibrate(roci2cs, nTriggers, flags);
-    LOG(logDEBUGHAL) << "Loop " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << daqBufferStatus() << " words...";
-    addCondensedData(data,nTriggers,efficiency,t);
-  }
+  runTestLoop([&]() { return _testboard->LoopMultiRocAllPixelsCalibrate(roci2cs, nTriggers, flags); }, data, nTriggers, efficiency, flags, t);
   LOG(logDEBUGHAL) << "Loop done after " << t << "ms. Readout size: " << data.size() << " events.";
 
   // Clear & reset the DAQ buffer on the testboard.
@@ -838,13 +1062,8 @@ std::vector<Event> hal::MultiRocOnePixelCalibrate(std::vector<uint8_t> roci2cs,
   timer t;
 
   // Call the RPC command containing the trigger loop:
-  bool done = false;
   std::vector<Event> data = std::vector<Event>();
-  while(!done) {
-    done = _testboard->LoopMultiRocOnePixelCalibrate(roci2cs, column, row, nTriggers, flags);
-    LOG(logDEBUGHAL) << "Loop " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << daqBufferStatus() << " words...";
-    addCondensedData(data,nTriggers,efficiency,t);
-  }
+  runTestLoop([&]() { return _testboard->LoopMultiRocOnePixelCalibrate(roci2cs, column, row, nTriggers, flags); }, data, nTriggers, efficiency, flags, t);
   LOG(logDEBUGHAL) << "Loop done after " << t << "ms. Readout size: " << data.size() << " events.";
 
   // Clear & reset the DAQ buffer on the testboard.
@@ -879,13 +1098,8 @@ std::vector<Event> hal::SingleRocAllPixelsCalibrate(uint8_t roci2c, bool efficie
   timer t;
 
   // Call the RPC command containing the trigger loop:
-  bool done = false;
   std::vector<Event> data = std::vector<Event>();
-  while(!done) {
-    done = _testboard->LoopSingleRocAllPixelsCalibrate(roci2c, nTriggers, flags);
-    LOG(logDEBUGHAL) << "Loop " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << daqBufferStatus() << " words...";
-    addCondensedData(data,nTriggers,efficiency,t);
-  }
+  runTestLoop([&]() { return _testboard->LoopSingleRocAllPixelsCalibrate(roci2c, nTriggers, flags); }, data, nTriggers, efficiency, flags, t);
   LOG(logDEBUGHAL) << "Loop done after " << t << "ms. Readout size: " << data.size() << " events.";
 
   // Clear & reset the DAQ buffer on the testboard.
@@ -919,13 +1133,8 @@ std::vector<Event> hal::SingleRocOnePixelCalibrate(uint8_t roci2c, uint8_t colum
   timer t;
 
   // Call the RPC command containing the trigger loop:
-  bool done = false;
   std::vector<Event> data = std::vector<Event>();
-  while(!done) {
-    done = _testboard->LoopSingleRocOnePixelCalibrate(roci2c, column, row, nTriggers, flags);
-    LOG(logDEBUGHAL) << "Loop " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << daqBufferStatus() << " words...";
-    addCondensedData(data,nTriggers,efficiency,t);
-  }
+  runTestLoop([&]() { return _testboard->LoopSingleRocOnePixelCalibrate(roci2c, column, row, nTriggers, flags); }, data, nTriggers, efficiency, flags, t);
   LOG(logDEBUGHAL) << "Loop done after " << t << "ms. Readout size: " << data.size() << " events.";
 
   // Clear & reset the DAQ buffer on the testboard.
@@ -964,20 +1173,17 @@ std::vector<Event> hal::MultiRocAllPixelsDacScan(std::vector<uint8_t> roci2cs, b
 		   << " from " << static_cast<int>(dacmin) 
 		   << " to " << static_cast<int>(dacmax)
 		   << " (step size " << static_cast<int>(dacstep) << ")";
-  estimateDataVolume(expected, roci2cs.size());
+  uint64_t samples = estimateDataVolume(expected, roci2cs.size());
 
  // Prepare for data acquisition:
   daqStart(flags,deser160phase);
   timer t;
 
   // Call the RPC command containing the trigger loop:
-  bool done = false;
   std::vector<Event> data = std::vector<Event>();
-  while(!done) {
-    done = _testboard->LoopMultiRocAllPixelsDacScan(roci2cs, nTriggers, flags, dacreg, dacstep, dacmin, dacmax);
-    LOG(logDEBUGHAL) << "Loop " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << daqBufferStatus() << " words...";
-    addCondensedData(data,nTriggers,efficiency,t);
-  }
+  // The test loop leaves the scanned DACs at the last value:
+  shadowForgetDAC(dacreg);
+  runDacScanLoop([&](uint8_t first, uint8_t last) { return _testboard->LoopMultiRocAllPixelsDacScan(roci2cs, nTriggers, flags, dacreg, dacstep, first, last); }, dacmin, dacmax, dacstep, ROC_NUMCOLS*ROC_NUMROWS, 1, samples, data, nTriggers, efficiency, flags, t);
   LOG(logDEBUGHAL) << "Loop done after " << t << "ms. Readout size: " << data.size() << " events.";
 
   // Clear & reset the DAQ buffer on the testboard.
@@ -1017,20 +1223,17 @@ std::vector<Event> hal::MultiRocOnePixelDacScan(std::vector<uint8_t> roci2cs, ui
 		   << " from " << static_cast<int>(dacmin) 
 		   << " to " << static_cast<int>(dacmax)
 		   << " (step size " << static_cast<int>(dacstep) << ")";
-  estimateDataVolume(expected, roci2cs.size());
+  uint64_t samples = estimateDataVolume(expected, roci2cs.size());
 
  // Prepare for data acquisition:
   daqStart(flags,deser160phase);
   timer t;
 
   // Call the RPC command containing the trigger loop:
-  bool done = false;
   std::vector<Event> data = std::vector<Event>();
-  while(!done) {
-    done = _testboard->LoopMultiRocOnePixelDacScan(roci2cs, column, row, nTriggers, flags, dacreg, dacstep, dacmin, dacmax);
-    LOG(logDEBUGHAL) << "Loop " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << daqBufferStatus() << " words...";
-    addCondensedData(data,nTriggers,efficiency,t);
-  }
+  // The test loop leaves the scanned DACs at the last value:
+  shadowForgetDAC(dacreg);
+  runDacScanLoop([&](uint8_t first, uint8_t last) { return _testboard->LoopMultiRocOnePixelDacScan(roci2cs, column, row, nTriggers, flags, dacreg, dacstep, first, last); }, dacmin, dacmax, dacstep, 1, 1, samples, data, nTriggers, efficiency, flags, t);
   LOG(logDEBUGHAL) << "Loop done after " << t << "ms. Readout size: " << data.size() << " events.";
 
   // Clear & reset the DAQ buffer on the testboard.
@@ -1066,20 +1269,17 @@ std::vector<Event> hal::SingleRocAllPixelsDacScan(uint8_t roci2c, bool efficienc
 		   << " from " << static_cast<int>(dacmin) 
 		   << " to " << static_cast<int>(dacmax)
 		   << " (step size " << static_cast<int>(dacstep) << ")";
-  estimateDataVolume(expected, 1);
+  uint64_t samples = estimateDataVolume(expected, 1);
 
  // Prepare for data acquisition:
   daqStart(flags,deser160phase);
   timer t;
 
   // Call the RPC command containing the trigger loop:
-  bool done = false;
   std::vector<Event> data = std::vector<Event>();
-  while(!done) {
-    done = _testboard->LoopSingleRocAllPixelsDacScan(roci2c, nTriggers, flags, dacreg, dacstep, dacmin, dacmax);
-    LOG(logDEBUGHAL) << "Loop " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << daqBufferStatus() << " words...";
-    addCondensedData(data,nTriggers,efficiency,t);
-  }
+  // The test loop leaves the scanned DACs at the last value:
+  shadowForgetDAC(dacreg);
+  runDacScanLoop([&](uint8_t first, uint8_t last) { return _testboard->LoopSingleRocAllPixelsDacScan(roci2c, nTriggers, flags, dacreg, dacstep, first, last); }, dacmin, dacmax, dacstep, ROC_NUMCOLS*ROC_NUMROWS, 1, samples, data, nTriggers, efficiency, flags, t);
   LOG(logDEBUGHAL) << "Loop done after " << t << "ms. Readout size: " << data.size() << " events.";
 
   // Clear & reset the DAQ buffer on the testboard.
@@ -1115,20 +1315,17 @@ std::vector<Event> hal::SingleRocOnePixelDacScan(uint8_t roci2c, uint8_t column,
 		   << " from " << static_cast<int>(dacmin) 
 		   << " to " << static_cast<int>(dacmax)
 		   << " (step size " << static_cast<int>(dacstep) << ")";
-  estimateDataVolume(expected, 1);
+  uint64_t samples = estimateDataVolume(expected, 1);
 
   // Prepare for data acquisition:
   daqStart(flags,deser160phase);
   timer t;
 
   // Call the RPC command containing the trigger loop:
-  bool done = false;
   std::vector<Event> data = std::vector<Event>();
-  while(!done) {
-    done = _testboard->LoopSingleRocOnePixelDacScan(roci2c, column, row, nTriggers, flags, dacreg, dacstep, dacmin, dacmax);
-    LOG(logDEBUGHAL) << "Loop " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << daqBufferStatus() << " words...";
-    addCondensedData(data,nTriggers,efficiency,t);
-  }
+  // The test loop leaves the scanned DACs at the last value:
+  shadowForgetDAC(dacreg);
+  runDacScanLoop([&](uint8_t first, uint8_t last) { return _testboard->LoopSingleRocOnePixelDacScan(roci2c, column, row, nTriggers, flags, dacreg, dacstep, first, last); }, dacmin, dacmax, dacstep, 1, 1, samples, data, nTriggers, efficiency, flags, t);
   LOG(logDEBUGHAL) << "Loop done after " << t << "ms. Readout size: " << data.size() << " events.";
 
   // Clear & reset the DAQ buffer on the testboard.
@@ -1174,20 +1371,18 @@ std::vector<Event> hal::MultiRocAllPixelsDacDacScan(std::vector<uint8_t> roci2cs
 		   << " from " << static_cast<int>(dac2min) 
 		   << " to " << static_cast<int>(dac2max)
 		   << " (step size " << static_cast<int>(dac2step) << ")";
-  estimateDataVolume(expected, roci2cs.size());
+  uint64_t samples = estimateDataVolume(expected, roci2cs.size());
 
   // Prepare for data acquisition:
   daqStart(flags,deser160phase);
   timer t;
 
   // Call the RPC command containing the trigger loop:
-  bool done = false;
   std::vector<Event> data = std::vector<Event>();
-  while(!done) {
-    done = _testboard->LoopMultiRocAllPixelsDacDacScan(roci2cs, nTriggers, flags, dac1reg, dac1step, dac1min, dac1max, dac2reg, dac2step, dac2min, dac2max);
-    LOG(logDEBUGHAL) << "Loop " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << daqBufferStatus() << " words...";
-    addCondensedData(data,nTriggers,efficiency,t);
-  }
+  // The test loop leaves the scanned DACs at the last value:
+  shadowForgetDAC(dac1reg);
+  shadowForgetDAC(dac2reg);
+  runDacScanLoop([&](uint8_t first, uint8_t last) { return _testboard->LoopMultiRocAllPixelsDacDacScan(roci2cs, nTriggers, flags, dac1reg, dac1step, first, last, dac2reg, dac2step, dac2min, dac2max); }, dac1min, dac1max, dac1step, ROC_NUMCOLS*ROC_NUMROWS, (dac2max-dac2min)/dac2step+1, samples, data, nTriggers, efficiency, flags, t);
   LOG(logDEBUGHAL) << "Loop done after " << t << "ms. Readout size: " << data.size() << " events.";
 
   // Clear & reset the DAQ buffer on the testboard.
@@ -1236,20 +1431,18 @@ std::vector<Event> hal::MultiRocOnePixelDacDacScan(std::vector<uint8_t> roci2cs,
 		   << " from " << static_cast<int>(dac2min) 
 		   << " to " << static_cast<int>(dac2max)
 		   << " (step size " << static_cast<int>(dac2step) << ")";
-  estimateDataVolume(expected, roci2cs.size());
+  uint64_t samples = estimateDataVolume(expected, roci2cs.size());
 
   // Prepare for data acquisition:
   daqStart(flags,deser160phase);
   timer t;
 
   // Call the RPC command containing the trigger loop:
-  bool done = false;
   std::vector<Event> data = std::vector<Event>();
-  while(!done) {
-    done = _testboard->LoopMultiRocOnePixelDacDacScan(roci2cs, column, row, nTriggers, flags, dac1reg, dac1step, dac1min, dac1max, dac2reg, dac2step, dac2min, dac2max);
-    LOG(logDEBUGHAL) << "Loop " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << daqBufferStatus() << " words...";
-    addCondensedData(data,nTriggers,efficiency,t);
-  }
+  // The test loop leaves the scanned DACs at the last value:
+  shadowForgetDAC(dac1reg);
+  shadowForgetDAC(dac2reg);
+  runDacScanLoop([&](uint8_t first, uint8_t last) { return _testboard->LoopMultiRocOnePixelDacDacScan(roci2cs, column, row, nTriggers, flags, dac1reg, dac1step, first, last, dac2reg, dac2step, dac2min, dac2max); }, dac1min, dac1max, dac1step, 1, (dac2max-dac2min)/dac2step+1, samples, data, nTriggers, efficiency, flags, t);
   LOG(logDEBUGHAL) << "Loop done after " << t << "ms. Readout size: " << data.size() << " events.";
 
   // Clear & reset the DAQ buffer on the testboard.
@@ -1294,20 +1487,18 @@ std::vector<Event> hal::SingleRocAllPixelsDacDacScan(uint8_t roci2c, bool effici
 		   << " from " << static_cast<int>(dac2min) 
 		   << " to " << static_cast<int>(dac2max)
 		   << " (step size " << static_cast<int>(dac2step) << ")";
-  estimateDataVolume(expected, 1);
+  uint64_t samples = estimateDataVolume(expected, 1);
 
   // Prepare for data acquisition:
   daqStart(flags,deser160phase);
   timer t;
 
   // Call the RPC command containing the trigger loop:
-  bool done = false;
   std::vector<Event> data = std::vector<Event>();
-  while(!done) {
-    done = _testboard->LoopSingleRocAllPixelsDacDacScan(roci2c, nTriggers, flags, dac1reg, dac1step, dac1min, dac1max, dac2reg, dac2step, dac2min, dac2max);
-    LOG(logDEBUGHAL) << "Loop " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << daqBufferStatus() << " words...";
-    addCondensedData(data,nTriggers,efficiency,t);
-  }
+  // The test loop leaves the scanned DACs at the last value:
+  shadowForgetDAC(dac1reg);
+  shadowForgetDAC(dac2reg);
+  runDacScanLoop([&](uint8_t first, uint8_t last) { return _testboard->LoopSingleRocAllPixelsDacDacScan(roci2c, nTriggers, flags, dac1reg, dac1step, first, last, dac2reg, dac2step, dac2min, dac2max); }, dac1min, dac1max, dac1step, ROC_NUMCOLS*ROC_NUMROWS, (dac2max-dac2min)/dac2step+1, samples, data, nTriggers, efficiency, flags, t);
   LOG(logDEBUGHAL) << "Loop done after " << t << "ms. Readout size: " << data.size() << " events.";
 
   // Clear & reset the DAQ buffer on the testboard.
@@ -1352,20 +1543,18 @@ std::vector<Event> hal::SingleRocOnePixelDacDacScan(uint8_t roci2c, uint8_t colu
 		   << " from " << static_cast<int>(dac2min) 
 		   << " to " << static_cast<int>(dac2max)
 		   << " (step size " << static_cast<int>(dac2step) << ")";
-  estimateDataVolume(expected, 1);
+  uint64_t samples = estimateDataVolume(expected, 1);
 
   // Prepare for data acquisition:
   daqStart(flags,deser160phase);
   timer t;
 
   // Call the RPC command containing the trigger loop:
-  bool done = false;
   std::vector<Event> data = std::vector<Event>();
-  while(!done) {
-    done = _testboard->LoopSingleRocOnePixelDacDacScan(roci2c, column, row, nTriggers, flags, dac1reg, dac1step, dac1min, dac1max, dac2reg, dac2step, dac2min, dac2max);
-    LOG(logDEBUGHAL) << "Loop " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << daqBufferStatus() << " words...";
-    addCondensedData(data,nTriggers,efficiency,t);
-  }
+  // The test loop leaves the scanned DACs at the last value:
+  shadowForgetDAC(dac1reg);
+  shadowForgetDAC(dac2reg);
+  runDacScanLoop([&](uint8_t first, uint8_t last) { return _testboard->LoopSingleRocOnePixelDacDacScan(roci2c, column, row, nTriggers, flags, dac1reg, dac1step, first, last, dac2reg, dac2step, dac2min, dac2max); }, dac1min, dac1max, dac1step, 1, (dac2max-dac2min)/dac2step+1, samples, data, nTriggers, efficiency, flags, t);
   LOG(logDEBUGHAL) << "Loop done after " << t << "ms. Readout size: " << data.size() << " events.";
 
   // Clear & reset the DAQ buffer on the testboard.
@@ -1408,6 +1597,9 @@ void hal::Pon() {
   _testboard->Pon();
   _testboard->Flush();
 
+  // The register values are unknown after powering up:
+  shadowInvalidate();
+
   // Clear HAL internal counters:
   m_tbmtype = TBM_NONE;
   m_roctype = ROC_NONE;
@@ -1422,6 +1614,7 @@ void hal::Poff() {
   // Turn off DUT power and execute (flush):
   _testboard->Poff();
   _testboard->Flush();
+  shadowInvalidate();
 }
 
 
@@ -1517,10 +1710,13 @@ void hal::SigSetLVDS(){
 void hal::daqStart(uint16_t flags, uint8_t deser160phase, uint32_t buffersize) {
 
   LOG(logDEBUGHAL) << "Starting new DAQ session.";
+  if((flags & FLAG_DAQ_PREFETCH) != 0) { LOG(logDEBUGHAL) << "Prefetching " << DTB_SOURCE_PREFETCH_BLOCKS << " data blocks per channel."; }
   for(uint8_t channel = 0; channel < DTB_DAQ_CHANNELS; channel++) { m_daqstatus.push_back(false); }
   
   // Clear all decoder instances:
   for(size_t ch = 0; ch < m_decoder.size(); ch++) { m_decoder.at(ch).Clear(); }
+  for(size_t ch = 0; ch < DTB_DAQ_CHANNELS; ch++) { m_daqfillmax[ch] = 0; }
+  m_rawarena.clear();
 
   // Figure out the number of DAQ channels we need:
   if(m_tokenchains.empty()) { m_tokenchains.push_back(m_roccount); }
@@ -1536,14 +1732,18 @@ void hal::daqStart(uint16_t flags, uint8_t deser160phase, uint32_t buffersize) {
 
   // Open all DAQ channels we need:
   uint8_t rocid_offset = 0;
+  m_daqbuffersize = buffersize;
   for(size_t i = 0; i < m_tokenchains.size(); i++) {
     // Open DAQ in channel i:
     uint32_t allocated_buffer = _testboard->Daq_Open(buffersize, i);
+    if(allocated_buffer > 0 && allocated_buffer < m_daqbuffersize) { m_daqbuffersize = allocated_buffer; }
     LOG(logDEBUGHAL) << "Channel " << i << ": token chain: "
 				<< static_cast<int>(m_tokenchains.at(i))
 				<< " offset " << static_cast<int>(rocid_offset) << " buffer " << allocated_buffer;
     // Initialize the data source, set tokenchain length to zero if no token pass is expected:
-    m_src.at(i) = dtbSource(_testboard,( m_tbmtype == TBM_10C && m_roccount == 16 ) ? ((i + 6) % 8) : i,m_tokenchains.at(i),rocid_offset,m_tbmtype,m_roctype,true,flags);
+    m_src.at(i) = dtbSource(_testboard,( m_tbmtype == TBM_10C && m_roccount == 16 ) ? ((i + 6) % 8) : i,m_tokenchains.at(i),rocid_offset,m_tbmtype,m_roctype,true,flags,&m_daqlock,
+			    ((flags & FLAG_DAQ_PREFETCH) != 0 ? DTB_SOURCE_PREFETCH_BLOCKS : 0));
+    m_splitter.at(i).Clear();
     m_src.at(i) >> m_splitter.at(i);
     _testboard->uDelay(100);
     // Increment the ROC id offset by the amount of ROCs expected:
@@ -1648,40 +1848,189 @@ Event hal::daqEvent() {
   return current_Event;
 }
 
+// Move a batch of decoded events to the end of a channel queue:
+static void daqHandOver(std::deque<Event> & queue, std::deque<Event> & batch) {
+  if(queue.empty()) { queue.swap(batch); }
+  else { queue.insert(queue.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end())); }
+  batch.clear();
+}
+
+void hal::daqDecodeChannel(size_t channel, daqChannelQueue * queue) {
+
+  dataSink<Event*> Eventpump;
+  m_splitter.at(channel) >> m_decoder.at(channel) >> Eventpump;
+
+  // Events are handed over in batches to keep the synchronization with the caller low:
+  std::deque<Event> batch;
+  try {
+    try {
+      while(1) {
+	batch.push_back(*Eventpump.Get());
+	if(batch.size() >= 256) {
+	  std::unique_lock<std::mutex> lock(queue->lock);
+	  while(queue->events.size() >= 4*256 && !queue->cancelled) { queue->space.wait(lock); }
+	  if(queue->cancelled) return;
+	  daqHandOver(queue->events, batch);
+	  queue->ready.notify_one();
+	}
+      }
+    }
+    catch (dsBufferEmpty &) {
+      LOG(logDEBUGHAL) << "Finished readout Channel " << channel << ".";
+      daqMemReset(channel);
+      daqFlush();
+    }
+  }
+  catch (dataPipeException &e) { queue->pipeError = true; queue->message = e.what(); }
+  catch (...) { queue->error = std::current_exception(); }
+
+  std::lock_guard<std::mutex> guard(queue->lock);
+  daqHandOver(queue->events, batch);
+  queue->finished = true;
+  queue->ready.notify_one();
+}
+
+// Cancels and joins the DAQ channel workers on every way out of daqProcessEventsParallel:
+struct daqWorkerJoin {
+  std::vector<std::thread> & workers;
+  std::vector<daqChannelQueue> & queues;
+daqWorkerJoin(std::vector<std::thread> & threads, std::vector<daqChannelQueue> & channels) : workers(threads), queues(channels) {}
+  ~daqWorkerJoin() {
+    for(std::vector<daqChannelQueue>::iterator q = queues.begin(); q != queues.end(); ++q) {
+      std::lock_guard<std::mutex> guard(q->lock);
+      q->cancelled = true;
+      q->space.notify_one();
+    }
+    for(std::vector<std::thread>::iterator w = workers.begin(); w != workers.end(); ++w) { if(w->joinable()) w->join(); }
+  }
+};
+
+// Collects the streamed events for daqAllEvents:
+class daqEventCollector : public eventVisitor {
+public:
+  std::vector<Event> events;
+  void processEvent(Event & evt) { events.push_back(std::move(evt)); }
+};
+
 std::vector<Event> hal::daqAllEvents() {
 
-  std::vector<Event> evt;
+  daqEventCollector collector;
+  daqProcessEvents(collector);
+  // Hand over the collected events without copying them:
+  std::vector<Event> events;
+  events.swap(collector.events);
+  return events;
+}
+
+// Appends the streamed events to an event batch:
+class daqBatchCollector : public eventVisitor {
+public:
+  eventBatch & batch;
+  daqBatchCollector(eventBatch & events) : batch(events) {}
+  void processEvent(Event & evt) { batch.push_back(evt); }
+};
+
+size_t hal::daqAllEvents(eventBatch & batch) {
+
+  batch.clear();
+
+  // Multiple channels decoded in parallel are merged into Events first:
+  if(daqParallelDecoding()) {
+    daqBatchCollector collector(batch);
+    return daqProcessEventsParallel(collector);
+  }
+
   uint16_t flags = 0;
   
   // Prepare channel flags:
   std::vector<bool> done_ch;
   for(size_t i = 0; i < m_src.size(); i++) { done_ch.push_back(false); }
 
+  while(1) {
+    // Add the next Event from each of the pipes directly to the open Event of the batch:
+    for(size_t ch = 0; ch < m_src.size(); ch++) {
+      if(m_src.at(ch).isConnected() && (!done_ch.at(ch))) {
+	dataSink<Event*> Eventpump;
+	m_splitter.at(ch) >> m_decoder.at(ch) >> Eventpump;
+
+	// Read the supplied DAQ flags:
+	if(flags == 0 && ch == 0) { flags = Eventpump.GetFlags(); }
+
+	try { batch.append(*Eventpump.Get()); }
+	catch (dsBufferEmpty &) {
+	  LOG(logDEBUGHAL) << "Finished readout Channel " << ch << ".";
+	  daqMemReset(ch);
+	  done_ch.at(ch) = true;
+	}
+	catch (dataPipeException &e) { LOG(logERROR) << e.what(); batch.discard(); return batch.size(); }
+      }
+      else { done_ch.at(ch) = true; }
+    }
+
+    daqFlush();
+
+    // If all readout is finished, drop the incomplete Event and return:
+    std::vector<bool>::iterator fin = std::find(done_ch.begin(), done_ch.end(), false);
+    if(fin == done_ch.end()) {
+      LOG(logDEBUGHAL) << "Drained all DAQ channels.";
+      batch.discard();
+      break;
+    }
+    else {
+      // Check for the channels all reporting the same event number:
+      if((flags & FLAG_DISABLE_EVENTID_CHECK) == 0 && !batch.equalTriggerCounts(batch.size())) {
+	std::vector<uint8_t> counts = batch.triggerCounts(batch.size());
+	batch.discard();
+	LOG(logERROR) << "Channels report mismatching event numbers: " << listVector(counts);
+	throw DataEventNumberMismatch("Channels report mismatching event numbers: " + listVector(counts));
+      }
+      // Store the event
+      batch.close();
+    }
+  }
+  
+  if(batch.empty()) throw DataNoEvent("No event available");
+  return batch.size();
+}
+
+size_t hal::daqProcessEvents(eventVisitor & visitor) {
+
+  // Decode the channels in parallel if requested:
+  if(daqParallelDecoding()) { return daqProcessEventsParallel(visitor); }
+
+  size_t nevents = 0;
+  uint16_t flags = 0;
+  
+  // Prepare channel flags:
+  std::vector<bool> done_ch;
+  for(size_t i = 0; i < m_src.size(); i++) { done_ch.push_back(false); }
+
+  // The event is reused, keeping the memory of its vectors:
+  Event current_Event;
   while(1) {
     // Read the next Event from each of the pipes:
-    Event current_Event;
+    current_Event.Clear();
     for(size_t ch = 0; ch < m_src.size(); ch++) {
       if(m_src.at(ch).isConnected() && (!done_ch.at(ch))) {
 	dataSink<Event*> Eventpump;
 	m_splitter.at(ch) >> m_decoder.at(ch) >> Eventpump;
 
 	// Read the supplied DAQ flags:
-      if(flags == 0 && ch == 0) { flags = Eventpump.GetFlags(); }
+	if(flags == 0 && ch == 0) { flags = Eventpump.GetFlags(); }
 
 	// Add all event data from this channel:
 	try { current_Event += *Eventpump.Get(); }
 	catch (dsBufferEmpty &) {
 	  LOG(logDEBUGHAL) << "Finished readout Channel " << ch << ".";
-	  // Reset the DTB memory to work around buffer issue:
-	  _testboard->Daq_MemReset(ch);
+	  daqMemReset(ch);
 	  done_ch.at(ch) = true;
 	}
-	catch (dataPipeException &e) { LOG(logERROR) << e.what(); return evt; }
+	catch (dataPipeException &e) { LOG(logERROR) << e.what(); return nevents; }
       }
       else { done_ch.at(ch) = true; }
     }
 
-    _testboard->Flush();
+    daqFlush();
 
     // If all readout is finished, return:
     std::vector<bool>::iterator fin = std::find(done_ch.begin(), done_ch.end(), false);
@@ -1695,13 +2044,101 @@ std::vector<Event> hal::daqAllEvents() {
 	LOG(logERROR) << "Channels report mismatching event numbers: " << listVector(current_Event.triggerCounts());
 	throw DataEventNumberMismatch("Channels report mismatching event numbers: " + listVector(current_Event.triggerCounts()));
       }
-      // Store the event
-      evt.push_back(current_Event);
+      // Hand the event to the consumer:
+      visitor.processEvent(current_Event);
+      nevents++;
+    }
+  }
+  
+  if(nevents == 0) throw DataNoEvent("No event available");
+  return nevents;
+}
+
+bool hal::daqParallelDecoding() {
+  size_t nconnected = 0;
+  bool requested = false;
+  for(size_t i = 0; i < m_src.size(); i++) {
+    if(!m_src.at(i).isConnected()) continue;
+    nconnected++;
+    if((m_src.at(i).GetConfig().flags & FLAG_PARALLEL_DECODING) != 0) { requested = true; }
+  }
+  return (requested && nconnected > 1 && std::thread::hardware_concurrency() > 1);
+}
+
+size_t hal::daqProcessEventsParallel(eventVisitor & visitor) {
+
+  size_t nevents = 0;
+  uint16_t flags = 0;
+  
+  // Read the supplied DAQ flags:
+  if(!m_src.empty() && m_src.at(0).isConnected()) {
+    dataSink<Event*> Eventpump;
+    m_splitter.at(0) >> m_decoder.at(0) >> Eventpump;
+    flags = Eventpump.GetFlags();
+  }
+
+  // Prepare channel flags and queues, events already taken from the queues are kept in pending:
+  std::vector<bool> done_ch;
+  std::vector<daqChannelQueue> queues(m_src.size());
+  std::vector<std::deque<Event> > pending(m_src.size());
+  for(size_t i = 0; i < m_src.size(); i++) { done_ch.push_back(!m_src.at(i).isConnected()); }
+
+  // Decode every channel on its own thread:
+  std::vector<std::thread> workers;
+  daqWorkerJoin join(workers, queues);
+  for(size_t ch = 0; ch < m_src.size(); ch++) {
+    if(!done_ch.at(ch)) { workers.push_back(std::thread(&hal::daqDecodeChannel, this, ch, &queues.at(ch))); }
+  }
+
+  while(1) {
+    // Merge the next Event from each of the channel queues:
+    Event current_Event;
+    bool first = true;
+    for(size_t ch = 0; ch < m_src.size(); ch++) {
+      if(done_ch.at(ch)) continue;
+
+      // Take over all events the worker has delivered so far:
+      if(pending.at(ch).empty()) {
+	daqChannelQueue & queue = queues.at(ch);
+	std::unique_lock<std::mutex> lock(queue.lock);
+	while(queue.events.empty() && !queue.finished) { queue.ready.wait(lock); }
+	pending.at(ch).swap(queue.events);
+	queue.space.notify_one();
+
+	if(pending.at(ch).empty()) {
+	  if(queue.error) { std::rethrow_exception(queue.error); }
+	  if(queue.pipeError) { LOG(logERROR) << queue.message; return nevents; }
+	  done_ch.at(ch) = true;
+	  continue;
+	}
+      }
+
+      // Add all event data from this channel, the first one is just taken over:
+      if(first) { std::swap(current_Event, pending.at(ch).front()); first = false; }
+      else { current_Event += pending.at(ch).front(); }
+      pending.at(ch).pop_front();
+    }
+
+    // If all readout is finished, return:
+    std::vector<bool>::iterator fin = std::find(done_ch.begin(), done_ch.end(), false);
+    if(fin == done_ch.end()) {
+      LOG(logDEBUGHAL) << "Drained all DAQ channels.";
+      break;
+    }
+    else {
+      // Check for the channels all reporting the same event number:
+      if((flags & FLAG_DISABLE_EVENTID_CHECK) == 0 && !equalElements(current_Event.triggerCounts())) {
+	LOG(logERROR) << "Channels report mismatching event numbers: " << listVector(current_Event.triggerCounts());
+	throw DataEventNumberMismatch("Channels report mismatching event numbers: " + listVector(current_Event.triggerCounts()));
+      }
+      // Hand the event to the consumer:
+      visitor.processEvent(current_Event);
+      nevents++;
     }
   }
   
-  if(evt.empty()) throw DataNoEvent("No event available");
-  return evt;
+  if(nevents == 0) throw DataNoEvent("No event available");
+  return nevents;
 }
 
 rawEvent hal::daqRawEvent() {
@@ -1742,38 +2179,41 @@ std::vector<rawEvent> hal::daqAllRawEvents() {
   std::vector<bool> done_ch;
   for(size_t i = 0; i < m_src.size(); i++) { done_ch.push_back(false); }
 
+  // The records are collected in the raw event arena, make room for all data
+  // buffered on the DTB so the readout needs a single allocation:
+  m_rawarena.reserve(daqBufferStatus());
+
   while(1) {
-    // Read the next Event from each of the pipes:
-    rawEvent current_Event;
-    
+    // Read the next Event from each of the pipes into the open arena record:
     for(size_t ch = 0; ch < m_src.size(); ch++) {
       if(m_src.at(ch).isConnected() && (!done_ch.at(ch))) {
 	dataSink<rawEvent*> rawpump;
 	m_splitter.at(ch) >> rawpump;
 	
-	try { current_Event += *rawpump.Get(); }
+	try { m_rawarena.append(*rawpump.Get()); }
 	catch (dsBufferEmpty &) {
 	  LOG(logDEBUGHAL) << "Finished readout Channel " << ch << ".";
-	  // Reset the DTB memory to work around buffer issue:
-	  _testboard->Daq_MemReset(ch);
+	  daqMemReset(ch);
 	  done_ch.at(ch) = true;
 	}
-	catch (dataPipeException &e) { LOG(logERROR) << e.what(); return raw; }
+	catch (dataPipeException &e) { LOG(logERROR) << e.what(); m_rawarena.discard(); return raw; }
       }
       else { done_ch.at(ch) = true; }
     }
 
-    _testboard->Flush();
+    daqFlush();
 
     // If all readout is finished, return:
     std::vector<bool>::iterator fin = std::find(done_ch.begin(), done_ch.end(), false);
     if(fin == done_ch.end()) {
       LOG(logDEBUGHAL) << "Drained all DAQ channels.";
+      m_rawarena.discard();
       break;
     }
-    else { raw.push_back(current_Event); }
+    else { raw.push_back(m_rawarena.close()); }
   }
 
+  LOG(logDEBUGHAL) << "Stored " << raw.size() << " raw events, " << m_rawarena.slabCount() << " arena slabs allocated in this session.";
   if(raw.empty()) throw DataNoEvent("No event available");
   return raw;
 }
@@ -1785,25 +2225,30 @@ std::vector<uint16_t> hal::daqBuffer() {
   // Read the full data blob from each of the pipes:
   for(size_t ch = 0; ch < m_src.size(); ch++) {
     if(m_src.at(ch).isConnected()) {
+      // The splitter reads the source block-wise, start with the words it holds already:
+      size_t pending = m_splitter.at(ch).Drain(raw);
+      if(pending > 0) { LOG(logDEBUGHAL) << "Channel " << ch << ": " << pending << " words taken from the splitter."; }
+
       dataSink<uint16_t> rawpump;
       m_src.at(ch) >> rawpump;
       try { while(1) { raw.push_back(rawpump.Get()); } }
       catch (dsBufferEmpty &) {
 	LOG(logDEBUGHAL) << "Finished readout Channel " << ch << ".";
-	// Reset the DTB memory to work around buffer issue:
-	_testboard->Daq_MemReset(ch);
+	daqMemReset(ch);
       }
       catch (dataPipeException &e) { LOG(logERROR) << e.what(); return raw; }
     }
   }
 
-  _testboard->Flush();
+  daqFlush();
   if(raw.empty()) throw DataNoEvent("No data available");
   return raw;
 }
 
 void hal::daqTriggerSource(uint16_t source) {
 
+  std::lock_guard<std::mutex> guard(m_daqlock);
+
   // Update the locally cached setting for trigger source:
   _currentTrgSrc = source;
 
@@ -1816,6 +2261,8 @@ void hal::daqTriggerSource(uint16_t source) {
 
 void hal::daqTriggerGenRandom(uint32_t rate) {
 
+  std::lock_guard<std::mutex> guard(m_daqlock);
+
   LOG(logDEBUGHAL) << "Configuring trigger generator with rate " << rate;
 
   // Activate random generator:
@@ -1824,6 +2271,8 @@ void hal::daqTriggerGenRandom(uint32_t rate) {
 
 void hal::daqTriggerGenPeriodic(uint32_t period) {
 
+  std::lock_guard<std::mutex> guard(m_daqlock);
+
   LOG(logDEBUGHAL) << "Configuring trigger generator with period " << period;
 
   // Activate periodic generator:
@@ -1832,6 +2281,8 @@ void hal::daqTriggerGenPeriodic(uint32_t period) {
 
 void hal::daqTriggerPgExtern() {
 
+  std::lock_guard<std::mutex> guard(m_daqlock);
+
     // Connect the DTB TRG input to the PG trigger input
 
     LOG(logDEBUGHAL) << "Configuring externally triggered pattern generator";
@@ -1843,6 +2294,8 @@ void hal::daqTriggerPgExtern() {
 
 void hal::daqTriggerSingleSignal(uint8_t signal) {
 
+  std::lock_guard<std::mutex> guard(m_daqlock);
+
   // Attach the single signal direct source for triggers
   // in addition to the currently active source:
   _testboard->Trigger_Select(TRG_SEL_SINGLE_DIR | _currentTrgSrc);
@@ -1851,6 +2304,10 @@ void hal::daqTriggerSingleSignal(uint8_t signal) {
   // Send the requested signal:
   _testboard->Trigger_Send(signal);
   _testboard->Flush();
+
+  // Don't rely on the shadow registers of the devices reset:
+  if((signal & TRG_SEND_RSR) != 0) { m_rocshadow.clear(); m_rocpixels.clear(); }
+  if((signal & TRG_SEND_RST) != 0) { m_tbmshadow.clear(); }
   
   // Reset the trigger source to cached setting:
   _testboard->Trigger_Select(_currentTrgSrc);
@@ -1859,6 +2316,8 @@ void hal::daqTriggerSingleSignal(uint8_t signal) {
 
 void hal::daqTrigger(uint32_t nTrig, uint16_t period) {
 
+  std::lock_guard<std::mutex> guard(m_daqlock);
+
   LOG(logDEBUGHAL) << "Triggering " << nTrig << "x";
   _testboard->Pg_Triggers(nTrig, period);
   // Push to testboard:
@@ -1866,6 +2325,8 @@ void hal::daqTrigger(uint32_t nTrig, uint16_t period) {
 }
 
 void hal::daqTriggerLoop(uint16_t period) {
+
+  std::lock_guard<std::mutex> guard(m_daqlock);
   
   LOG(logDEBUGHAL) << "Trigger loop every " << period << " clock cycles started.";
   _testboard->Pg_Loop(period);
@@ -1875,6 +2336,8 @@ void hal::daqTriggerLoop(uint16_t period) {
 }
 
 void hal::daqTriggerLoopHalt() {
+
+  std::lock_guard<std::mutex> guard(m_daqlock);
   
   LOG(logDEBUGHAL) << "Trigger loop halted.";
   _testboard->Pg_Stop();
@@ -1884,12 +2347,21 @@ void hal::daqTriggerLoopHalt() {
 
 uint32_t hal::daqBufferStatus() {
 
+  std::lock_guard<std::mutex> guard(m_daqlock);
+
   uint32_t buffered_data = 0;
   // Summing up data words in all active DAQ channels:
   for(uint8_t channel = 0; channel < DTB_DAQ_CHANNELS; channel++) {
     if(m_daqstatus.size() > channel && m_daqstatus.at(channel)) {
-      buffered_data += _testboard->Daq_GetSize(channel);
-      LOG(logDEBUGHAL) << "daqbufferstatus" << static_cast<int>(channel) << ": " << _testboard->Daq_GetSize(channel);
+      uint32_t size = _testboard->Daq_GetSize(channel);
+      buffered_data += size;
+      LOG(logDEBUGHAL) << "daqbufferstatus" << static_cast<int>(channel) << ": " << size;
+
+      // Keep track of the highest fill level for the live statistics:
+      if(m_daqbuffersize > 0) {
+	uint8_t fill = static_cast<uint8_t>(std::min<uint64_t>(100, static_cast<uint64_t>(size)*100/m_daqbuffersize));
+	if(fill > m_daqfillmax[channel]) { m_daqfillmax[channel] = fill; }
+      }
     }
   }
   return buffered_data;
@@ -1904,6 +2376,17 @@ statistics hal::daqStatistics() {
   return errors;
 }
 
+std::vector<statistics> hal::daqLiveStatistics() {
+  // The decoders publish their statistics themselves, no need to lock the DAQ:
+  std::vector<statistics> live;
+  for(size_t ch = 0; ch < m_decoder.size(); ch++) {
+    statistics s = m_decoder.at(ch).getLiveStatistics();
+    if(ch < DTB_DAQ_CHANNELS) { s.m_info_buffer_fill_max = m_daqfillmax[ch]; }
+    live.push_back(s);
+  }
+  return live;
+}
+
 std::vector<std::vector<uint16_t> > hal::daqReadback() {
 
   // Collect readback values from all decoder instances:
@@ -1925,6 +2408,8 @@ std::vector<uint8_t> hal::daqXORsum(uint8_t channel) {
 
 void hal::daqStop() {
 
+  std::lock_guard<std::mutex> guard(m_daqlock);
+
   // Stop the Pattern Generator, just in case (also stops Pg_Loop())
   _testboard->Pg_Stop();
 
@@ -1949,6 +2434,9 @@ void hal::daqClear() {
   LOG(logDEBUGHAL) << "Closing DAQ session, deleting data buffers.";
   for(uint8_t channel = 0; channel < DTB_DAQ_CHANNELS; channel++) { _testboard->Daq_Close(channel); }
   m_daqstatus.clear();
+
+  // Release the raw event storage, records handed out keep their data:
+  m_rawarena.clear();
 }
 
 std::vector<uint16_t> hal::daqADC(uint8_t analog_probe, uint8_t gain, uint16_t nSample, uint8_t source, uint8_t start, uint8_t stop){
@@ -1994,86 +2482,289 @@ uint16_t hal::GetADC(uint8_t rpc_par1){
   return _testboard->GetADC(rpc_par1);
 }
 
-std::vector<Event> hal::condenseTriggers(std::vector<Event> &data, uint16_t nTriggers, bool efficiency) {
+void hal::condenseEvent(Event & evt) {
 
-  std::vector<Event> packed;
-
-  if(data.size()%nTriggers != 0) {
-    LOG(logCRITICAL) << "Data size does not correspond to " << nTriggers << " triggers! Aborting data processing!";
-    return packed;
+  // First event of a group of triggers:
+  if(m_condensegroup == 0) {
+    // Start a new pass, all slots written in earlier passes are stale now:
+    if(++m_condensepass == 0) {
+      // The pass counter wrapped around, invalidate the full table once:
+      std::fill(m_condensetable.begin(), m_condensetable.end(), condenseSlot());
+      m_condensepass = 1;
+    }
+    m_condenseout->push_back(Event());
   }
 
-  for(std::vector<Event>::iterator Eventit = data.begin(); Eventit!= data.end(); Eventit += nTriggers) {
+  std::vector<pixel> & pixels = m_condenseout->back().pixels;
+  bool efficiency = m_condenseefficiency;
 
-    Event evt;
-    std::map<pixel,uint16_t> pxcount = std::map<pixel,uint16_t>();
-    std::map<pixel,double> pxmean = std::map<pixel,double>();
-    std::map<pixel,double> pxm2 = std::map<pixel,double>();
+  // Loop over all contained pixels:
+  for(std::vector<pixel>::iterator pixit = evt.pixels.begin(); pixit != evt.pixels.end(); ++pixit) {
 
-    for(std::vector<Event>::iterator it = Eventit; it != Eventit+nTriggers; ++it) {
+    if(pixit->column() >= ROC_NUMCOLS || pixit->row() >= ROC_NUMROWS) {
+      LOG(logWARNING) << "Skipping pixel with invalid address " << *pixit << " while condensing triggers.";
+      continue;
+    }
 
-      // Loop over all contained pixels:
-      for(std::vector<pixel>::iterator pixit = (it)->pixels.begin(); pixit != (it)->pixels.end(); ++pixit) {
+    // Look up the accumulator slot of this pixel, grow the table for unexpected ROC ids:
+    size_t slotid = pixelIndex(pixit->roc(), pixit->column(), pixit->row());
+    if(slotid >= m_condensetable.size()) {
+      m_condensetable.resize(static_cast<size_t>(pixit->roc()+1)*ROC_NUMCOLS*ROC_NUMROWS);
+    }
+    condenseSlot & slot = m_condensetable[slotid];
 
-	// Check if we have that particular pixel already in:
-	std::vector<pixel>::iterator px = std::find_if(evt.pixels.begin(),
-						       evt.pixels.end(),
-						       findPixelXY(pixit->column(), pixit->row(), pixit->roc()));
-	// Pixel is known:
-	if(px != evt.pixels.end()) {
-	  if(efficiency) { px->setValue(px->value()+1); }
-	  else {
-	    // Calculate the variance incrementally:
-	    double delta = pixit->value() - pxmean[*px];
-	    pxmean[*px] += delta/pxcount[*px];
-	    pxm2[*px] += delta*(pixit->value() - pxmean[*px]);
-	    pxcount[*px]++;
-	  }
-	}
-	// Pixel is new:
-	else {
-	  if(efficiency) { pixit->setValue(1); }
-	  else {
-	    // Initialize counters and temporary variables:
-	    pxcount.insert(std::make_pair(*pixit,1));
-	    pxmean.insert(std::make_pair(*pixit,pixit->value()));
-	    pxm2.insert(std::make_pair(*pixit,0));
-	  }
-	  evt.pixels.push_back(*pixit);
-	}
+    // Pixel is known:
+    if(slot.pass == m_condensepass) {
+      pixel & px = pixels[slot.index];
+      if(efficiency) { px.setValue(px.value()+1); }
+      else {
+	// Calculate the variance incrementally:
+	double delta = pixit->value() - slot.mean;
+	slot.mean += delta/slot.count;
+	slot.m2 += delta*(pixit->value() - slot.mean);
+	slot.count++;
       }
     }
-
-    // Calculate mean and variance for the pulse height depending on the
-    // number of triggers received:
-    if(!efficiency) {
-      for(std::vector<pixel>::iterator px = evt.pixels.begin(); px != evt.pixels.end(); ++px) {
-	px->setValue(pxmean[*px]); // The mean
-	px->setVariance(pxm2[*px]/(pxcount[*px] - 1)); // The variance
+    // Pixel is new:
+    else {
+      if(efficiency) { pixit->setValue(1); }
+      else {
+	// Initialize counters and temporary variables:
+	slot.count = 1;
+	slot.mean = pixit->value();
+	slot.m2 = 0;
       }
+      slot.pass = m_condensepass;
+      slot.index = pixels.size();
+      pixels.push_back(*pixit);
     }
-    packed.push_back(evt);
   }
 
-  // Clean up the dangling pointers in the vector:
-  data.clear();
-  return packed;
+  // Last event of the group:
+  if(++m_condensegroup < m_condensetriggers) return;
+  m_condensegroup = 0;
+
+  // Calculate mean and variance for the pulse height depending on the
+  // number of triggers received:
+  if(!efficiency) {
+    for(std::vector<pixel>::iterator px = pixels.begin(); px != pixels.end(); ++px) {
+      condenseSlot & slot = m_condensetable[pixelIndex(px->roc(), px->column(), px->row())];
+      px->setValue(slot.mean); // The mean
+      px->setVariance(slot.m2/(slot.count - 1)); // The variance
+    }
+  }
 }
 
 void hal::addCondensedData(std::vector<Event> &data, uint16_t nTriggers, bool efficiency, timer t) {
 
-  std::vector<Event> tmpdata = std::vector<Event>();
+  // Condense the events while they are read, directly into the data vector:
+  size_t first = data.size();
+  m_condenseout = &data;
+  m_condensetriggers = nTriggers;
+  m_condenseefficiency = efficiency;
+  m_condensegroup = 0;
+
   try {
-    tmpdata = daqAllEvents();
-    tmpdata = condenseTriggers(tmpdata, nTriggers, efficiency);
-    data.insert(data.end(),tmpdata.begin(),tmpdata.end());
-    LOG(logDEBUGHAL) << (tmpdata.size()*nTriggers) << " events read and condensed (" << t << "ms), "
+    eventCallback<hal> condenser(this, &hal::condenseEvent);
+    size_t events = daqProcessEvents(condenser);
+    if(m_condensegroup != 0) {
+      LOG(logCRITICAL) << "Data size does not correspond to " << nTriggers << " triggers! Aborting data processing!";
+      data.erase(data.begin() + first, data.end());
+      return;
+    }
+    LOG(logDEBUGHAL) << events << " events read and condensed (" << t << "ms), "
 		     << data.size() << " events buffered.";
     LOG(logINFO) << (data.size()*nTriggers) << " events read in total (" << t << "ms).";
   }
   catch(DataNoEvent) {}
   catch(DataException &e) {
     LOG(logCRITICAL) << "Error in DAQ: " << e.what() << " Aborting test.";
+    data.erase(data.begin() + first, data.end());
     throw e;
   }
 }
+
+// Joins the background decoding of a pipelined test loop on every way out of runTestLoop:
+struct daqPipelineJoin {
+  std::thread & worker;
+  bool & captured;
+daqPipelineJoin(std::thread & thread, bool & flag) : worker(thread), captured(flag) {}
+  ~daqPipelineJoin() {
+    if(worker.joinable()) worker.join();
+    captured = false;
+  }
+};
+
+size_t hal::runTestLoop(std::function<bool()> loop, std::vector<Event> &data, uint16_t nTriggers, bool efficiency, uint16_t flags, timer t) {
+
+  // The NIOS loops program the pixels of the ROCs themselves:
+  m_rocpixels.clear();
+
+  bool done = false;
+  size_t samples = 0;
+  if((flags & FLAG_PIPELINED_LOOPS) == 0) {
+    while(!done) {
+      done = loop();
+      uint32_t words = daqBufferStatus();
+      LOG(logDEBUGHAL) << "Loop " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << words << " words...";
+      samples += words;
+      addCondensedData(data,nTriggers,efficiency,t);
+    }
+    return samples;
+  }
+
+  // Pipelined loop: copy the data of every segment off the DTB and decode it in
+  // the background while the DTB already runs the next segment:
+  std::vector<std::vector<uint16_t> > segment, decoding;
+  std::thread worker;
+  std::exception_ptr error;
+  daqPipelineJoin join(worker, m_daqcaptured);
+  m_daqcaptured = true;
+
+  while(!done) {
+    {
+      std::lock_guard<std::mutex> guard(m_daqlock);
+      done = loop();
+    }
+    uint32_t words = daqBufferStatus();
+    LOG(logDEBUGHAL) << "Loop " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << words << " words...";
+    samples += words;
+    daqCapture(segment);
+
+    // The previous segment has to be condensed before the next one is started:
+    if(worker.joinable()) worker.join();
+    if(error) { std::rethrow_exception(error); }
+    decoding.swap(segment);
+    worker = std::thread(&hal::daqDecodeCaptured, this, &decoding, &data, nTriggers, efficiency, t, &error);
+  }
+
+  worker.join();
+  if(error) { std::rethrow_exception(error); }
+  return samples;
+}
+
+void hal::runDacScanLoop(std::function<bool(uint8_t, uint8_t)> loop, uint8_t dacmin, uint8_t dacmax, uint8_t dacstep, size_t blocks, size_t eventsPerStep, uint64_t samples, std::vector<Event> &data, uint16_t nTriggers, bool efficiency, uint16_t flags, timer t) {
+
+  size_t steps = static_cast<size_t>((dacmax-dacmin)/dacstep+1);
+  size_t channels = (m_tokenchains.empty() ? 1 : m_tokenchains.size());
+
+  // Samples expected per channel and DAC step, and the share of the buffer to be filled per segment:
+  double stepsamples = static_cast<double>(samples)/channels/steps;
+  double budget = static_cast<double>(m_daqbuffersize)*DTB_LOOP_SEGMENT_FILL/100;
+
+  // The full range fits into the DTB buffer, no need to split:
+  if(stepsamples*steps <= budget) {
+    runTestLoop([&]() { return loop(dacmin, dacmax); }, data, nTriggers, efficiency, flags, t);
+    return;
+  }
+
+  std::vector<std::vector<Event> > segments;
+  std::vector<size_t> segmentsteps;
+  size_t scanned = 0;
+  while(scanned < steps) {
+    size_t n = static_cast<size_t>(budget/stepsamples);
+    if(n < 1) { n = 1; }
+    if(n > steps - scanned) { n = steps - scanned; }
+
+    uint8_t first = static_cast<uint8_t>(dacmin + scanned*dacstep);
+    uint8_t last = static_cast<uint8_t>(first + (n-1)*dacstep);
+    LOG(logDEBUGHAL) << "Loop segment " << segments.size() << ": DAC range " << static_cast<int>(first)
+		     << " to " << static_cast<int>(last) << ", expecting "
+		     << static_cast<uint64_t>(stepsamples*n) << " samples per channel.";
+
+    segments.push_back(std::vector<Event>());
+    segmentsteps.push_back(n);
+    size_t words = runTestLoop([&]() { return loop(first, last); }, segments.back(), nTriggers, efficiency, flags, t);
+
+    // Adapt the segment size to the data volume actually observed:
+    if(words > 0) { stepsamples = static_cast<double>(words)/channels/n; }
+    scanned += n;
+  }
+  LOG(logDEBUGHAL) << "DAC range scanned in " << segments.size() << " loop segments.";
+
+  // Every segment holds the events of all pixels for its part of the DAC range, merge
+  // them back to the order of the full range per pixel:
+  for(size_t s = 0; s < segments.size(); s++) {
+    if(segments.at(s).size() != blocks*segmentsteps.at(s)*eventsPerStep) {
+      // The events cannot be assigned to their DAC steps, do not hand out a scan in the wrong order:
+      LOG(logCRITICAL) << "Loop segment " << s << " returned " << segments.at(s).size() << " instead of "
+		       << (blocks*segmentsteps.at(s)*eventsPerStep) << " events, cannot merge segments. Aborting test.";
+      throw DataException("Event count of DAC scan loop segment does not match the scan range.");
+    }
+  }
+
+  data.reserve(data.size() + blocks*steps*eventsPerStep);
+  for(size_t b = 0; b < blocks; b++) {
+    for(size_t s = 0; s < segments.size(); s++) {
+      std::vector<Event>::iterator first = segments.at(s).begin() + b*segmentsteps.at(s)*eventsPerStep;
+      data.insert(data.end(), std::make_move_iterator(first), std::make_move_iterator(first + segmentsteps.at(s)*eventsPerStep));
+    }
+  }
+}
+
+void hal::daqCapture(std::vector<std::vector<uint16_t> > &raw) {
+
+  raw.resize(m_src.size());
+  for(size_t ch = 0; ch < m_src.size(); ch++) {
+    raw.at(ch).clear();
+    if(!m_src.at(ch).isConnected()) continue;
+
+    // Copy the channel data block-wise:
+    dataSink<uint16_t> rawpump;
+    m_src.at(ch) >> rawpump;
+    try {
+      while(1) {
+	uint16_t * first, * last;
+	rawpump.GetBlock(first, last);
+	raw.at(ch).insert(raw.at(ch).end(), first, last);
+      }
+    }
+    catch (dsBufferEmpty &) {
+      // Reset the DTB memory to work around buffer issue:
+      std::lock_guard<std::mutex> guard(m_daqlock);
+      _testboard->Daq_MemReset(ch);
+    }
+    catch (dataPipeException &e) {
+      // Do not condense an incomplete segment, fail like the unpipelined loop:
+      LOG(logCRITICAL) << "Error in DAQ: " << e.what() << " Aborting test.";
+      std::lock_guard<std::mutex> guard(m_daqlock);
+      _testboard->Flush();
+      throw DataException(e.what());
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(m_daqlock);
+  _testboard->Flush();
+}
+
+void hal::daqDecodeCaptured(std::vector<std::vector<uint16_t> > * raw, std::vector<Event> * data, uint16_t nTriggers, bool efficiency, timer t, std::exception_ptr * error) {
+
+  // Feed the splitters from the copied channel data instead of the DTB:
+  std::vector<dtbCaptureSource> sources(m_src.size());
+  for(size_t ch = 0; ch < m_src.size(); ch++) {
+    if(!m_src.at(ch).isConnected()) continue;
+    sources.at(ch).Fill(m_src.at(ch).GetConfig(), raw->at(ch));
+    sources.at(ch) >> m_splitter.at(ch);
+  }
+
+  try { addCondensedData(*data, nTriggers, efficiency, t); }
+  catch(...) { *error = std::current_exception(); }
+
+  // Connect the splitters back to the DTB:
+  for(size_t ch = 0; ch < m_src.size(); ch++) {
+    if(m_src.at(ch).isConnected()) { m_src.at(ch) >> m_splitter.at(ch); }
+  }
+}
+
+void hal::daqMemReset(uint8_t channel) {
+  // The channel memory was reset already when copying its data:
+  if(m_daqcaptured) return;
+  std::lock_guard<std::mutex> guard(m_daqlock);
+  _testboard->Daq_MemReset(channel);
+}
+
+void hal::daqFlush() {
+  if(m_daqcaptured) return;
+  std::lock_guard<std::mutex> guard(m_daqlock);
+  _testboard->Flush();
+}
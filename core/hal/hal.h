@@ -7,9 +7,13 @@
 #include "datasource_dtb.h"
 #include "constants.h"
 #include "timer.h"
+#include <functional>
+#include <atomic>
 
 namespace pxar {
 
+  struct daqChannelQueue;
+
   class hal
   {
 
@@ -131,6 +135,26 @@ namespace pxar {
      */
     bool tbmSetRegs(uint8_t hubid, uint8_t core, std::map< uint8_t, uint8_t > regPairs);
 
+    /** Collect the following RPC calls to the testboard and send them in one go,
+     *  dropping repeated address selects. Batches can be nested, the calls are sent
+     *  when the outermost batch ends. rpcBatchEnd() throws if the calls cannot be sent.
+     *  Use the rpcBatch scope guard to end it reliably.
+     */
+    void rpcBatchStart();
+    void rpcBatchEnd();
+
+    /** Forget the ROC DAC and TBM register values and the pixel trim/mask images held by
+     *  the shadow registers, the next writes are sent to the DUT again. Called at power
+     *  cycles and ROC/TBM resets.
+     */
+    void shadowInvalidate();
+
+    /** Number of register writes skipped because the shadow registers held the value
+     *  already, and number of writes sent to the DUT
+     */
+    uint32_t shadowHits() { return m_shadowhits; }
+    uint32_t shadowMisses() { return m_shadowmisses; }
+
     /** Function to set and update the pattern generator command list on the DTB
      */
     void SetupPatternGenerator(std::vector<std::pair<uint16_t,uint8_t> > pg_setup, uint16_t delaysum);
@@ -367,10 +391,26 @@ namespace pxar {
      */
     std::vector<Event> daqAllEvents();
 
+    /** Read all remaining decoded Events from the FIFO buffer and hand them to
+     *  the visitor one by one, without storing them. Returns the number of Events
+     */
+    size_t daqProcessEvents(eventVisitor & visitor);
+
+    /** Read all remaining decoded Events from the FIFO buffer into the batch,
+     *  merging the channels directly in the batch columns. Returns the number of Events
+     */
+    size_t daqAllEvents(eventBatch & batch);
+
     /** Return the current decoding statistics for all channels:
      */
     statistics daqStatistics();
 
+    /** Return a copy of the live decoding statistics of every channel without
+     *  clearing them. Does not touch the testboard and can be called from any
+     *  thread while the DAQ is running.
+     */
+    std::vector<statistics> daqLiveStatistics();
+
     /** Return all readback values for the last readout. Return format is a vector containing
      *  one vector of uint16_t radback values for every ROC in the readout chain.
      */
@@ -472,20 +512,53 @@ namespace pxar {
     bool FindDTB(std::string &usbId);
 
     /** Internal helper function to calculate an estimate of the data volume to be
-     *  expected for the upcoming test. This function only supplies debug output
-     *  and has no further effect on the data transmission or similar.
+     *  expected for the upcoming test. Returns the estimated number of samples,
+     *  which is used to size the loop segments of DAC scans.
      */
-    void estimateDataVolume(uint32_t events, uint8_t nROCs);
+    uint64_t estimateDataVolume(uint32_t events, uint8_t nROCs);
 
-    /** Merges all consecutive triggers into one pxar::Event. This function deletes the original event data after
-     *  merging! 
+    /** Merges consecutive triggers into one pxar::Event: every event read is accumulated into the
+     *  last event of the output set up by addCondensedData, a new one is started every nTriggers events
      */
-    std::vector<Event> condenseTriggers(std::vector<Event> &data, uint16_t nTriggers, bool efficiency);
+    void condenseEvent(Event & evt);
 
     /** Helper function reading data, passing it to the condenser and then returns it to the test function
      */
     void addCondensedData(std::vector<Event> &data, uint16_t nTriggers, bool efficiency, timer t);
 
+    /** Runs a test loop on the DTB until it has finished, reading and condensing the data
+     *  after every loop segment, and returns the number of samples read. With
+     *  FLAG_PIPELINED_LOOPS the data of each segment is decoded and condensed in the
+     *  background while the DTB already runs the next one.
+     */
+    size_t runTestLoop(std::function<bool()> loop, std::vector<Event> &data, uint16_t nTriggers, bool efficiency, uint16_t flags, timer t);
+
+    /** Runs a DAC scan test loop, splitting the (outer) DAC range into segments that fit
+     *  the DTB buffer instead of letting the testboard interrupt the loop when the buffer
+     *  is full. The segment size is taken from the estimated number of samples and then
+     *  adapted to the data volume observed, e.g. with additional noise or background hits.
+     *  blocks is the number of pixels scanned outside of the DAC loop, eventsPerStep the
+     *  number of condensed events per pixel and DAC step. The data of the segments is
+     *  merged back into the order of a single loop call. Throws a DataException if a
+     *  segment does not return the expected number of events.
+     */
+    void runDacScanLoop(std::function<bool(uint8_t, uint8_t)> loop, uint8_t dacmin, uint8_t dacmax, uint8_t dacstep, size_t blocks, size_t eventsPerStep, uint64_t samples, std::vector<Event> &data, uint16_t nTriggers, bool efficiency, uint16_t flags, timer t);
+
+    /** Copy all data of the open DAQ channels off the DTB and reset the channel memory
+     */
+    void daqCapture(std::vector<std::vector<uint16_t> > &raw);
+
+    /** Decode and condense the channel data copied by daqCapture, used as background
+     *  worker by runTestLoop. Exceptions are handed back to the caller via error.
+     */
+    void daqDecodeCaptured(std::vector<std::vector<uint16_t> > * raw, std::vector<Event> * data, uint16_t nTriggers, bool efficiency, timer t, std::exception_ptr * error);
+
+    /** Reset the DTB memory of a fully read DAQ channel to work around a buffer issue.
+     *  Flushing and resetting is skipped while decoding data copied by daqCapture.
+     */
+    void daqMemReset(uint8_t channel);
+    void daqFlush();
+
     // TESTBOARD SET COMMANDS
     /** Set the testboard analog current limit
      */
@@ -519,6 +592,127 @@ namespace pxar {
     std::vector<dtbSource> m_src;
     std::vector<dtbEventSplitter> m_splitter;
     std::vector<dtbEventDecoder> m_decoder;
+
+    /** Storage for the raw event records of the DAQ session, the records
+     *  returned by daqAllRawEvents refer to it
+     */
+    rawEventArena m_rawarena;
+
+    /** Serializes the testboard access of the DAQ functions while channels are
+     *  read out in the background or decoded in parallel
+     */
+    std::mutex m_daqlock;
+
+    /** Set while the pipes decode channel data copied off the DTB by daqCapture. The
+     *  DTB memory has been reset already then and the testboard runs the next loop.
+     */
+    bool m_daqcaptured;
+
+    /** Smallest DTB buffer allocated for one of the DAQ channels, in samples
+     */
+    uint32_t m_daqbuffersize;
+
+    /** Highest fill level of each DAQ channel buffer in percent seen by
+     *  daqBufferStatus since the start of the DAQ session
+     */
+    std::atomic<uint8_t> m_daqfillmax[DTB_DAQ_CHANNELS];
+
+    /** Read and decode all channels in parallel, merging the events of the
+     *  channels in readout order. Used by daqProcessEvents for multi-channel setups.
+     */
+    size_t daqProcessEventsParallel(eventVisitor & visitor);
+
+    /** Returns true if the DAQ session was started with FLAG_PARALLEL_DECODING,
+     *  has more than one channel and there are cores to decode them in parallel
+     */
+    bool daqParallelDecoding();
+
+    /** Decode all events of one DAQ channel into its queue, used as per-channel
+     *  worker by daqProcessEventsParallel
+     */
+    void daqDecodeChannel(size_t channel, daqChannelQueue * queue);
+
+    /** Accumulator slot used by condenseEvent, one for every (roc, column, row).
+     *  Slots carry the number of the condensing pass they were last written in,
+     *  so the table never has to be cleared between events.
+     */
+    struct condenseSlot {
+      uint32_t pass;
+      uint32_t index;
+      uint16_t count;
+      double mean;
+      double m2;
+    condenseSlot() : pass(0), index(0), count(0), mean(0), m2(0) {}
+    };
+
+    /** Dense (roc, column, row) accumulator table for condenseEvent, sized for
+     *  a full module and reused for all calls. Grows if higher ROC ids appear.
+     */
+    std::vector<condenseSlot> m_condensetable;
+
+    /** Counter of the condensing passes, marks the valid slots in m_condensetable
+     */
+    uint32_t m_condensepass;
+
+    /** Output and settings of the running condensing, see condenseEvent. m_condensegroup
+     *  counts the events already merged into the last output event
+     */
+    std::vector<Event> * m_condenseout;
+    uint16_t m_condensetriggers;
+    bool m_condenseefficiency;
+    size_t m_condensegroup;
+
+    /** Check a register write against the shadow registers. Returns false if the
+     *  register holds the value already and the write can be skipped.
+     */
+    bool shadowRocDAC(uint8_t roci2c, uint8_t dacId, uint8_t dacValue);
+    bool shadowTbmReg(uint8_t hubid, uint8_t regId, uint8_t regValue);
+
+    /** Store a register value in the shadow registers once it has been sent
+     */
+    void shadowRocDACWritten(uint8_t roci2c, uint8_t dacId, uint8_t dacValue);
+    void shadowTbmRegWritten(uint8_t hubid, uint8_t regId, uint8_t regValue);
+
+    /** Track the hub addressed by the ROC writes, the ROC shadow registers and
+     *  pixel images are forgotten when it changes
+     */
+    void shadowHub(uint8_t hub0, uint8_t hub1);
+
+    /** Forget a DAC on all ROCs, e.g. after a test loop has scanned it
+     */
+    void shadowForgetDAC(uint8_t dacId);
+
+    /** Write-through shadow registers with the values last written to the ROC DACs
+     *  (keyed by I2C address and DAC id, for the hub selected last) and TBM registers
+     *  (hub id and register id)
+     */
+    std::map<uint16_t, uint8_t> m_rocshadow;
+    std::map<uint16_t, uint8_t> m_tbmshadow;
+    std::pair<uint8_t, uint8_t> m_shadowhub;
+
+    /** Trim/mask images last uploaded per ROC I2C address, to the ROC pixels (-1 for
+     *  masked pixels, for the hub selected last) and to the NIOS trim storage, and the
+     *  I2C addresses in the storage
+     */
+    std::map<uint8_t, std::vector<int16_t> > m_rocpixels;
+    std::map<uint8_t, std::vector<uint8_t> > m_niostrims;
+    std::vector<uint8_t> m_niosi2c;
+
+    uint32_t m_shadowhits;
+    uint32_t m_shadowmisses;
+  };
+
+  /** Scope guard collecting the RPC calls to the testboard into one batch while
+   *  it exists, see hal::rpcBatchStart. Call end() to send the batch and see its
+   *  errors, the destructor only ends batches left by an exception or error return.
+   */
+  class rpcBatch {
+    hal * m_hal;
+    bool m_ended;
+  public:
+    rpcBatch(hal * h);
+    ~rpcBatch();
+    void end();
   };
 }
 #endif
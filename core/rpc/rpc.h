@@ -22,13 +22,20 @@
 
 #ifdef ENABLE_MULTITHREADING
 #include <boost/thread.hpp>
-#define RPC_THREAD boost::mutex m_sync;
-#define RPC_THREAD_LOCK boost::lock_guard<boost::mutex> lock(m_sync);
+#define RPC_THREAD boost::recursive_mutex m_sync;
+#define RPC_THREAD_LOCK boost::lock_guard<boost::recursive_mutex> lock(m_sync);
 #define RPC_THREAD_UNLOCK
+#define RPC_THREAD_ACQUIRE m_sync.lock();
+#define RPC_THREAD_RELEASE m_sync.unlock();
 #else
-#define RPC_THREAD
-#define RPC_THREAD_LOCK
+// The DAQ prefetch readers call Daq_Read from their own threads, so every RPC
+// call is serialized. Recursive, as a batch holds the lock over all its calls:
+#include <mutex>
+#define RPC_THREAD std::recursive_mutex m_sync;
+#define RPC_THREAD_LOCK std::lock_guard<std::recursive_mutex> lock(m_sync);
 #define RPC_THREAD_UNLOCK
+#define RPC_THREAD_ACQUIRE m_sync.lock();
+#define RPC_THREAD_RELEASE m_sync.unlock();
 #endif
 
 using namespace std;
@@ -0,0 +1,145 @@
+// rpc_batch.cpp
+
+#include <algorithm>
+#include "rpc.h"
+#include "rpc_batch.h"
+
+
+CRpcIoBatch::CRpcIoBatch() : m_io(&RpcIoNull), m_msgStart(0), m_parse(true),
+	m_commands(0), m_bytes(0), m_coalesced(0), m_savedBytes(0), m_flushRequests(0), m_flushes(0) {}
+
+
+void CRpcIoBatch::AddSelectCmd(uint16_t cmd)
+{
+	m_selectCmd.push_back(cmd);
+	m_selection.push_back(std::vector<uint8_t>());
+	m_selected.push_back(false);
+}
+
+
+void CRpcIoBatch::AddKeepCmd(uint16_t cmd)
+{
+	m_keepCmd.push_back(cmd);
+}
+
+
+void CRpcIoBatch::ClearCmds()
+{
+	m_selectCmd.clear();
+	m_selection.clear();
+	m_selected.clear();
+	m_keepCmd.clear();
+}
+
+
+void CRpcIoBatch::Begin(CRpcIo *io)
+{
+	m_io = io;
+	m_buffer.clear();
+	m_msgStart = 0;
+	m_parse = true;
+	Unselect(m_selected.size());
+	m_commands = m_bytes = m_coalesced = m_savedBytes = m_flushRequests = m_flushes = 0;
+}
+
+
+void CRpcIoBatch::End()
+{
+	Send();
+}
+
+
+void CRpcIoBatch::Write(const void *buffer, uint32_t size)
+{
+	const uint8_t *data = static_cast<const uint8_t*>(buffer);
+	m_buffer.insert(m_buffer.end(), data, data + size);
+	if (m_parse) Parse();
+}
+
+
+void CRpcIoBatch::Send()
+{
+	if (m_buffer.empty()) return;
+
+	// The parsing cannot continue behind a message which is cut:
+	if (m_parse && m_msgStart != m_buffer.size())
+	{
+		m_parse = false;
+		Unselect(m_selected.size());
+	}
+	m_io->Write(&(m_buffer[0]), m_buffer.size());
+	m_io->Flush();
+	m_flushes++;
+	m_buffer.clear();
+	m_msgStart = 0;
+}
+
+
+void CRpcIoBatch::Parse()
+{
+	while (m_msgStart < m_buffer.size())
+	{
+		size_t available = m_buffer.size() - m_msgStart;
+		if (available < 4) return;
+
+		const uint8_t *msg = &(m_buffer[m_msgStart]);
+		if (msg[0] == RPC_TYPE_DTB)
+		{ // command: type, command id (2), parameter size (1), parameters
+			size_t size = 4 + msg[3];
+			if (available < size) return;
+			Command(m_msgStart, size);
+		}
+		else if (msg[0] == RPC_TYPE_DTB_DATA)
+		{ // data block of the last command: type, data size (3), data
+			size_t size = 4 + (msg[1] | (msg[2] << 8) | (msg[3] << 16));
+			if (available < size) return;
+			m_msgStart += size;
+			m_bytes += size;
+		}
+		else
+		{ // unknown message, pass everything on unchanged from here:
+			m_parse = false;
+			Unselect(m_selected.size());
+			return;
+		}
+	}
+}
+
+
+void CRpcIoBatch::Command(size_t pos, size_t size)
+{
+	uint16_t cmd = m_buffer[pos+1] | (m_buffer[pos+2] << 8);
+	m_commands++;
+
+	std::vector<uint16_t>::iterator select = std::find(m_selectCmd.begin(), m_selectCmd.end(), cmd);
+	if (select != m_selectCmd.end())
+	{
+		size_t i = select - m_selectCmd.begin();
+		std::vector<uint8_t> par(m_buffer.begin() + pos + 4, m_buffer.begin() + pos + size);
+		if (m_selected[i] && m_selection[i] == par)
+		{ // the address is selected already, drop the message:
+			m_buffer.erase(m_buffer.begin() + pos, m_buffer.begin() + pos + size);
+			m_coalesced++;
+			m_savedBytes += size;
+			return;
+		}
+		// Other selections might depend on this one, they have to be repeated:
+		Unselect(i);
+		m_selection[i] = par;
+		m_selected[i] = true;
+	}
+	else if (std::find(m_keepCmd.begin(), m_keepCmd.end(), cmd) == m_keepCmd.end())
+	{
+		Unselect(m_selected.size());
+	}
+
+	m_msgStart = pos + size;
+	m_bytes += size;
+}
+
+
+void CRpcIoBatch::Unselect(size_t except)
+{
+	for (size_t i = 0; i < m_selected.size(); i++)
+		if (i != except) m_selected[i] = false;
+}
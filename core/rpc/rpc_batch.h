@@ -0,0 +1,69 @@
+// rpc_batch.h
+
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "rpc_io.h"
+
+
+// Batched RPC interface: collects the messages of the RPC calls and passes them to
+// the wrapped interface in one go when the batch is sent. Flush requests of the
+// calls are deferred, only reading a return value forces the pending messages out.
+// Address selects repeating the current selection are dropped as long as only
+// commands keeping the selection have been sent in between.
+class CRpcIoBatch : public CRpcIo
+{
+	CRpcIo *m_io;
+	std::vector<uint8_t> m_buffer;
+	size_t m_msgStart;  // start of the message not yet complete
+	bool m_parse;       // cleared after an unknown message type
+
+	std::vector<uint16_t> m_selectCmd;
+	std::vector<std::vector<uint8_t> > m_selection;
+	std::vector<bool> m_selected;
+	std::vector<uint16_t> m_keepCmd;
+
+	uint32_t m_commands, m_bytes, m_coalesced, m_savedBytes, m_flushRequests, m_flushes;
+
+	void Parse();
+	void Command(size_t pos, size_t size);
+	void Unselect(size_t except);
+	void Send();
+public:
+	CRpcIoBatch();
+
+	// Define the address select commands and the commands keeping the selection:
+	void AddSelectCmd(uint16_t cmd);
+	void AddKeepCmd(uint16_t cmd);
+	void ClearCmds();
+
+	// Start collecting the messages for io, resets the statistics:
+	void Begin(CRpcIo *io);
+	// Send all pending messages to the wrapped interface:
+	void End();
+	CRpcIo *GetIo() { return m_io; }
+
+	// Statistics of the last batch:
+	uint32_t GetCommands() { return m_commands; }
+	uint32_t GetBytes() { return m_bytes; }
+	uint32_t GetCoalesced() { return m_coalesced; }
+	uint32_t GetSavedBytes() { return m_savedBytes; }
+	uint32_t GetSavedFlushes() { return (m_flushRequests > m_flushes) ? m_flushRequests - m_flushes : 0; }
+
+	void Write(const void *buffer, uint32_t size);
+	void Flush() { m_flushRequests++; }
+	void Clear() { m_io->Clear(); }
+	void Read(void *buffer, uint32_t size) { Send(); m_io->Read(buffer, size); }
+	const char* Name() { return m_io->Name(); }
+	int32_t GetLastError() { return m_io->GetLastError(); }
+	const char* GetErrorMsg(int error) { return m_io->GetErrorMsg(error); }
+	bool Open(char name[]) { return m_io->Open(name); }
+	void Close() { m_io->Close(); }
+	bool EnumFirst(uint32_t &nDevices) { return m_io->EnumFirst(nDevices); }
+	bool EnumNext(char name[]) { return m_io->EnumNext(name); }
+	bool Enum(char name[], uint32_t pos) { return m_io->Enum(name, pos); }
+	bool Connected() { return m_io->Connected(); }
+	void SetTimeout(unsigned int timeout) { m_io->SetTimeout(timeout); }
+};
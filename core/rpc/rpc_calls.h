@@ -1,6 +1,7 @@
 #pragma once
 
 #include "rpc.h"
+#include "rpc_batch.h"
 #include <vector>
 
 #ifdef INTERFACE_USB
@@ -26,11 +27,27 @@ class CTestboard
 
   std::vector<CRpcIo*> interfaceList;
 
+  CRpcIoBatch rpc_batch;
+  unsigned int rpc_batchLevel;
+
+  void rpc_BatchCmd(const char *name, bool select) {
+    for (unsigned int i = 2; i < rpc_cmdListSize; i++) {
+      if (string(rpc_cmdName[i]) != name) continue;
+      try {
+	if (select) rpc_batch.AddSelectCmd(rpc_GetCallId(i));
+	else rpc_batch.AddKeepCmd(rpc_GetCallId(i));
+      }
+      catch (CRpcError &) {}
+      return;
+    }
+  }
+
 public:
 	CRpcIo& GetIo() { return *rpc_io; }
 
 	CTestboard() { 
 	  RPC_INIT 
+	  rpc_batchLevel = 0;
 
 #ifdef INTERFACE_USB
 	  usb = NULL;
@@ -213,8 +230,51 @@ public:
 	const char * ConnectionError()
 	{ return rpc_io->GetErrorMsg(rpc_io->GetLastError()); }
 
-	void Flush() { rpc_io->Flush(); }
-	void Clear() { rpc_io->Clear(); }
+	void Flush() { RPC_THREAD_LOCK rpc_io->Flush(); }
+	void Clear() { RPC_THREAD_LOCK rpc_io->Clear(); }
+
+
+	// === RPC batching ======================================================
+
+	// Collect the following RPC calls and send them with a single write when the
+	// outermost batch ends. Flushes are deferred until a call reads a return value,
+	// address selects repeating the current selection are dropped. The batch holds
+	// the RPC lock until it ends, so no other thread can write past it:
+	void BatchStart() {
+	  RPC_THREAD_ACQUIRE
+	  if (rpc_batchLevel++ > 0) return;
+
+	  // Commands selecting the ROC or hub address, and the ROC and TBM register
+	  // commands which do not change the selection:
+	  rpc_batch.ClearCmds();
+	  rpc_BatchCmd("roc_I2cAddr$vC", true);
+	  rpc_BatchCmd("mod_Addr$vC", true);
+	  const char *keep[] = { "roc_ClrCal$v", "roc_SetDAC$vCC", "roc_Pix$vCCC", "roc_Pix_Trim$vCCC", "roc_Pix_Mask$vCC",
+				 "roc_Pix_Cal$vCCb", "roc_Col_Enable$vCb", "roc_AllCol_Enable$vb", "roc_Col_Mask$vC", "tbm_Set$vCC" };
+	  for (size_t i = 0; i < sizeof(keep)/sizeof(keep[0]); i++) rpc_BatchCmd(keep[i], false);
+
+	  rpc_batch.Begin(rpc_io);
+	  rpc_io = &rpc_batch;
+	}
+
+	// End a batch, returns true if it was the outermost one and has been sent:
+	bool BatchEnd() {
+	  if (rpc_batchLevel == 0) return false;
+	  if (--rpc_batchLevel > 0) { RPC_THREAD_RELEASE return false; }
+	  rpc_io = rpc_batch.GetIo();
+	  try { rpc_batch.End(); }
+	  catch (...) { RPC_THREAD_RELEASE throw; }
+	  RPC_THREAD_RELEASE
+	  return true;
+	}
+
+	void GetBatchStatistics(uint32_t &commands, uint32_t &bytes, uint32_t &coalesced, uint32_t &savedBytes, uint32_t &savedFlushes) {
+	  commands = rpc_batch.GetCommands();
+	  bytes = rpc_batch.GetBytes();
+	  coalesced = rpc_batch.GetCoalesced();
+	  savedBytes = rpc_batch.GetSavedBytes();
+	  savedFlushes = rpc_batch.GetSavedFlushes();
+	}
 
 
 	// === DTB identification ================================================
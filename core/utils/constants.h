@@ -11,7 +11,10 @@ namespace pxar {
 
 // --- Data Transmission settings & flags --------------------------------------
 #define DTB_SOURCE_BLOCK_SIZE  8192
+#define DTB_SOURCE_PREFETCH_BLOCKS 4 // blocks in flight per channel with FLAG_DAQ_PREFETCH
+#define DTB_STATISTICS_PUBLISH 64 // events between two live statistics updates of a decoder
 #define DTB_SOURCE_BUFFER_SIZE 50000000
+#define DTB_LOOP_SEGMENT_FILL 80 // percent of the DTB buffer a segment of a DAC scan loop is sized to fill
 #define DTB_DAQ_FIFO_OVFL 4 // bit 2 = DAQ fast HW FIFO overflow
 #define DTB_DAQ_MEM_OVFL  2 // bit 1 = DAQ RAM FIFO overflow
 #define DTB_DAQ_STOPPED   1 // bit 0 = DAQ stopped (because of overflow)
@@ -48,6 +51,7 @@ namespace pxar {
 #define ROC_NUMROWS 80
 #define ROC_NUMCOLS 52
 #define MOD_NUMROCS 16
+#define ROC_TRIM_SPARSE_LIMIT 512 // changed pixels up to which a ROC is trimmed pixel by pixel instead of a full TrimChip
 
 // --- ROC Types ---------------------------------------------------------------
 #define ROC_NONE              0x00
@@ -26,6 +26,7 @@ typedef unsigned char uint8_t;
 #endif // WIN32
 
 #include "api.h"
+#include "constants.h"
 
 #include <algorithm>
 #include <string>
@@ -102,6 +103,25 @@ namespace pxar {
   };
 
 
+  /** Helper function returning the position of a pixel in dense per-pixel
+   *  lookup tables, laid out as ROC -> column -> row with ROC_NUMCOLS*ROC_NUMROWS
+   *  entries per ROC.
+   */
+  inline size_t pixelIndex(uint8_t roc, uint8_t column, uint8_t row) {
+    return (static_cast<size_t>(roc)*ROC_NUMCOLS + column)*ROC_NUMROWS + row;
+  }
+
+  /** Helper struct holding the per-pixel bookkeeping of the threshold
+   *  finding: position in the result vector (-1 if not yet seen), whether
+   *  the threshold has been found and the efficiency at the last DAC step.
+   */
+  struct thresholdState {
+    int32_t index;
+    bool found;
+    uint8_t oldvalue;
+  thresholdState() : index(-1), found(false), oldvalue(0) {}
+  };
+
   /** Helper class to search vectors of pixel or pixelConfig for
       'column' and 'row' values BEYOND the values given in the constructor
   */
@@ -138,14 +158,23 @@ namespace pxar {
 
   /** Helper to compare the pixel configuration of rocConfigs
   */
-  bool inline comparePixelConfiguration(const std::vector<pixelConfig> pxA, const std::vector<pixelConfig> pxB) {
+  bool inline comparePixelConfiguration(const std::vector<pixelConfig> & pxA, const std::vector<pixelConfig> & pxB) {
 
     // Check the number of enabled pixels:
     if(pxA.size() != pxB.size()) return false;
 
+    // Count how often every pixel appears in B (up to two times):
+    std::vector<uint8_t> found(ROC_NUMCOLS*ROC_NUMROWS, 0);
+    for(std::vector<pixelConfig>::const_iterator pixit = pxB.begin(); pixit != pxB.end(); pixit++){
+      if(pixit->column() >= ROC_NUMCOLS || pixit->row() >= ROC_NUMROWS) { return false; }
+      uint8_t & n = found[pixit->column()*ROC_NUMROWS + pixit->row()];
+      if(n < 2) n++;
+    }
+
     // Check the single pixels:
     for(std::vector<pixelConfig>::const_iterator pixit = pxA.begin(); pixit != pxA.end(); pixit++){
-      if(std::count_if(pxB.begin(), pxB.end(), findPixelXY(pixit->column(),pixit->row())) != 1) { return false; }
+      if(pixit->column() >= ROC_NUMCOLS || pixit->row() >= ROC_NUMROWS) { return false; }
+      if(found[pixit->column()*ROC_NUMROWS + pixit->row()] != 1) { return false; }
     }
     return true;
   }
@@ -220,6 +249,9 @@ namespace pxar {
     if((flags&FLAG_DISABLE_READBACK_COLLECTION) != 0) { os << "FLAG_DISABLE_READBACK_COLLECTION, "; flags -= FLAG_DISABLE_READBACK_COLLECTION; }
     if((flags&FLAG_DISABLE_EVENTID_CHECK) != 0) { os << "FLAG_DISABLE_EVENTID_CHECK, "; flags -= FLAG_DISABLE_EVENTID_CHECK; }
     if((flags&FLAG_ENABLE_XORSUM_LOGGING) != 0) { os << "FLAG_ENABLE_XORSUM_LOGGING, "; flags -= FLAG_ENABLE_XORSUM_LOGGING; }
+    if((flags&FLAG_DAQ_PREFETCH) != 0) { os << "FLAG_DAQ_PREFETCH, "; flags -= FLAG_DAQ_PREFETCH; }
+    if((flags&FLAG_PIPELINED_LOOPS) != 0) { os << "FLAG_PIPELINED_LOOPS, "; flags -= FLAG_PIPELINED_LOOPS; }
+    if((flags&FLAG_PARALLEL_DECODING) != 0) { os << "FLAG_PARALLEL_DECODING, "; flags -= FLAG_PARALLEL_DECODING; }
 
     if(flags != 0) os << "Unknown flag: " << flags;
     return os.str();
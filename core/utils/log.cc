@@ -0,0 +1,232 @@
+#include "log.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <exception>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+
+namespace pxar {
+
+  // Number of messages the queue of the background writer can hold:
+  static const size_t LOG_QUEUE_SIZE = 4096;
+  // Time in milliseconds after which the writer looks for new messages at the latest:
+  static const unsigned int LOG_WRITER_INTERVAL = 10;
+
+  // Background log writer
+  // The producers claim a slot of a bounded ring with a compare-and-swap on the
+  // tail index and publish it by bumping the sequence number of the slot, so
+  // logging never takes a lock (bounded MPMC queue after D. Vyukov). The writer
+  // thread drains the ring in batches and flushes the streams once per batch.
+  // The message strings stay in their slots, so their memory is reused.
+  class logWriter {
+  public:
+    static logWriter & instance() {
+      // Never destroyed, messages from static destructors may still arrive:
+      static logWriter * writer = new logWriter();
+      return *writer;
+    }
+
+    // Checked before touching the instance, so synchronous logging does not
+    // create the writer at all:
+    static std::atomic<bool> created;
+    static std::atomic<bool> active;
+
+    void start();
+    void stop();
+
+    // Queue a message. If the queue is full, the calling thread writes out
+    // the queued messages and its own instead:
+    bool push(const std::string & msg, FILE * stream, bool duplicate);
+    void flush();
+
+  private:
+    logWriter();
+    void run();
+    size_t drain();
+
+    struct record {
+      std::atomic<size_t> sequence;
+      std::string message;
+      FILE * stream;
+      bool duplicate;
+    };
+    std::vector<record> ring;
+    size_t mask;
+    std::atomic<size_t> head, tail;
+
+    // Serializes the consumers: writer thread, flush and queue overflow:
+    std::mutex writeLock;
+    std::vector<FILE*> touched;
+
+    std::mutex waitLock;
+    std::condition_variable wakeup;
+    std::thread thread;
+  };
+
+  std::atomic<bool> logWriter::created(false);
+  std::atomic<bool> logWriter::active(false);
+
+  static std::terminate_handler previousTerminate = NULL;
+
+  static void flushOnTerminate() {
+    SetLogOutput::Flush();
+    if(previousTerminate) { previousTerminate(); }
+    std::abort();
+  }
+
+  static void flushOnExit() { logWriter::instance().stop(); }
+
+  logWriter::logWriter() : ring(LOG_QUEUE_SIZE), mask(LOG_QUEUE_SIZE - 1), head(0), tail(0), touched() {
+    for(size_t i = 0; i < ring.size(); i++) { ring[i].sequence.store(i, std::memory_order_relaxed); }
+    created = true;
+    std::atexit(flushOnExit);
+  }
+
+  void logWriter::start() {
+    std::lock_guard<std::mutex> guard(writeLock);
+    if(active) return;
+    active = true;
+    thread = std::thread(&logWriter::run, this);
+    if(!previousTerminate) { previousTerminate = std::set_terminate(flushOnTerminate); }
+  }
+
+  void logWriter::stop() {
+    {
+      std::lock_guard<std::mutex> guard(writeLock);
+      active = false;
+    }
+    wakeup.notify_one();
+    if(thread.joinable()) { thread.join(); }
+    // Messages queued while the writer was shutting down:
+    flush();
+  }
+
+  bool logWriter::push(const std::string & msg, FILE * stream, bool duplicate) {
+    size_t pos = tail.load(std::memory_order_relaxed);
+    record * slot;
+    while(true) {
+      slot = &ring[pos & mask];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      if(sequence == pos) {
+	if(tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      }
+      else if(sequence < pos) {
+	// The queue is full, write everything out in this thread to keep the order.
+	// Slots claimed before may not be published yet, wait until all of them,
+	// including the earlier messages of this thread, have been written:
+	std::lock_guard<std::mutex> guard(writeLock);
+	size_t claimed = tail.load(std::memory_order_acquire);
+	drain();
+	while(head.load(std::memory_order_relaxed) < claimed) {
+	  std::this_thread::yield();
+	  drain();
+	}
+	if(duplicate && stream != stderr) { fputs(msg.c_str(), stderr); }
+	fputs(msg.c_str(), stream);
+	fflush(stream);
+	return true;
+      }
+      else { pos = tail.load(std::memory_order_relaxed); }
+    }
+
+    slot->message = msg;
+    slot->stream = stream;
+    slot->duplicate = duplicate;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    // Only wake the writer early when the queue fills up, otherwise it
+    // collects the messages of one interval:
+    if(pos - head.load(std::memory_order_relaxed) == ring.size()/2) { wakeup.notify_one(); }
+    return true;
+  }
+
+  size_t logWriter::drain() {
+    size_t written = 0;
+    touched.clear();
+    size_t pos = head.load(std::memory_order_relaxed);
+    while(true) {
+      record & slot = ring[pos & mask];
+      if(slot.sequence.load(std::memory_order_acquire) != pos + 1) break;
+
+      if(slot.duplicate && slot.stream != stderr) {
+	fputs(slot.message.c_str(), stderr);
+	if(std::find(touched.begin(), touched.end(), stderr) == touched.end()) { touched.push_back(stderr); }
+      }
+      fputs(slot.message.c_str(), slot.stream);
+      if(std::find(touched.begin(), touched.end(), slot.stream) == touched.end()) { touched.push_back(slot.stream); }
+
+      // Hand the slot back to the producers:
+      slot.sequence.store(pos + ring.size(), std::memory_order_release);
+      head.store(++pos, std::memory_order_relaxed);
+      written++;
+    }
+    for(size_t i = 0; i < touched.size(); i++) { fflush(touched[i]); }
+    return written;
+  }
+
+  void logWriter::flush() {
+    std::lock_guard<std::mutex> guard(writeLock);
+    drain();
+  }
+
+  void logWriter::run() {
+    while(active) {
+      {
+	std::unique_lock<std::mutex> lock(waitLock);
+	wakeup.wait_for(lock, std::chrono::milliseconds(LOG_WRITER_INTERVAL));
+      }
+      std::lock_guard<std::mutex> guard(writeLock);
+      drain();
+    }
+  }
+
+  void SetLogOutput::Asynchronous(bool enable) {
+    if(enable) { logWriter::instance().start(); }
+    else if(logWriter::created) { logWriter::instance().stop(); }
+  }
+
+  bool SetLogOutput::Asynchronous() { return logWriter::active; }
+
+  void SetLogOutput::Flush() {
+    if(logWriter::created) { logWriter::instance().flush(); }
+    if(Stream()) { fflush(Stream()); }
+  }
+
+  bool SetLogOutput::Enqueue(const std::string& msg, FILE* stream, bool duplicate) {
+    if(!logWriter::active) return false;
+    return logWriter::instance().push(msg, stream, duplicate);
+  }
+
+  TLogLevel LogLevelCompiled() { return PXAR_LOG_LEVEL_MAX; }
+
+#ifndef WIN32
+  std::string LogTimestamp() {
+    // The wall clock time only changes once per second, so its formatted
+    // string is kept per thread and only the milliseconds are added:
+    static thread_local time_t lastSecond = 0;
+    static thread_local char clock[11] = {0};
+
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    if(tv.tv_sec != lastSecond || clock[0] == 0) {
+      tm r;
+      strftime(clock, sizeof(clock), "%X", localtime_r(&tv.tv_sec, &r));
+      lastSecond = tv.tv_sec;
+    }
+
+    long ms = static_cast<long>(tv.tv_usec) / 1000;
+    std::string result(clock);
+    result += '.';
+    result += static_cast<char>('0' + ms/100);
+    result += static_cast<char>('0' + (ms/10)%10);
+    result += static_cast<char>('0' + ms%10);
+    return result;
+  }
+#endif //WIN32
+
+} //namespace pxar
@@ -27,7 +27,9 @@ typedef unsigned int uint32_t;
 #include <sstream>
 #include <iomanip>
 #include <cstdio>
+#include <string>
 #include <string.h>
+#include "pxardllexport.h"
 
 
 namespace pxar {
@@ -46,6 +48,24 @@ namespace pxar {
     logINTERFACE
   };
 
+/** Highest log level compiled in, set by the CMake option LOG_LEVEL_MAX.
+ *  Statements above it are removed by the compiler whatever the reporting
+ *  level, so debug logging in the decoder loops costs nothing in production.
+ */
+#ifndef PXAR_LOG_LEVEL_MAX
+#define PXAR_LOG_LEVEL_MAX logINTERFACE
+#endif
+
+  /** Highest log level compiled into the pxar library
+   */
+  DLLEXPORT TLogLevel LogLevelCompiled();
+
+#ifndef WIN32
+  /** Current wall clock time as HH:MM:SS.mmm
+   */
+  DLLEXPORT std::string LogTimestamp();
+#endif //WIN32
+
   template <typename T>
     class pxarLog {
   public:
@@ -68,13 +88,14 @@ namespace pxar {
   protected:
     std::ostringstream os;
   private:
+    TLogLevel msgLevel;
     pxarLog(const pxarLog&);
     pxarLog& operator =(const pxarLog&);
     std::string NowTime();
   };
 
   template <typename T>
-    pxarLog<T>::pxarLog() {}
+    pxarLog<T>::pxarLog() : msgLevel(logINFO) {}
 
 
 #ifdef WIN32
@@ -97,22 +118,14 @@ namespace pxar {
 
   template <typename T>
     std::string pxarLog<T>::NowTime() {
-    char buffer[11];
-    time_t t;
-    time(&t);
-    tm r = * localtime(&t);
-    strftime(buffer, sizeof(buffer), "%X", localtime_r(&t, &r));
-    struct timeval tv;
-    gettimeofday(&tv, 0);
-    char result[100] = {0};
-    std::sprintf(result, "%s.%03ld", buffer, static_cast<long>(tv.tv_usec) / 1000); 
-    return result;
+    return LogTimestamp();
   }
 
 #endif //WIN32
 
   template <typename T>
     std::ostringstream& pxarLog<T>::Get(TLogLevel level, std::string file, std::string function, uint32_t line) {
+    msgLevel = level;
     os << "[" << NowTime() << "] ";
     if (logName().size() > 0) {
       os << "<" << logName() << "> ";
@@ -132,6 +145,9 @@ namespace pxar {
     pxarLog<T>::~pxarLog() {
     os << std::endl;
     T::Output(os.str());
+    // Critical messages often precede a crash, do not keep them queued:
+    if (msgLevel == logCRITICAL)
+      T::Flush();
   }
 
   template <typename T>
@@ -175,12 +191,26 @@ namespace pxar {
   }
 
 
-  class SetLogOutput
+  class DLLEXPORT SetLogOutput
   {
   public:
     static FILE*& Stream();
     static bool& Duplicate();
     static void Output(const std::string& msg);
+
+    /** Hand the messages to a background thread which writes them out in
+     *  batches, instead of writing and flushing in the logging thread. The
+     *  queued messages are written out on exit and on std::terminate, call
+     *  Flush() before closing the stream.
+     */
+    static void Asynchronous(bool enable);
+    static bool Asynchronous();
+
+    /** Write out all queued messages
+     */
+    static void Flush();
+  private:
+    static bool Enqueue(const std::string& msg, FILE* stream, bool duplicate);
   };
 
   inline bool& SetLogOutput::Duplicate()
@@ -200,6 +230,9 @@ namespace pxar {
     FILE* pStream = Stream();
     if (!pStream)
       return;
+    // Queue the message if the background writer is running:
+    if (Enqueue(msg, pStream, Duplicate()))
+      return;
     // Check if duplication to stderr is needed:
     if (Duplicate() && pStream != stderr)
       fprintf(stderr, "%s", msg.c_str());
@@ -212,11 +245,11 @@ typedef pxarLog<SetLogOutput> Log;
 #define __FILE_NAME__ (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
 
 #define IFLOG(level) \
-  if (level > pxar::Log::ReportingLevel() || !pxar::SetLogOutput::Stream()) ; \
+  if (level > pxar::PXAR_LOG_LEVEL_MAX || level > pxar::Log::ReportingLevel() || !pxar::SetLogOutput::Stream()) ; \
   else 
 
 #define LOG(level)				\
-  if (level > pxar::Log::ReportingLevel() || !pxar::SetLogOutput::Stream()) ; \
+  if (level > pxar::PXAR_LOG_LEVEL_MAX || level > pxar::Log::ReportingLevel() || !pxar::SetLogOutput::Stream()) ; \
   else pxar::Log().Get(level,__FILE_NAME__,__func__,__LINE__)
 
 } //namespace pxar
@@ -51,12 +51,14 @@ int main(int argc, char *argv[]){
     doRunSingleTest(false),
     doUpdateFlash(false),
     doUpdateRootFile(false),
-    doUseRootLogon(false)
+    doUseRootLogon(false),
+    doAsyncLog(false)
     ;
   for (int i = 0; i < argc; i++){
     if (!strcmp(argv[i],"-h")) {
       cout << "List of arguments:" << endl;
       cout << "-a                    do not do tests, do not recreate rootfile, but read in existing rootfile" << endl;
+      cout << "-A                    write the log file from a background thread (lines may be lost on a crash)" << endl;
       cout << "-c filename           read in commands from filename" << endl;
       cout << "-d [--dir] path       directory with config files" << endl;
       cout << "-g                    start with GUI" << endl;
@@ -70,6 +72,7 @@ int main(int argc, char *argv[]){
       cout << "-L logID              add additional <logID> to log output after the timestamp. ex: pxar -L TB1" << endl;
       return 0;
     }
+    if (!strcmp(argv[i],"-A"))                                {doAsyncLog = true; }
     if (!strcmp(argv[i],"-c"))                                {cmdFile    = string(argv[++i]); doRunScript = true;}
     if (!strcmp(argv[i],"-d") || !strcmp(argv[i], "--dir"))   {dir  = string(argv[++i]); }
     if (!strcmp(argv[i],"-f"))                                {doUpdateFlash = true; flashFile = string(argv[++i]);}
@@ -148,6 +151,8 @@ int main(int argc, char *argv[]){
     SetLogOutput::Stream() = lfile;
     SetLogOutput::Duplicate() = true;
   }
+  // If requested, write the log file from a background thread, the DAQ does not wait for the disk:
+  if (doAsyncLog) SetLogOutput::Asynchronous(true);
 
   TDatime today;
   string tstamp = Form("%d/%02d/%02d", today.GetYear(), today.GetMonth(), today.GetDay());
@@ -1986,6 +1986,39 @@ void PixTest::finalCleanup() {
   fPg_setup.clear();
 }
 
+// ----------------------------------------------------------------------
+// -- fills the hits of the events streamed by pxarCore::daqProcessEvents into one map per enabled ROC
+class PixTestHitMapFiller : public eventVisitor {
+public:
+  PixTestHitMapFiller(PixTest *test, vector<TH2D*> &maps): fTest(test), fMaps(maps), fNpix(0) {}
+  void processEvent(Event &evt) {
+    for (unsigned int ipix = 0; ipix < evt.pixels.size(); ++ipix) {
+      int rocIdx = fTest->getIdxFromId(evt.pixels[ipix].roc());
+      if (rocIdx >= 0 && rocIdx < static_cast<int>(fMaps.size())) {
+        fMaps[rocIdx]->Fill(evt.pixels[ipix].column(), evt.pixels[ipix].row());
+        ++fNpix;
+      } else {
+        LOG(logERROR) << "found hit from disabled ROC " << (int)evt.pixels[ipix].roc()
+                      << ", col " << (int)evt.pixels[ipix].column() << " row " << (int)evt.pixels[ipix].row();
+        break;
+      }
+    }
+  }
+  PixTest *fTest;
+  vector<TH2D*> &fMaps;
+  int fNpix;
+};
+
+// ----------------------------------------------------------------------
+int PixTest::fillHitMaps(vector<TH2D*> &maps, int &npix) {
+  PixTestHitMapFiller filler(this, maps);
+  int nevents(0);
+  try { nevents = static_cast<int>(fApi->daqProcessEvents(filler)); }
+  catch(DataNoEvent &) {}
+  npix = filler.fNpix;
+  return nevents;
+}
+
 // ----------------------------------------------------------------------
 void PixTest::resetROC() {
   // -- setup DAQ for data taking
@@ -2109,14 +2142,8 @@ void PixTest::trimHotPixels(int hitThr, int runSeconds, bool maskuntrimmable) {
         LOG(logINFO) << "Buffer almost full, pausing triggers.";
         fApi->daqTriggerLoopHalt();
         t.Stop();
-        vector<Event> daqdat;
-        try { daqdat = fApi->daqGetEventBuffer(); }
-        catch(DataNoEvent &) {}
-        for(vector<Event>::iterator it = daqdat.begin(); it != daqdat.end(); ++it) {
-          for (unsigned int ipix = 0; ipix < it->pixels.size(); ++ipix) {
-            hotpixel_map[getIdxFromId(it->pixels[ipix].roc())]->Fill(it->pixels[ipix].column(), it->pixels[ipix].row());
-          }
-        }
+        int npix(0);
+        fillHitMaps(hotpixel_map, npix);
 
         LOG(logINFO) << "Resuming triggers.";
         t.Start(kFALSE);
@@ -2135,21 +2162,8 @@ void PixTest::trimHotPixels(int hitThr, int runSeconds, bool maskuntrimmable) {
     fApi->daqTriggerLoopHalt();
     fApi->daqStop();
 
-    vector<Event> daqdat;
-    try { daqdat = fApi->daqGetEventBuffer(); }
-    catch(DataNoEvent &) {}
-    for(vector<Event>::iterator it = daqdat.begin(); it != daqdat.end(); ++it) {
-      for (unsigned int ipix = 0; ipix < it->pixels.size(); ++ipix) {
-        int rocIdx = getIdxFromId(it->pixels[ipix].roc());
-        if (rocIdx >= 0 && rocIdx < static_cast<int>(hotpixel_map.size())) {
-          hotpixel_map[rocIdx]->Fill(it->pixels[ipix].column(), it->pixels[ipix].row());
-        } else {
-          LOG(logERROR) << "found hit from disabled ROC " << (int)it->pixels[ipix].roc()
-                        << ", col " << (int)it->pixels[ipix].column() << " row " << (int)it->pixels[ipix].row();
-          break;
-        }
-      }
-    }
+    int npix(0);
+    fillHitMaps(hotpixel_map, npix);
     finalCleanup();
 
     // -- analysis of hit map
@@ -2341,14 +2355,8 @@ void PixTest::maskHotPixels(vector<TH2D*> v) {
       fApi->daqTriggerLoopHalt();
 
       // fillMap(v):
-      vector<Event> daqdat;
-      try { daqdat = fApi->daqGetEventBuffer(); }
-      catch(DataNoEvent &) {}
-      for(vector<Event>::iterator it = daqdat.begin(); it != daqdat.end(); ++it) {
-        for (unsigned int ipix = 0; ipix < it->pixels.size(); ++ipix) {
-          v[getIdxFromId(it->pixels[ipix].roc())]->Fill(it->pixels[ipix].column(), it->pixels[ipix].row());
-        }
-      }
+      int npix(0);
+      fillHitMaps(v, npix);
 
       LOG(logINFO) << "Resuming triggers.";
           fApi->daqTriggerLoop(finalPeriod);
@@ -2365,14 +2373,8 @@ void PixTest::maskHotPixels(vector<TH2D*> v) {
   fApi->daqStop();
 
   // fillMap(v):
-  vector<Event> daqdat;
-  try { daqdat = fApi->daqGetEventBuffer(); }
-  catch(DataNoEvent &) {}
-  for(vector<Event>::iterator it = daqdat.begin(); it != daqdat.end(); ++it) {
-    for (unsigned int ipix = 0; ipix < it->pixels.size(); ++ipix) {
-      v[getIdxFromId(it->pixels[ipix].roc())]->Fill(it->pixels[ipix].column(), it->pixels[ipix].row());
-    }
-  }
+  int npix(0);
+  fillHitMaps(v, npix);
 
   finalCleanup();
 
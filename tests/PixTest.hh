@@ -178,6 +178,8 @@ public:
   /// functions for DAQ
   void finalCleanup();
   void pgToDefault();
+  /// read out the DAQ buffer and fill the hits into the maps (one per enabled ROC) without storing the events. Returns the number of events
+  int fillHitMaps(std::vector<TH2D*> &maps, int &npix);
 
   /// book a TH1D, adding version information to the name and title 
   TH1D* bookTH1D(std::string sname, std::string title, int nbins, double xmin, double xmax); 
@@ -199,7 +199,9 @@ void PixTestDaq::bookHist(string /*name*/) {
 void PixTestDaq::ProcessData(uint16_t numevents){
 
 	LOG(logDEBUG) << "Getting Event Buffer";
-	std::vector<pxar::Event> daqdat;
+	fPixCnt = 0;
+	fBadIdx = false;
+	size_t nevents(0);
 
 	if (numevents > 0) {
 		for (unsigned int i = 0; i < numevents; i++) {
@@ -207,59 +209,23 @@ void PixTestDaq::ProcessData(uint16_t numevents){
 		  try { evt = fApi->daqGetEvent(); }
 		  catch(pxar::DataNoEvent &) {}
 			//Check if event is empty?
-			if (evt.pixels.size() > 0)
-				daqdat.push_back(evt);
+			if (evt.pixels.size() > 0) {
+				ProcessEvent(evt);
+				++nevents;
+			}
 		}
 	}
-	else
-	  try { daqdat = fApi->daqGetEventBuffer(); }
+	else {
+	  // Process the events as they are decoded instead of storing the full buffer:
+	  pxar::eventCallback<PixTestDaq> visitor(this, &PixTestDaq::ProcessEvent);
+	  try { nevents = fApi->daqProcessEvents(visitor); }
 	  catch(pxar::DataNoEvent &) {}
+	}
 
-	LOG(logDEBUG) << "Processing Data: " << daqdat.size() << " events.";
-
-	int pixCnt(0);
-	int idx(-1);
-	uint16_t q;
-	vector<uint8_t> rocIds = fApi->_dut->getEnabledRocIDs();
-	for (std::vector<pxar::Event>::iterator it = daqdat.begin(); it != daqdat.end(); ++it) {
-		pixCnt += it->pixels.size();
-
-		if (fParFillTree) {
-		        bookTree();  
-			fTreeEvent.header = it->getHeader();
-			fTreeEvent.dac = 0;
-			fTreeEvent.trailer = it->getTrailer();
-		}
-
-		for (unsigned int ipix = 0; ipix < it->pixels.size(); ++ipix) {
-			idx = getIdxFromId(it->pixels[ipix].roc());
-			if(idx == -1) {
-				LOG(logWARNING) << "PixTestDaq::ProcessData() wrong 'idx' value --> return";
-				return;    			
-			}
-			fHitMap[idx]->Fill(it->pixels[ipix].column(), it->pixels[ipix].row());
-			fPhmap[idx]->Fill(it->pixels[ipix].column(), it->pixels[ipix].row(), it->pixels[ipix].value());
-			fPh[idx]->Fill(it->pixels[ipix].value());
-
-			if (fPhCalOK) {
-				q = static_cast<uint16_t>(fPhCal.vcal(it->pixels[ipix].roc(), it->pixels[ipix].column(),	
-								      it->pixels[ipix].row(), it->pixels[ipix].value()));
-			}
-			else {
-				q = 0;
-			}
-			fQ[idx]->Fill(q);
-			fQmap[idx]->Fill(it->pixels[ipix].column(), it->pixels[ipix].row(), q);
-				if (fParFillTree && ipix < 20000) {
-				  ++fTreeEvent.npix;
-				  fTreeEvent.proc[ipix] = it->pixels[ipix].roc();
-				  fTreeEvent.pcol[ipix] = it->pixels[ipix].column();
-				  fTreeEvent.prow[ipix] = it->pixels[ipix].row();
-				  fTreeEvent.pval[ipix] = it->pixels[ipix].value();
-				  fTreeEvent.pq[ipix] = q;
-				}
-		}
-		if (fParFillTree) fTree->Fill();
+	LOG(logDEBUG) << "Processing Data: " << nevents << " events.";
+	if (fBadIdx) {
+		LOG(logWARNING) << "PixTestDaq::ProcessData() wrong 'idx' value --> return";
+		return;
 	}
 
   	//to draw the hitsmap as 'online' check.
@@ -269,7 +235,53 @@ void PixTestDaq::ProcessData(uint16_t numevents){
 	PixTest::update();
 
 	LOG(logINFO) << Form("events read:%5ld, pixels seen:%3d, hist entries: %4d",
-		daqdat.size(), pixCnt, static_cast<int>(fHitMap[0]->GetEntries()));
+		nevents, fPixCnt, static_cast<int>(fHitMap[0]->GetEntries()));
+}
+
+// ----------------------------------------------------------------------
+void PixTestDaq::ProcessEvent(pxar::Event &evt){
+
+	if (fBadIdx) return;
+	fPixCnt += evt.pixels.size();
+
+	if (fParFillTree) {
+	        bookTree();  
+		fTreeEvent.header = evt.getHeader();
+		fTreeEvent.dac = 0;
+		fTreeEvent.trailer = evt.getTrailer();
+	}
+
+	int idx(-1);
+	uint16_t q;
+	for (unsigned int ipix = 0; ipix < evt.pixels.size(); ++ipix) {
+		idx = getIdxFromId(evt.pixels[ipix].roc());
+		if(idx == -1) {
+			fBadIdx = true;
+			return;
+		}
+		fHitMap[idx]->Fill(evt.pixels[ipix].column(), evt.pixels[ipix].row());
+		fPhmap[idx]->Fill(evt.pixels[ipix].column(), evt.pixels[ipix].row(), evt.pixels[ipix].value());
+		fPh[idx]->Fill(evt.pixels[ipix].value());
+
+		if (fPhCalOK) {
+			q = static_cast<uint16_t>(fPhCal.vcal(evt.pixels[ipix].roc(), evt.pixels[ipix].column(),	
+							      evt.pixels[ipix].row(), evt.pixels[ipix].value()));
+		}
+		else {
+			q = 0;
+		}
+		fQ[idx]->Fill(q);
+		fQmap[idx]->Fill(evt.pixels[ipix].column(), evt.pixels[ipix].row(), q);
+		if (fParFillTree && ipix < 20000) {
+		  ++fTreeEvent.npix;
+		  fTreeEvent.proc[ipix] = evt.pixels[ipix].roc();
+		  fTreeEvent.pcol[ipix] = evt.pixels[ipix].column();
+		  fTreeEvent.prow[ipix] = evt.pixels[ipix].row();
+		  fTreeEvent.pval[ipix] = evt.pixels[ipix].value();
+		  fTreeEvent.pq[ipix] = q;
+		}
+	}
+	if (fParFillTree) fTree->Fill();
 }
 
 // ----------------------------------------------------------------------
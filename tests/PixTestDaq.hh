@@ -23,6 +23,7 @@ public:
   void runCommand(std::string command);
   virtual bool setParameter(std::string parName, std::string sval);
   void ProcessData(uint16_t numevents = 1000);
+  void ProcessEvent(pxar::Event &evt);
   void doDaqRun();
 
   void doTest();
@@ -42,6 +43,8 @@ private:
   PHCalibration fPhCal;
   bool	   fParOutOfRange;
   bool     fDaq_loop;
+  int      fPixCnt;   //! pixels seen by ProcessEvent
+  bool     fBadIdx;   //! ProcessEvent found a pixel of an unknown ROC
 
   
   std::vector<std::pair<std::string, uint8_t> > fPg_setup;
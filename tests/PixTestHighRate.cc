@@ -874,18 +874,8 @@ void PixTestHighRate::doHitMap(int nseconds, vector<TH2D*> h) {
 void PixTestHighRate::fillMap(vector<TH2D*> hist) {
 
   int pixCnt(0);
-  vector<pxar::Event> daqdat;
-  try { daqdat = fApi->daqGetEventBuffer(); }
-  catch(pxar::DataNoEvent &) {}
-
-  for(std::vector<pxar::Event>::iterator it = daqdat.begin(); it != daqdat.end(); ++it) {
-    pixCnt += it->pixels.size();
-
-    for (unsigned int ipix = 0; ipix < it->pixels.size(); ++ipix) {
-      hist[getIdxFromId(it->pixels[ipix].roc())]->Fill(it->pixels[ipix].column(), it->pixels[ipix].row());
-    }
-  }
-  LOG(logDEBUG) << "Processing Data: " << daqdat.size() << " events with " << pixCnt << " pixels";
+  int evtCnt = fillHitMaps(hist, pixCnt);
+  LOG(logDEBUG) << "Processing Data: " << evtCnt << " events with " << pixCnt << " pixels";
 }
 
 
@@ -256,7 +256,7 @@ void PixTestTrim::trimTest() {
   vector<pair<uint8_t, pair<uint8_t, vector<pixel> > > >  results;
   while (!done) {
     try {
-      results = fApi->getEfficiencyVsDACDAC("vcal", 0, 200, "vtrim", 0, 255, FLAG_FORCE_MASKED, NTRIG);
+      results = fApi->getEfficiencyVsDACDAC("vcal", 0, 200, "vtrim", 0, 255, FLAG_FORCE_MASKED | FLAG_PIPELINED_LOOPS, NTRIG);
       done = true;
     } catch(pxarException &e) {
       LOG(logCRITICAL) << "pXar execption: "<< e.what();
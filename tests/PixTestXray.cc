@@ -678,54 +678,59 @@ int PixTestXray::countHitsAndMaskPixels(TH2D *h2, double noiseLevel, int iroc) {
 // ----------------------------------------------------------------------
 void PixTestXray::readData() {
 
-  int pixCnt(0);  
-  vector<pxar::Event> daqdat;
-  try { daqdat = fApi->daqGetEventBuffer(); }
+  // -- the events are processed one by one as they are decoded, without storing the buffer
+  fPixCnt = 0;
+  size_t evtCnt(0);
+  pxar::eventCallback<PixTestXray> visitor(this, &PixTestXray::readEvent);
+  try { evtCnt = fApi->daqProcessEvents(visitor); }
   catch(pxar::DataNoEvent &) {}
-  
-  for (std::vector<pxar::Event>::iterator it = daqdat.begin(); it != daqdat.end(); ++it) {
-    pixCnt += it->pixels.size();
 
-    if (fParFillTree) {
-      bookTree();  
-      fTreeEvent.header           = it->getHeader(); 
-      fTreeEvent.dac              = 0;
-      fTreeEvent.trailer          = it->getTrailer(); 
-    }
+  LOG(logDEBUG) << "Processing Data: " << evtCnt << " events with " << fPixCnt << " pixels";
+}
 
-    int idx(0); 
-    double q(0.);
-    for (unsigned int ipix = 0; ipix < it->pixels.size(); ++ipix) {   
-      idx = getIdxFromId(it->pixels[ipix].roc());
-      if (fPhCalOK) {
-	q = fPhCal.vcal(it->pixels[ipix].roc(), 
-			it->pixels[ipix].column(), 
-			it->pixels[ipix].row(), 
-			it->pixels[ipix].value());
-      } else {
-	q = 0;
-      }
-      fHitMap[idx]->Fill(it->pixels[ipix].column(), it->pixels[ipix].row());
-      fQ[idx]->Fill(q);
-      fQmap[idx]->Fill(it->pixels[ipix].column(), it->pixels[ipix].row(), q);
 
-      fPHmap[idx]->Fill(it->pixels[ipix].column(), it->pixels[ipix].row(), it->pixels[ipix].value());
-      fPH[idx]->Fill(it->pixels[ipix].value());
+// ----------------------------------------------------------------------
+void PixTestXray::readEvent(pxar::Event &evt) {
+
+  fPixCnt += evt.pixels.size();
+
+  if (fParFillTree) {
+    bookTree();  
+    fTreeEvent.header           = evt.getHeader(); 
+    fTreeEvent.dac              = 0;
+    fTreeEvent.trailer          = evt.getTrailer(); 
+  }
+
+  int idx(0); 
+  double q(0.);
+  for (unsigned int ipix = 0; ipix < evt.pixels.size(); ++ipix) {   
+    idx = getIdxFromId(evt.pixels[ipix].roc());
+    if (fPhCalOK) {
+      q = fPhCal.vcal(evt.pixels[ipix].roc(), 
+		      evt.pixels[ipix].column(), 
+		      evt.pixels[ipix].row(), 
+		      evt.pixels[ipix].value());
+    } else {
+      q = 0;
+    }
+    fHitMap[idx]->Fill(evt.pixels[ipix].column(), evt.pixels[ipix].row());
+    fQ[idx]->Fill(q);
+    fQmap[idx]->Fill(evt.pixels[ipix].column(), evt.pixels[ipix].row(), q);
+
+    fPHmap[idx]->Fill(evt.pixels[ipix].column(), evt.pixels[ipix].row(), evt.pixels[ipix].value());
+    fPH[idx]->Fill(evt.pixels[ipix].value());
 	
-      if (fParFillTree && ipix < 20000) {
-	++fTreeEvent.npix;
-	fTreeEvent.proc[ipix] = it->pixels[ipix].roc(); 
-	fTreeEvent.pcol[ipix] = it->pixels[ipix].column(); 
-	fTreeEvent.prow[ipix] = it->pixels[ipix].row(); 
-	fTreeEvent.pval[ipix] = it->pixels[ipix].value(); 
-	fTreeEvent.pq[ipix]   = q;
-      }
+    if (fParFillTree && ipix < 20000) {
+      ++fTreeEvent.npix;
+      fTreeEvent.proc[ipix] = evt.pixels[ipix].roc(); 
+      fTreeEvent.pcol[ipix] = evt.pixels[ipix].column(); 
+      fTreeEvent.prow[ipix] = evt.pixels[ipix].row(); 
+      fTreeEvent.pval[ipix] = evt.pixels[ipix].value(); 
+      fTreeEvent.pq[ipix]   = q;
     }
-    
-    if (fParFillTree) fTree->Fill();
-    
   }
-  LOG(logDEBUG) << "Processing Data: " << daqdat.size() << " events with " << pixCnt << " pixels";
+    
+  if (fParFillTree) fTree->Fill();
 }
 
 
@@ -30,6 +30,7 @@ public:
   //   void pgToDefault(std::vector<std::pair<std::string, uint8_t> > pg_setup);
 
   void readData();
+  void readEvent(pxar::Event &evt);
   void readDataOld();
   void analyzeData();
 
@@ -61,6 +62,7 @@ private:
   
   int     fVthrComp;
   long int fEventsMax;
+  int     fPixCnt; //! pixels seen by readEvent
 
   std::vector<std::pair<std::string, uint8_t> > fPg_setup;
 
@@ -0,0 +1,818 @@
+// pxar host-side benchmarks
+// Runs the readout and processing chain against the attached (or emulated)
+// testboard and reports the time spent. Intended to be used with the DTB
+// emulator (BUILD_dtbemulator) to measure host CPU time only.
+
+#include "pxar.h"
+#include "timer.h"
+#include "log.h"
+#include "markerscan.h"
+#include "datapipe.h"
+#include <iomanip>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <new>
+
+// Allocation counters for the alloc benchmark. The global operator new is replaced
+// for the whole process, so allocations of the emulated testboard are counted too:
+static std::atomic<size_t> n_allocations(0), n_allocated(0);
+
+// The array forms are replaced as well, and the deallocation is kept out of line:
+// GCC would otherwise see free() inlined on pointers from operator new and warn.
+#if defined(__GNUC__) || defined(__clang__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+void * operator new(size_t size) {
+  n_allocations++;
+  n_allocated += size;
+  void * p = malloc(size ? size : 1);
+  if(!p) throw std::bad_alloc();
+  return p;
+}
+void * operator new[](size_t size) { return operator new(size); }
+BENCH_NOINLINE void operator delete(void * p) noexcept { free(p); }
+BENCH_NOINLINE void operator delete(void * p, size_t) noexcept { free(p); }
+BENCH_NOINLINE void operator delete[](void * p) noexcept { free(p); }
+BENCH_NOINLINE void operator delete[](void * p, size_t) noexcept { free(p); }
+
+// Dump the pixel data of a map to a file for cross-checks between builds:
+void dumpmap(std::string filename, std::vector<pxar::pixel> & data) {
+  if(filename.empty()) return;
+  std::ofstream out(filename.c_str(), std::ios::app);
+  for(std::vector<pxar::pixel>::iterator px = data.begin(); px != data.end(); ++px) {
+    out << static_cast<int>(px->roc()) << " " << static_cast<int>(px->column()) << " " << static_cast<int>(px->row()) << " "
+	<< px->value() << " " << px->variance() << std::endl;
+  }
+}
+
+// Time the full-module calibrate maps, dominated by trigger condensing on the host:
+void bench_condense(uint16_t nTriggers, size_t iterations, std::string dumpfile, uint16_t flags) {
+
+  std::cout << "Benchmark: calibrate maps with " << nTriggers << " triggers, "
+	    << _api->_dut->getNEnabledRocs() << " ROCs, " << iterations << " iterations" << std::endl;
+
+  uint64_t t_eff = 0, t_ph = 0;
+  size_t n_eff = 0, n_ph = 0;
+  for(size_t i = 0; i < iterations; i++) {
+    pxar::timer t;
+    std::vector<pxar::pixel> eff = _api->getEfficiencyMap(flags,nTriggers);
+    t_eff += t.get();
+    n_eff += eff.size();
+    dumpmap(dumpfile,eff);
+
+    pxar::timer t2;
+    std::vector<pxar::pixel> ph = _api->getPulseheightMap(flags,nTriggers);
+    t_ph += t2.get();
+    n_ph += ph.size();
+    dumpmap(dumpfile,ph);
+  }
+
+  std::cout << "  getEfficiencyMap:  " << std::setw(8) << (t_eff/iterations) << " ms/call, "
+	    << (n_eff/iterations) << " pixels" << std::endl;
+  std::cout << "  getPulseheightMap: " << std::setw(8) << (t_ph/iterations) << " ms/call, "
+	    << (n_ph/iterations) << " pixels" << std::endl;
+}
+
+// Time and count the allocations of efficiency maps, from the test loop to the repacked result:
+void bench_alloc(uint16_t nTriggers, size_t iterations, uint16_t flags) {
+
+  std::cout << "Benchmark: allocations of efficiency maps with " << nTriggers << " triggers, "
+	    << _api->_dut->getNEnabledRocs() << " ROCs, " << iterations << " iterations" << std::endl;
+
+  uint64_t t_eff = 0;
+  size_t n_eff = 0, allocs = 0, bytes = 0;
+  for(size_t i = 0; i < iterations; i++) {
+    size_t allocs_start = n_allocations, bytes_start = n_allocated;
+    pxar::timer t;
+    std::vector<pxar::pixel> eff = _api->getEfficiencyMap(flags,nTriggers);
+    t_eff += t.get();
+    allocs += n_allocations - allocs_start;
+    bytes += n_allocated - bytes_start;
+    n_eff += eff.size();
+  }
+
+  std::cout << "  getEfficiencyMap:  " << std::setw(8) << (t_eff/iterations) << " ms/call, "
+	    << (n_eff/iterations) << " pixels" << std::endl;
+  std::cout << "  allocations:       " << std::setw(8) << (allocs/iterations) << " /call, "
+	    << std::fixed << std::setprecision(1) << (bytes/iterations/1048576.) << " MB/call" << std::endl;
+}
+
+// Dump the pixel data of DAC scans to a file for cross-checks between builds:
+void dumpscan(std::string filename, std::vector<std::pair<uint8_t, std::vector<pxar::pixel> > > & data) {
+  if(filename.empty()) return;
+  for(std::vector<std::pair<uint8_t, std::vector<pxar::pixel> > >::iterator it = data.begin(); it != data.end(); ++it) {
+    std::ofstream out(filename.c_str(), std::ios::app);
+    out << "DAC " << static_cast<int>(it->first) << std::endl;
+    out.close();
+    dumpmap(filename,it->second);
+  }
+}
+
+// Time threshold maps and threshold-vs-DAC scans, including the threshold finding on the host:
+void bench_threshold(uint16_t nTriggers, size_t iterations, std::string dumpfile, uint16_t flags) {
+
+  std::cout << "Benchmark: threshold scans with " << nTriggers << " triggers, "
+	    << _api->_dut->getNEnabledRocs() << " ROCs, " << iterations << " iterations" << std::endl;
+
+  uint64_t t_rising = 0, t_falling = 0, t_vsdac = 0;
+  for(size_t i = 0; i < iterations; i++) {
+    pxar::timer t;
+    std::vector<pxar::pixel> rising = _api->getThresholdMap("vcal",1,0,140,flags | FLAG_RISING_EDGE,nTriggers);
+    t_rising += t.get();
+    dumpmap(dumpfile,rising);
+
+    pxar::timer t2;
+    std::vector<pxar::pixel> falling = _api->getThresholdMap("vcal",1,0,140,flags,nTriggers);
+    t_falling += t2.get();
+    dumpmap(dumpfile,falling);
+  }
+
+  // Threshold vs. DAC on a reduced set of pixels:
+  _api->_dut->testAllPixels(false);
+  for(uint8_t col = 0; col < 52; col += 13) { _api->_dut->testPixel(col,col/2,true); }
+  for(size_t i = 0; i < iterations; i++) {
+    pxar::timer t;
+    std::vector<std::pair<uint8_t, std::vector<pxar::pixel> > > vsdac = _api->getThresholdVsDAC("vcal",1,0,60,"caldel",1,0,60,flags | FLAG_RISING_EDGE,nTriggers);
+    t_vsdac += t.get();
+    dumpscan(dumpfile,vsdac);
+  }
+  _api->_dut->testAllPixels(true);
+
+  std::cout << "  getThresholdMap (rising):  " << std::setw(8) << (t_rising/iterations) << " ms/call" << std::endl;
+  std::cout << "  getThresholdMap (falling): " << std::setw(8) << (t_falling/iterations) << " ms/call" << std::endl;
+  std::cout << "  getThresholdVsDAC:         " << std::setw(8) << (t_vsdac/iterations) << " ms/call" << std::endl;
+}
+
+// Count the words matching one of the markers, searching word by word as the splitter used to:
+size_t count_scalar(std::vector<uint16_t> & stream, uint16_t mask1, uint16_t value1, uint16_t mask2, uint16_t value2) {
+  size_t n = 0;
+  std::vector<uint16_t>::iterator w = stream.begin();
+  while(true) {
+    while(w != stream.end() && ((*w) & mask1) != value1 && ((*w) & mask2) != value2) { ++w; }
+    if(w == stream.end()) break;
+    n++; ++w;
+  }
+  return n;
+}
+
+// Count the words matching one of the markers using the marker scanner as the splitter does:
+size_t count_markers(std::vector<uint16_t> & stream, uint16_t mask1, uint16_t value1, uint16_t mask2, uint16_t value2) {
+  size_t n = 0;
+  pxar::markerScanner scanner;
+  scanner.SetMarkers(mask1,value1,mask2,value2);
+  uint16_t * last = &stream[0] + stream.size();
+  for(uint16_t * w = scanner.Find(&stream[0],last); w != last; w = scanner.Find(w+1,last)) { n++; }
+  return n;
+}
+
+// Time the marker scanning kernels against the scalar loop on a recorded or emulator-generated stream:
+void bench_markers(uint16_t nTriggers, size_t iterations, std::string datafile) {
+
+  std::vector<uint16_t> stream;
+  if(!datafile.empty()) {
+    // Raw DTB data as written by pxardaq:
+    std::ifstream in(datafile.c_str(), std::ios::in | std::ios::binary);
+    uint16_t word;
+    while(in.read(reinterpret_cast<char*>(&word), sizeof(word))) { stream.push_back(word); }
+  }
+  else {
+    _api->daqStart();
+    _api->daqTrigger(nTriggers);
+    _api->daqStop();
+    stream = _api->daqGetBuffer();
+  }
+  if(stream.empty()) {
+    std::cout << "No data to scan." << std::endl;
+    return;
+  }
+
+  // Repeat the scans to get at least some 10^8 words per measurement:
+  size_t repeat = iterations*(100000000/stream.size() + 1);
+  std::cout << "Benchmark: marker scanning on " << stream.size() << " words ("
+	    << (datafile.empty() ? "emulator" : datafile) << "), " << repeat << " repetitions" << std::endl;
+
+  // Markers as used by the event splitters for DESER400 and DESER160 data:
+  const char * names[2] = { "DESER400", "DESER160" };
+  uint16_t markers[2][4] = { { 0xe000, 0xc000, 0xe000, 0xa000 }, { 0x8000, 0x8000, 0x4000, 0x4000 } };
+
+  pxar::markerKernel kernels[3] = { pxar::MARKER_SCALAR, pxar::MARKER_SSE2, pxar::MARKER_AVX2 };
+  pxar::markerKernel current = pxar::getMarkerKernel();
+
+  for(size_t m = 0; m < 2; m++) {
+    size_t expected = 0;
+    pxar::timer t;
+    for(size_t i = 0; i < repeat; i++) { expected = count_scalar(stream,markers[m][0],markers[m][1],markers[m][2],markers[m][3]); }
+    uint64_t t_loop = t.get();
+    std::cout << "  " << names[m] << " word loop:   " << std::setw(10) << (t_loop > 0 ? stream.size()*repeat/t_loop/1000 : 0)
+	      << " Mwords/s, " << expected << " markers" << std::endl;
+
+    for(size_t k = 0; k < 3; k++) {
+      if(!pxar::setMarkerKernel(kernels[k])) {
+	std::cout << "  " << names[m] << " " << std::setw(11) << std::left << pxar::getMarkerKernelName(kernels[k]) << std::right
+		  << " not supported by this CPU" << std::endl;
+	continue;
+      }
+      size_t found = 0;
+      pxar::timer t2;
+      for(size_t i = 0; i < repeat; i++) { found = count_markers(stream,markers[m][0],markers[m][1],markers[m][2],markers[m][3]); }
+      uint64_t t_kernel = t2.get();
+      std::cout << "  " << names[m] << " " << std::setw(11) << std::left << pxar::getMarkerKernelName(kernels[k]) << std::right << " "
+		<< std::setw(10) << (t_kernel > 0 ? stream.size()*repeat/t_kernel/1000 : 0)
+		<< " Mwords/s, " << found << " markers" << (found != expected ? " MISMATCH" : "") << std::endl;
+    }
+  }
+  pxar::setMarkerKernel(current);
+}
+
+// Fills the hits of the streamed events into a flat (roc, column, row) hit map:
+class hitMapFiller : public pxar::eventVisitor {
+public:
+  hitMapFiller(std::vector<uint32_t> & map) : hits(map), pixels(0) {}
+  void processEvent(pxar::Event & evt) {
+    for(std::vector<pxar::pixel>::iterator px = evt.pixels.begin(); px != evt.pixels.end(); ++px) {
+      hits[(px->roc()*ROC_NUMCOLS + px->column())*ROC_NUMROWS + px->row()]++;
+    }
+    pixels += evt.pixels.size();
+  }
+  std::vector<uint32_t> & hits;
+  size_t pixels;
+};
+
+// Time reading back the event buffer of a DAQ run and filling a hit map from it: with and
+// without prefetching of DTB data, streaming the events instead of storing them, and reading
+// them into a reused event batch:
+void bench_daq(uint16_t nTriggers, size_t iterations) {
+
+  std::cout << "Benchmark: DAQ readout of " << nTriggers << " triggers, "
+	    << _api->_dut->getNEnabledRocs() << " ROCs, " << iterations << " iterations" << std::endl;
+
+  const char * names[] = {"daqGetEventBuffer:           ", "daqGetEventBuffer (prefetch):", "daqProcessEvents:            ", "daqGetEventBatch:            ", "daqProcessEvents (parallel): "};
+  pxar::eventBatch batch;
+  for(size_t variant = 0; variant < 5; variant++) {
+    std::vector<uint32_t> hits(MOD_NUMROCS*ROC_NUMCOLS*ROC_NUMROWS);
+    uint64_t t_read = 0;
+    size_t n_events = 0, n_pixels = 0;
+    for(size_t i = 0; i < iterations; i++) {
+      _api->daqStart(variant == 1 ? FLAG_DAQ_PREFETCH : (variant == 4 ? FLAG_PARALLEL_DECODING : 0));
+      _api->daqTrigger(nTriggers,1000);
+      pxar::timer t;
+      if(variant == 2 || variant == 4) {
+	hitMapFiller filler(hits);
+	n_events += _api->daqProcessEvents(filler);
+	n_pixels += filler.pixels;
+      }
+      else if(variant == 3) {
+	n_events += _api->daqGetEventBatch(batch);
+	for(size_t px = 0; px < batch.pixelCount(); px++) {
+	  hits[(batch.roc(px)*ROC_NUMCOLS + batch.column(px))*ROC_NUMROWS + batch.row(px)]++;
+	}
+	n_pixels += batch.pixelCount();
+      }
+      else {
+	std::vector<pxar::Event> events = _api->daqGetEventBuffer();
+	hitMapFiller filler(hits);
+	for(std::vector<pxar::Event>::iterator evt = events.begin(); evt != events.end(); ++evt) { filler.processEvent(*evt); }
+	n_events += events.size();
+	n_pixels += filler.pixels;
+      }
+      t_read += t.get();
+      _api->daqStop();
+    }
+
+    // Checksum of the hit map to compare the variants:
+    uint64_t checksum = 0;
+    for(size_t h = 0; h < hits.size(); h++) { checksum += static_cast<uint64_t>(hits[h])*(h+1); }
+    std::cout << "  " << names[variant] << std::setw(8) << (t_read/iterations) << " ms/call, "
+	      << (n_events/iterations) << " events, " << (n_pixels/iterations) << " pixels, hit map checksum " << checksum << std::endl;
+  }
+}
+
+// Time the event readout while a second thread polls the live statistics every
+// millisecond. The readout time should not change, and the final live numbers have to
+// agree with the statistics fetched destructively afterwards:
+void bench_live(uint16_t nTriggers, size_t iterations) {
+
+  std::cout << "Benchmark: live statistics during readout of " << nTriggers << " triggers, "
+	    << _api->_dut->getNEnabledRocs() << " ROCs, " << iterations << " iterations" << std::endl;
+
+  const char * names[] = {"without polling:", "with polling:   "};
+  for(size_t variant = 0; variant < 2; variant++) {
+    uint64_t t_read = 0;
+    size_t n_polls = 0, n_events = 0;
+    bool consistent = true;
+    for(size_t i = 0; i < iterations; i++) {
+      _api->daqStart();
+      _api->daqTrigger(nTriggers,1000);
+      uint8_t perFull;
+      _api->daqStatus(perFull);
+
+      std::atomic<bool> reading(true);
+      std::thread poller;
+      if(variant == 1) {
+	poller = std::thread([&]() {
+	    while(reading) {
+	      _api->getLiveStatistics();
+	      n_polls++;
+	      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	    }
+	  });
+      }
+      pxar::timer t;
+      n_events += _api->daqGetEventBuffer().size();
+      t_read += t.get();
+      reading = false;
+      if(poller.joinable()) { poller.join(); }
+
+      pxar::statistics live, total = _api->getStatistics();
+      std::vector<pxar::statistics> channels = _api->getLiveStatistics();
+      for(size_t ch = 0; ch < channels.size(); ch++) { live += channels.at(ch); }
+      if(live.info_words_read() != total.info_words_read() || live.info_events_total() != total.info_events_total()
+	 || live.errors() != total.errors() || live.info_buffer_fill_max() != perFull) { consistent = false; }
+      if(i == 0 && variant == 1) {
+	std::cout << "  live rates: " << std::fixed << std::setprecision(0) << live.rate_words_read() << " words/s, "
+		  << live.rate_events() << " events/s, " << live.rate_errors() << " errors/s, max. buffer fill "
+		  << static_cast<int>(live.info_buffer_fill_max()) << "%" << std::endl;
+      }
+      _api->daqStop();
+    }
+
+    std::cout << "  " << names[variant] << std::setw(8) << (t_read/iterations) << " ms/call, "
+	      << (n_events/iterations) << " events, " << (n_polls/iterations) << " polls, live statistics "
+	      << (consistent ? "consistent" : "INCONSISTENT") << std::endl;
+  }
+}
+
+// Time the logging of messages to a file, written directly by the logging thread
+// and queued for the background writer. The file has to contain all messages:
+void bench_log(size_t iterations) {
+
+  const size_t nMessages = 100000;
+  std::cout << "Benchmark: logging of " << nMessages << " messages to a file, " << iterations << " iterations" << std::endl;
+
+  pxar::TLogLevel level = pxar::Log::ReportingLevel();
+  FILE * stream = pxar::SetLogOutput::Stream();
+  bool duplicate = pxar::SetLogOutput::Duplicate();
+  pxar::Log::ReportingLevel() = pxar::logINFO;
+  pxar::SetLogOutput::Duplicate() = false;
+
+  const char * names[] = {"synchronous: ", "asynchronous:"};
+  for(size_t variant = 0; variant < 2; variant++) {
+    pxar::SetLogOutput::Asynchronous(variant == 1);
+    uint64_t t_log = 0, t_flush = 0;
+    size_t n_lines = 0;
+    for(size_t i = 0; i < iterations; i++) {
+      FILE * logfile = tmpfile();
+      pxar::SetLogOutput::Stream() = logfile;
+      pxar::timer t;
+      for(size_t m = 0; m < nMessages; m++) { LOG(pxar::logINFO) << "Processed event " << m << " of channel " << (m%8); }
+      t_log += t.get();
+      pxar::timer tf;
+      pxar::SetLogOutput::Flush();
+      t_flush += tf.get();
+
+      rewind(logfile);
+      int c;
+      while((c = fgetc(logfile)) != EOF) { if(c == '\n') n_lines++; }
+      fclose(logfile);
+    }
+    pxar::SetLogOutput::Stream() = stream;
+    std::cout << "  " << names[variant] << std::setw(8) << std::fixed << std::setprecision(0) << (1.e6*t_log/iterations/nMessages) << " ns/message, flush "
+	      << (t_flush/iterations) << " ms, " << (n_lines/iterations) << " lines written" << std::endl;
+  }
+  pxar::SetLogOutput::Asynchronous(false);
+  pxar::SetLogOutput::Duplicate() = duplicate;
+  pxar::Log::ReportingLevel() = level;
+}
+
+// Time the raw event readout, the checksum over all data words has to agree between runs:
+void bench_raw(uint16_t nTriggers, size_t iterations) {
+
+  std::cout << "Benchmark: raw event readout of " << nTriggers << " triggers, "
+	    << _api->_dut->getNEnabledRocs() << " ROCs, " << iterations << " iterations" << std::endl;
+
+  uint64_t t_read = 0, checksum = 0;
+  size_t n_events = 0, n_words = 0;
+  for(size_t i = 0; i < iterations; i++) {
+    _api->daqStart();
+    _api->daqTrigger(nTriggers,1000);
+    pxar::timer t;
+    std::vector<pxar::rawEvent> events = _api->daqGetRawEventBuffer();
+    t_read += t.get();
+    for(std::vector<pxar::rawEvent>::iterator evt = events.begin(); evt != events.end(); ++evt) {
+      for(size_t w = 0; w < evt->GetSize(); w++) { checksum += static_cast<uint64_t>((*evt)[w])*(w+1); }
+      n_words += evt->GetSize();
+    }
+    n_events += events.size();
+    _api->daqStop();
+  }
+
+  std::cout << "  daqGetRawEventBuffer: " << std::setw(8) << (t_read/iterations) << " ms/call, "
+	    << (n_events/iterations) << " events, " << (n_words/iterations) << " words, checksum " << checksum << std::endl;
+}
+
+// Time the data generation of the DTB emulator, i.e. the rate at which it can feed the decoder:
+void bench_emulator(uint16_t nTriggers, size_t iterations) {
+
+  std::cout << "Benchmark: emulator data generation for " << nTriggers << " triggers, "
+	    << _api->_dut->getNEnabledRocs() << " ROCs, " << iterations << " iterations" << std::endl;
+
+  uint64_t t_gen = 0;
+  size_t n_words = 0;
+  for(size_t i = 0; i < iterations; i++) {
+    _api->daqStart();
+    pxar::timer t;
+    _api->daqTrigger(nTriggers,1000);
+    t_gen += t.get();
+    std::vector<pxar::rawEvent> events = _api->daqGetRawEventBuffer();
+    for(std::vector<pxar::rawEvent>::iterator evt = events.begin(); evt != events.end(); ++evt) { n_words += evt->GetSize(); }
+    _api->daqStop();
+  }
+
+  std::cout << "  daqTrigger: " << std::setw(8) << (t_gen/iterations) << " ms/call, " << (n_words/iterations) << " words, "
+	    << std::fixed << std::setprecision(1) << (t_gen ? 2.*n_words/t_gen/1000. : 0.) << " MB/s" << std::endl;
+}
+
+// Time the pixel decoding from raw data with exceptions against the status code decoding,
+// for the PSI46dig, inverted and linear address encodings. Both have to agree on every hit:
+void bench_pixels(size_t iterations) {
+
+  // Spread the samples over the full 24bit raw pixel range:
+  std::vector<uint32_t> raw(1 << 20);
+  for(size_t i = 0; i < raw.size(); i++) { raw[i] = static_cast<uint32_t>(i*2654435761u) & 0xffffff; }
+
+  std::cout << "Benchmark: decoding of " << raw.size() << " raw pixel hits, " << iterations << " iterations" << std::endl;
+
+  const char * names[] = {"PSI46dig:", "inverted:", "linear:  "};
+  for(size_t variant = 0; variant < 3; variant++) {
+    bool invert = (variant == 1), linear = (variant == 2);
+    uint64_t t_throw = 0, t_status = 0;
+    size_t n_errors[4] = {0, 0, 0, 0}, n_mismatch = 0;
+
+    for(size_t i = 0; i < iterations; i++) {
+      std::vector<pxar::pixel> thrown, decoded;
+      thrown.reserve(raw.size());
+      decoded.reserve(raw.size());
+
+      pxar::timer t;
+      for(size_t h = 0; h < raw.size(); h++) {
+	try { thrown.push_back(pxar::pixel(raw[h],0,invert,linear)); }
+	catch(pxar::DataInvalidAddressError &) {}
+	catch(pxar::DataInvalidPulseheightError &) {}
+	catch(pxar::DataCorruptBufferError &) {}
+      }
+      t_throw += t.get();
+
+      pxar::timer t2;
+      for(size_t h = 0; h < raw.size(); h++) {
+	pxar::pixel pix;
+	pxar::pixel::decodeStatus status = pix.decode(raw[h],0,invert,linear);
+	if(status == pxar::pixel::DECODE_OK) { decoded.push_back(pix); }
+	n_errors[status]++;
+      }
+      t_status += t2.get();
+
+      if(thrown.size() != decoded.size()) { n_mismatch++; }
+      else {
+	for(size_t h = 0; h < thrown.size(); h++) {
+	  if(!(thrown[h] == decoded[h]) || thrown[h].value() != decoded[h].value()) { n_mismatch++; }
+	}
+      }
+    }
+
+    std::cout << "  " << names[variant] << " exceptions " << std::setw(6) << (t_throw/iterations) << " ms, status codes "
+	      << std::setw(6) << (t_status/iterations) << " ms, " << (n_errors[0]/iterations) << " valid, "
+	      << (n_errors[1]/iterations) << " pulse height, " << (n_errors[2]/iterations) << " address, "
+	      << (n_errors[3]/iterations) << " corrupt buffer, " << n_mismatch << " mismatches" << std::endl;
+  }
+}
+
+// In-memory data source handing out a recorded stream in blocks as read from the DTB:
+class memorySource : public pxar::dataSource<uint16_t> {
+  std::vector<uint16_t> & data;
+  size_t pos;
+  uint16_t lastSample;
+  uint8_t chainlength, envelopetype, devicetype;
+  uint16_t flags;
+
+  uint16_t Read() {
+    if(pos >= data.size()) throw pxar::dsBufferEmpty();
+    return (lastSample = data[pos++]);
+  }
+  uint16_t ReadLast() { return lastSample; }
+  void ReadBlock(uint16_t *&first, uint16_t *&last) {
+    if(pos >= data.size()) throw pxar::dsBufferEmpty();
+    size_t n = std::min(data.size() - pos, static_cast<size_t>(32768));
+    first = &data[pos];
+    last = first + n;
+    pos += n;
+  }
+  uint8_t ReadChannel() { return 0; }
+  uint16_t ReadFlags() { return flags; }
+  uint8_t ReadTokenChainLength() { return chainlength; }
+  uint8_t ReadTokenChainOffset() { return 0; }
+  uint8_t ReadEnvelopeType() { return envelopetype; }
+  uint8_t ReadDeviceType() { return devicetype; }
+public:
+  memorySource(std::vector<uint16_t> & stream, uint8_t tokenChainLength, uint8_t tbmtype, uint16_t daqflags = FLAG_DISABLE_EVENTID_CHECK, uint8_t roctype = ROC_PSI46DIGV21RESPIN) :
+  data(stream), pos(0), lastSample(0), chainlength(tokenChainLength), envelopetype(tbmtype), devicetype(roctype), flags(daqflags) {}
+  void Rewind() { pos = 0; }
+};
+
+// Time splitting and decoding of an emulator data stream through the data pipe. The
+// channels of the stream are concatenated and decoded as one channel:
+void bench_decode(uint16_t nTriggers, size_t iterations, std::string tbmtype) {
+
+  _api->daqStart();
+  _api->daqTrigger(nTriggers);
+  _api->daqStop();
+  std::vector<uint16_t> stream = _api->daqGetBuffer();
+
+  size_t nrocs = _api->_dut->getNEnabledRocs();
+  uint8_t envelope = TBM_NONE;
+  size_t channels = 1;
+  if(nrocs > 1) {
+    if(tbmtype == "tbm09c") { envelope = TBM_09C; channels = 4; }
+    else if(tbmtype == "tbm10c") { envelope = TBM_10C; channels = 4; }
+    else { envelope = TBM_08B; channels = 2; }
+  }
+
+  // Repeat the decoding to get at least some 10^7 words per measurement:
+  size_t repeat = iterations*(10000000/(stream.size() + 1) + 1);
+  // The log statements of the decoder are only present up to the compiled in level,
+  // compare builds with -DLOG_LEVEL_MAX=INTERFACE (default) and e.g. INFO:
+  std::cout << "Benchmark: decoding of " << stream.size() << " words, " << nrocs << " ROCs, "
+	    << repeat << " repetitions, log levels compiled in up to "
+	    << pxar::Log::ToString(pxar::LogLevelCompiled()) << std::endl;
+
+  // Decode without and with the ring buffer for dumping flawed events:
+  const char * names[] = {"split and decode:            ", "with FLAG_DUMP_FLAWED_EVENTS:"};
+  for(size_t variant = 0; variant < 2; variant++) {
+    memorySource src(stream, static_cast<uint8_t>(nrocs/channels), envelope,
+		     FLAG_DISABLE_EVENTID_CHECK | (variant == 1 ? FLAG_DUMP_FLAWED_EVENTS : 0));
+    pxar::dtbEventSplitter splitter;
+    pxar::dtbEventDecoder decoder;
+    pxar::dataSink<pxar::Event*> pump;
+    src >> splitter >> decoder >> pump;
+
+    size_t n_events = 0, n_pixels = 0;
+    pxar::timer t;
+    for(size_t i = 0; i < repeat; i++) {
+      src.Rewind();
+      splitter.Clear();
+      decoder.Clear();
+      try { while(1) { n_pixels += pump.Get()->pixels.size(); n_events++; } }
+      catch(pxar::dsBufferEmpty &) {}
+    }
+    uint64_t t_decode = t.get();
+    std::cout << "  " << names[variant] << " " << std::fixed << std::setprecision(2) << std::setw(8)
+	      << (1e6*t_decode/(stream.size()*repeat)) << " ns/word, " << (n_events/repeat) << " events, "
+	      << (n_pixels/repeat) << " pixels" << std::endl;
+  }
+}
+
+// Time splitting and decoding of analog ROC data. The stream is synthesized with ultrablack
+// at -400 and black at 0 ADC counts, every ROC reporting a header and two hits per trigger:
+void bench_analog(uint16_t nTriggers, size_t iterations, size_t nrocs) {
+
+  std::vector<uint16_t> stream;
+  uint32_t random = 1;
+  for(size_t trg = 0; trg < nTriggers; trg++) {
+    size_t start = stream.size();
+    for(size_t roc = 0; roc < nrocs; roc++) {
+      // ROC header: ultrablack, black and last DAC:
+      stream.push_back(static_cast<uint16_t>(-400 + static_cast<int>(random%9)) & 0x0fff);
+      stream.push_back(static_cast<uint16_t>(random%7) & 0x0fff);
+      stream.push_back(0x0123);
+      for(size_t hit = 0; hit < 2; hit++) {
+	random = random*1103515245 + 12345;
+	size_t col = (random >> 8)%ROC_NUMCOLS, row = (random >> 16)%ROC_NUMROWS;
+	// Address levels of the double column and the pixel within, level k sits at (k-1)*100:
+	int r = 2*(ROC_NUMROWS - row) + (col%2);
+	int levels[5] = {static_cast<int>(col/2/6), static_cast<int>(col/2%6), r/36, r%36/6, r%6};
+	for(size_t l = 0; l < 5; l++) { stream.push_back(static_cast<uint16_t>((levels[l]-1)*100 + static_cast<int>(random%11) - 5) & 0x0fff); }
+	// Pulse height:
+	stream.push_back(static_cast<uint16_t>(50 + (random >> 24)%200));
+      }
+    }
+    // Event start and end markers:
+    stream.at(start) |= 0x8000;
+    stream.back() |= 0x4000;
+  }
+
+  memorySource src(stream, static_cast<uint8_t>(nrocs), TBM_NONE, FLAG_DISABLE_EVENTID_CHECK, ROC_PSI46V2);
+  pxar::dtbEventSplitter splitter;
+  pxar::dtbEventDecoder decoder;
+  pxar::dataSink<pxar::Event*> pump;
+  src >> splitter >> decoder >> pump;
+
+  // Repeat the decoding to get at least some 10^7 words per measurement:
+  size_t repeat = iterations*(10000000/(stream.size() + 1) + 1);
+  std::cout << "Benchmark: analog decoding of " << stream.size() << " words, " << nrocs << " ROCs, "
+	    << repeat << " repetitions" << std::endl;
+
+  size_t n_events = 0, n_pixels = 0;
+  uint64_t checksum = 0;
+  pxar::timer t;
+  for(size_t i = 0; i < repeat; i++) {
+    src.Rewind();
+    splitter.Clear();
+    try {
+      while(1) {
+	pxar::Event * evt = pump.Get();
+	for(std::vector<pxar::pixel>::iterator px = evt->pixels.begin(); px != evt->pixels.end(); ++px) {
+	  checksum += (px->roc()*ROC_NUMCOLS + px->column())*ROC_NUMROWS + px->row() + static_cast<uint64_t>(px->value());
+	}
+	n_pixels += evt->pixels.size();
+	n_events++;
+      }
+    }
+    catch(pxar::dsBufferEmpty &) {}
+  }
+  uint64_t t_decode = t.get();
+  std::cout << "  split and decode: " << std::fixed << std::setprecision(2) << std::setw(8)
+	    << (1e6*t_decode/(stream.size()*repeat)) << " ns/word, " << (n_events/repeat) << " events, "
+	    << (n_pixels/repeat) << " pixels, checksum " << checksum << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+
+  std::string verbosity = "WARNING", mode = "condense", dumpfile, datafile, tbmtype = "tbm08b";
+  uint16_t triggers = 10;
+  size_t iterations = 3;
+  size_t nrocs = 16;
+  uint16_t flags = 0;
+
+  // Quick and hacky cli arguments reading:
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i],"-h")) {
+      std::cout << "Help:" << std::endl;
+      std::cout << "-m mode        benchmark to run, default condense" << std::endl;
+      std::cout << "                 condense: calibrate maps (trigger condensing)" << std::endl;
+      std::cout << "                 threshold: threshold maps and threshold vs. DAC scans" << std::endl;
+      std::cout << "                 alloc: time and heap allocations per efficiency map" << std::endl;
+      std::cout << "                 markers: marker scanning kernels on a raw data stream" << std::endl;
+      std::cout << "                 daq: event readout into a hit map, as buffer, prefetched, streamed, batched and decoded in parallel" << std::endl;
+      std::cout << "                 raw: raw event readout without decoding" << std::endl;
+      std::cout << "                 live: event readout while polling the live statistics" << std::endl;
+      std::cout << "                 log: message logging to a file, synchronous and asynchronous" << std::endl;
+      std::cout << "                 emulator: data generation rate of the DTB emulator" << std::endl;
+      std::cout << "                 pixels: raw pixel decoding with exceptions and with status codes" << std::endl;
+      std::cout << "                 decode: splitting and decoding of a raw data stream" << std::endl;
+      std::cout << "                 analog: splitting and decoding of analog ROC data" << std::endl;
+      std::cout << "-r rocs        number of ROCs in the emulated DUT, default 16" << std::endl;
+      std::cout << "-t tbmtype     TBM type of the emulated module, default tbm08b" << std::endl;
+      std::cout << "-n triggers    number of triggers per pixel, default 10" << std::endl;
+      std::cout << "-i iterations  number of repetitions, default 3" << std::endl;
+      std::cout << "-d filename    dump the resulting pixel data to file" << std::endl;
+      std::cout << "-p             run the test loops pipelined (FLAG_PIPELINED_LOOPS)" << std::endl;
+      std::cout << "-f filename    raw data file (pxardaq) for the markers benchmark, default emulator data" << std::endl;
+      std::cout << "-v verbosity   verbosity level, default WARNING" << std::endl;
+      return 0;
+    }
+    else if (!strcmp(argv[i],"-m")) { mode = std::string(argv[++i]); }
+    else if (!strcmp(argv[i],"-r")) { nrocs = atoi(argv[++i]); }
+    else if (!strcmp(argv[i],"-t")) { tbmtype = std::string(argv[++i]); }
+    else if (!strcmp(argv[i],"-n")) { triggers = atoi(argv[++i]); }
+    else if (!strcmp(argv[i],"-i")) { iterations = atoi(argv[++i]); }
+    else if (!strcmp(argv[i],"-d")) { dumpfile = std::string(argv[++i]); }
+    else if (!strcmp(argv[i],"-p")) { flags |= FLAG_PIPELINED_LOOPS; }
+    else if (!strcmp(argv[i],"-f")) { datafile = std::string(argv[++i]); }
+    else if (!strcmp(argv[i],"-v")) { verbosity = std::string(argv[++i]); }
+    else {
+      std::cout << "Unrecognized command line option " << argv[i] << std::endl;
+    }
+  }
+
+  // Prepare some vectors for all the configurations we use:
+  std::vector<std::pair<std::string,uint8_t> > sig_delays;
+  std::vector<std::pair<std::string,double> > power_settings;
+  std::vector<std::pair<std::string,uint8_t> > pg_setup;
+
+  sig_delays.push_back(std::make_pair("clk",2));
+  sig_delays.push_back(std::make_pair("ctr",2));
+  sig_delays.push_back(std::make_pair("sda",17));
+  sig_delays.push_back(std::make_pair("tin",7));
+  sig_delays.push_back(std::make_pair("deser160phase",4));
+
+  power_settings.push_back(std::make_pair("va",1.9));
+  power_settings.push_back(std::make_pair("vd",2.6));
+  power_settings.push_back(std::make_pair("ia",1.190));
+  power_settings.push_back(std::make_pair("id",1.10));
+
+  std::vector<std::vector<std::pair<std::string,uint8_t> > > tbmDACs;
+  std::vector<std::vector<std::pair<std::string,uint8_t> > > rocDACs;
+  std::vector<std::pair<std::string,uint8_t> > dacs;
+  dacs.push_back(std::make_pair("Vdig",7));
+  dacs.push_back(std::make_pair("Vana",84));
+  dacs.push_back(std::make_pair("Vsf",30));
+  dacs.push_back(std::make_pair("Vcomp",12));
+  dacs.push_back(std::make_pair("VwllPr",60));
+  dacs.push_back(std::make_pair("VwllSh",60));
+  dacs.push_back(std::make_pair("VhldDel",230));
+  dacs.push_back(std::make_pair("Vtrim",29));
+  dacs.push_back(std::make_pair("VthrComp",86));
+  dacs.push_back(std::make_pair("VIBias_Bus",1));
+  dacs.push_back(std::make_pair("Vbias_sf",6));
+  dacs.push_back(std::make_pair("VoffsetOp",40));
+  dacs.push_back(std::make_pair("VOffsetRO",129));
+  dacs.push_back(std::make_pair("VIon",120));
+  dacs.push_back(std::make_pair("Vcomp_ADC",100));
+  dacs.push_back(std::make_pair("VIref_ADC",91));
+  dacs.push_back(std::make_pair("VIbias_roc",150));
+  dacs.push_back(std::make_pair("VIColOr",50));
+  dacs.push_back(std::make_pair("Vcal",220));
+  dacs.push_back(std::make_pair("CalDel",122));
+  dacs.push_back(std::make_pair("CtrlReg",4));
+  dacs.push_back(std::make_pair("WBC",100));
+
+  std::vector<std::vector<pxar::pixelConfig> > rocPixels;
+  std::vector<pxar::pixelConfig> pixels;
+  for(int col = 0; col < 52; col++) {
+    for(int row = 0; row < 80; row++) {
+      pixels.push_back(pxar::pixelConfig(col,row,15));
+    }
+  }
+
+  if(nrocs > 1) {
+    // Module setup with one TBM:
+    pg_setup.push_back(std::make_pair("resettbm",15));
+    pg_setup.push_back(std::make_pair("calibrate",106));
+    pg_setup.push_back(std::make_pair("trigger;sync",0));
+
+    std::vector<std::pair<std::string,uint8_t> > regs;
+    regs.push_back(std::make_pair("clear",0xF0));
+    regs.push_back(std::make_pair("counters",0x01));
+    regs.push_back(std::make_pair("mode",0xC0));
+    regs.push_back(std::make_pair("pkam_set",0x10));
+    regs.push_back(std::make_pair("delays",0x00));
+    regs.push_back(std::make_pair("temperature",0x00));
+    tbmDACs.push_back(regs);
+    tbmDACs.push_back(regs);
+  }
+  else {
+    pg_setup.push_back(std::make_pair("resetroc",25));
+    pg_setup.push_back(std::make_pair("calibrate",106));
+    pg_setup.push_back(std::make_pair("trigger",16));
+    pg_setup.push_back(std::make_pair("token",0));
+  }
+
+  for(size_t i = 0; i < nrocs; i++) {
+    rocDACs.push_back(dacs);
+    rocPixels.push_back(pixels);
+  }
+
+  try {
+    _api = new pxar::pxarCore("*",verbosity);
+
+    if(!_api->initTestboard(sig_delays, power_settings, pg_setup)) {
+      delete _api;
+      return -1;
+    }
+
+    if(!_api->initDUT(31,(nrocs > 1 ? tbmtype : "notbm"),tbmDACs,"psi46digv21respin",rocDACs,rocPixels)) {
+      std::cout << " initDUT failed -> invalid configuration?! " << std::endl;
+      delete _api;
+      return -2;
+    }
+
+    _api->_dut->testAllPixels(true);
+    _api->_dut->maskAllPixels(false);
+
+    if(mode == "condense") { bench_condense(triggers,iterations,dumpfile,flags); }
+    else if(mode == "threshold") { bench_threshold(triggers,iterations,dumpfile,flags); }
+    else if(mode == "alloc") { bench_alloc(triggers,iterations,flags); }
+    else if(mode == "markers") { bench_markers(triggers,iterations,datafile); }
+    else if(mode == "daq") { bench_daq(triggers,iterations); }
+    else if(mode == "raw") { bench_raw(triggers,iterations); }
+    else if(mode == "live") { bench_live(triggers,iterations); }
+    else if(mode == "log") { bench_log(iterations); }
+    else if(mode == "emulator") { bench_emulator(triggers,iterations); }
+    else if(mode == "pixels") { bench_pixels(iterations); }
+    else if(mode == "decode") { bench_decode(triggers,iterations,tbmtype); }
+    else if(mode == "analog") { bench_analog(triggers,iterations,nrocs); }
+    else { std::cout << "Unknown benchmark mode " << mode << std::endl; }
+
+    delete _api;
+  }
+  catch (pxar::pxarException &e){
+    std::cout << "pxarCore exception: " << e.what() << std::endl;
+    delete _api;
+    return -1;
+  }
+  catch (...) {
+    std::cout << "pxar caught an unknown exception. Exiting." << std::endl;
+    delete _api;
+    return -1;
+  }
+
+  return 0;
+}